@@ -0,0 +1,394 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file check_hybrid.cpp
+ * @brief Miniapp to check the hybrid orbitals against analytic orbitals and a full grid.
+ */
+#include <Utilities/Configuration.h>
+#include <Utilities/Communicate.h>
+#include <Particle/ParticleSet.h>
+#include <Particle/ParticleSet_builder.hpp>
+#include <Utilities/RandomGenerator.h>
+#include <Input/Input.hpp>
+#include <QMCWaveFunctions/hybrid_spo.hpp>
+#include <QMCWaveFunctions/SyntheticOrbitals.h>
+#include <Utilities/qmcpack_version.h>
+#include <getopt.h>
+
+using namespace std;
+using namespace qmcplusplus;
+
+void print_help()
+{
+  // clang-format off
+  app_summary() << "usage:" << '\n';
+  app_summary() << "  check_hybrid [-hvV] [-g \"n0 n1 n2\"] [-o orbitals]"      << '\n';
+  app_summary() << "               [-c coarse_spacing] [-m full_spacing]"       << '\n';
+  app_summary() << "               [-l lmax] [-R cutoff] [-D radial_spacing]"   << '\n';
+  app_summary() << "               [-n positions] [-s seed]"                     << '\n';
+  app_summary() << "options:"                                                    << '\n';
+  app_summary() << "  -c  grid spacing between the spheres default: 0.5"       << '\n';
+  app_summary() << "  -D  radial grid spacing            default: 0.05"          << '\n';
+  app_summary() << "  -g  set the 3D tiling.             default: 1 1 1"         << '\n';
+  app_summary() << "  -h  print help and exit"                                   << '\n';
+  app_summary() << "  -l  maximum angular momentum       default: 5"             << '\n';
+  app_summary() << "  -m  grid spacing of the full grid  default: 0.15"          << '\n';
+  app_summary() << "  -n  number of positions            default: 512"           << '\n';
+  app_summary() << "  -o  number of orbitals             default: 32"            << '\n';
+  app_summary() << "  -R  radius of the atomic spheres   default: 1.6"           << '\n';
+  app_summary() << "  -s  set the random seed.           default: 11"            << '\n';
+  app_summary() << "  -v  verbose output"                                        << '\n';
+  app_summary() << "  -V  print version information and exit"                    << '\n';
+  // clang-format on
+
+  exit(1); // print help and exit
+}
+
+/// squared errors and norms of the values, gradients and laplacians in a region
+struct RegionErrors
+{
+  double v_err = 0, g_err = 0, l_err = 0;
+  double v_ref = 0, g_ref = 0, l_ref = 0;
+
+  void add(const RegionErrors& o)
+  {
+    v_err += o.v_err;
+    g_err += o.g_err;
+    l_err += o.l_err;
+    v_ref += o.v_ref;
+    g_ref += o.g_ref;
+    l_ref += o.l_ref;
+  }
+
+  void print(const std::string& name) const
+  {
+    app_log() << "  " << name << " relative RMS error V = " << std::sqrt(v_err / v_ref)
+              << " G = " << std::sqrt(g_err / g_ref) << " L = " << std::sqrt(l_err / l_ref) << std::endl;
+  }
+};
+
+int main(int argc, char** argv)
+{
+  // clang-format off
+  typedef QMCTraits::RealType           RealType;
+  typedef TinyVector<RealType, 3>       PosType;
+  // clang-format on
+
+  Communicate comm(argc, argv);
+
+  int na      = 1;
+  int nb      = 1;
+  int nc      = 1;
+  int norb    = 32;
+  int npos    = 512;
+  int iseed   = 11;
+  int lmax    = 5;
+  RealType coarse_spacing(0.5);
+  RealType full_spacing(0.15);
+  RealType cutoff(1.6);
+  RealType radial_spacing(0.05);
+
+  bool verbose = false;
+
+  if (!comm.root())
+  {
+    outputManager.shutOff();
+  }
+
+  int opt;
+  while (optind < argc)
+  {
+    if ((opt = getopt(argc, argv, "hvVc:D:g:l:m:n:o:R:s:")) != -1)
+    {
+      switch (opt)
+      {
+      case 'c':
+        coarse_spacing = atof(optarg);
+        break;
+      case 'D':
+        radial_spacing = atof(optarg);
+        break;
+      case 'g': // tiling1 tiling2 tiling3
+        sscanf(optarg, "%d %d %d", &na, &nb, &nc);
+        break;
+      case 'h':
+        print_help();
+        break;
+      case 'l':
+        lmax = atoi(optarg);
+        break;
+      case 'm':
+        full_spacing = atof(optarg);
+        break;
+      case 'n':
+        npos = atoi(optarg);
+        break;
+      case 'o':
+        norb = atoi(optarg);
+        break;
+      case 'R':
+        cutoff = atof(optarg);
+        break;
+      case 's':
+        iseed = atoi(optarg);
+        break;
+      case 'v':
+        verbose = true;
+        break;
+      case 'V':
+        print_version(true);
+        return 1;
+        break;
+      default:
+        print_help();
+      }
+    }
+    else // disallow non-option arguments
+    {
+      app_error() << "Non-option arguments not allowed" << endl;
+      print_help();
+    }
+  }
+
+  if (comm.root())
+  {
+    if (verbose)
+      outputManager.setVerbosity(Verbosity::HIGH);
+    else
+      outputManager.setVerbosity(Verbosity::LOW);
+  }
+
+  print_version(verbose);
+
+  Tensor<int, 3> tmat(na, 0, 0, 0, nb, 0, 0, 0, nc);
+
+  using spo_type = hybrid_spo<RealType>;
+  ParticleSet ions;
+  Tensor<OHMMS_PRECISION, 3> lattice_b;
+  build_ions(ions, tmat, lattice_b);
+  SyntheticOrbitals<RealType> orbitals(ions, norb);
+
+  // grids of about the requested spacings
+  TinyVector<int, 3> coarse_grid, full_grid;
+  for (int d = 0; d < 3; d++)
+  {
+    const RealType length = std::sqrt(dot(orbitals.getLattice().a(d), orbitals.getLattice().a(d)));
+    coarse_grid[d]        = std::max(4, static_cast<int>(std::ceil(length / coarse_spacing)));
+    full_grid[d]          = std::max(4, static_cast<int>(std::ceil(length / full_spacing)));
+  }
+
+  spo_type spo_main;
+  spo_type spo_full_main;
+  try
+  {
+    spo_main.set(orbitals, coarse_grid[0], coarse_grid[1], coarse_grid[2], 1, lmax, cutoff, radial_spacing);
+    spo_full_main.set(orbitals, full_grid[0], full_grid[1], full_grid[2], 1, 0, 0, radial_spacing);
+  }
+  catch (const std::exception& e)
+  {
+    app_error() << e.what() << endl;
+    return 1;
+  }
+
+  const double MB = 1.0 / 1024 / 1024;
+  app_summary() << "Number of orbitals = " << norb << endl
+                << "Number of ions = " << ions.getTotalNum() << endl
+                << "Positions = " << npos << endl;
+  app_summary() << "OpenMP threads = " << omp_get_max_threads() << endl;
+  app_summary() << "\nHybrid orbitals lmax = " << lmax << " cutoff = " << cutoff
+                << " radial spacing = " << radial_spacing << endl;
+  app_summary() << "  grid " << coarse_grid << " coefficients = " << spo_main.getGridBytes() * MB << " MB" << endl;
+  app_summary() << "  spheres coefficients = " << spo_main.getAtomicBytes() * MB << " MB" << endl;
+  app_summary() << "Full grid " << full_grid << " coefficients = " << spo_full_main.getGridBytes() * MB << " MB"
+                << endl;
+
+  // errors in the spheres and between them, and of the derivatives against finite differences
+  RegionErrors hybrid_sphere, hybrid_between, full_sphere, full_between;
+  double fd_err = 0, fd_ref = 0, model_fd_err = 0, model_fd_ref = 0, v_consistency_err = 0;
+
+#pragma omp parallel reduction(+ : fd_err, fd_ref, model_fd_err, model_fd_ref, v_consistency_err)
+  {
+    const int np = omp_get_num_threads();
+    const int ip = omp_get_thread_num();
+    RandomGenerator<RealType> random_th(MakeSeed(iseed + ip, np));
+
+    spo_type spo(spo_main, 1, 0);
+    spo_type spo_full(spo_full_main, 1, 0);
+    const int n = norb;
+    std::vector<RealType> v(n), g(3 * n), h(6 * n);
+    std::vector<RealType> vp(n), vm(n), gp(3 * n), gm(3 * n), hp(6 * n);
+    RegionErrors my_hybrid_sphere, my_hybrid_between, my_full_sphere, my_full_between;
+    const std::vector<PosType>& centers = orbitals.getCenters();
+    const RealType eps                  = 1e-4;
+
+#pragma omp for
+    for (int ipos = 0; ipos < npos; ipos++)
+    {
+      // half of the positions in the spheres, including their blending shells
+      RealType rnd[4];
+      random_th.generate_uniform(rnd, 4);
+      PosType r;
+      if (ipos % 2)
+      {
+        const int ic = std::min(static_cast<int>(rnd[0] * centers.size()), static_cast<int>(centers.size()) - 1);
+        PosType dir;
+        random_th.generate_normal(&dir[0], 3);
+        r = centers[ic] + (cutoff * rnd[1] / std::sqrt(dot(dir, dir))) * dir;
+      }
+      else
+        r = orbitals.getLattice().toCart(PosType(rnd[0], rnd[1], rnd[2]));
+
+      PosType d;
+      RealType dist;
+      const bool in_sphere = spo.findCenter(r, d, dist) >= 0;
+      orbitals.evaluate_vgh(r, v.data(), g.data(), h.data());
+      spo.evaluate_vgh(r);
+      spo_full.evaluate_vgh(r);
+
+      for (int k = 0; k < 2; k++)
+      {
+        const spo_type& s   = k ? spo_full : spo;
+        RegionErrors& e     = k ? (in_sphere ? my_full_sphere : my_full_between)
+                                : (in_sphere ? my_hybrid_sphere : my_hybrid_between);
+        for (int j = 0; j < n; j++)
+        {
+          const RealType l     = h[j] + h[3 * n + j] + h[5 * n + j];
+          const RealType l_spo = s.hess.data(0)[j] + s.hess.data(3)[j] + s.hess.data(5)[j];
+          e.v_err += (s.psi[j] - v[j]) * (s.psi[j] - v[j]);
+          e.v_ref += v[j] * v[j];
+          for (int a = 0; a < 3; a++)
+          {
+            e.g_err += (s.grad.data(a)[j] - g[a * n + j]) * (s.grad.data(a)[j] - g[a * n + j]);
+            e.g_ref += g[a * n + j] * g[a * n + j];
+          }
+          e.l_err += (l_spo - l) * (l_spo - l);
+          e.l_ref += l * l;
+        }
+      }
+
+      // the hybrid gradients and Hessians against the finite differences of its values and gradients
+      const spo_type::vContainer_type psi(spo.psi);
+      const spo_type::gContainer_type grad(spo.grad);
+      const spo_type::hContainer_type hess(spo.hess);
+      spo.evaluate_v(r);
+      for (int j = 0; j < n; j++)
+        v_consistency_err += std::fabs(spo.psi[j] - psi[j]);
+      for (int a = 0; a < 3; a++)
+      {
+        PosType dr(0);
+        dr[a] = eps;
+        spo.evaluate_v(r + dr);
+        std::copy_n(spo.psi.data(), n, vp.data());
+        spo.evaluate_v(r - dr);
+        std::copy_n(spo.psi.data(), n, vm.data());
+        spo.evaluate_vgh(r + dr);
+        for (int b = 0; b < 3; b++)
+          std::copy_n(spo.grad.data(b), n, gp.data() + b * n);
+        spo.evaluate_vgh(r - dr);
+        for (int b = 0; b < 3; b++)
+          std::copy_n(spo.grad.data(b), n, gm.data() + b * n);
+        for (int j = 0; j < n; j++)
+        {
+          const RealType fd_g = (vp[j] - vm[j]) / (2 * eps);
+          fd_err += (fd_g - grad.data(a)[j]) * (fd_g - grad.data(a)[j]);
+          fd_ref += grad.data(a)[j] * grad.data(a)[j];
+          for (int b = a; b < 3; b++)
+          {
+            const int ih        = a * (5 - a) / 2 + b;
+            const RealType fd_h = (gp[b * n + j] - gm[b * n + j]) / (2 * eps);
+            fd_err += (fd_h - hess.data(ih)[j]) * (fd_h - hess.data(ih)[j]);
+            fd_ref += hess.data(ih)[j] * hess.data(ih)[j];
+          }
+        }
+
+        // the same for the analytic orbitals
+        orbitals.evaluate_vgh(r + dr, vp.data(), gp.data(), hp.data());
+        orbitals.evaluate_vgh(r - dr, vm.data(), gm.data(), hp.data());
+        for (int j = 0; j < n; j++)
+        {
+          const RealType fd_g = (vp[j] - vm[j]) / (2 * eps);
+          model_fd_err += (fd_g - g[a * n + j]) * (fd_g - g[a * n + j]);
+          model_fd_ref += g[a * n + j] * g[a * n + j];
+          for (int b = a; b < 3; b++)
+          {
+            const int ih        = a * (5 - a) / 2 + b;
+            const RealType fd_h = (gp[b * n + j] - gm[b * n + j]) / (2 * eps);
+            model_fd_err += (fd_h - h[ih * n + j]) * (fd_h - h[ih * n + j]);
+            model_fd_ref += h[ih * n + j] * h[ih * n + j];
+          }
+        }
+      }
+    }
+
+#pragma omp critical
+    {
+      hybrid_sphere.add(my_hybrid_sphere);
+      hybrid_between.add(my_hybrid_between);
+      full_sphere.add(my_full_sphere);
+      full_between.add(my_full_between);
+    }
+  } // end of omp parallel
+
+  outputManager.resume();
+
+  app_log() << std::endl << "Accuracy against the analytic orbitals:" << std::endl;
+  hybrid_sphere.print("hybrid    in the spheres  ");
+  hybrid_between.print("hybrid    between spheres ");
+  full_sphere.print("full grid in the spheres  ");
+  full_between.print("full grid between spheres ");
+  app_log() << "  finite difference relative RMS error of the hybrid derivatives = " << std::sqrt(fd_err / fd_ref)
+            << " of the analytic ones = " << std::sqrt(model_fd_err / model_fd_ref) << std::endl;
+
+  const RealType fd_rel       = std::sqrt(fd_err / fd_ref);
+  const RealType model_fd_rel = std::sqrt(model_fd_err / model_fd_ref);
+  const RealType small_fd     = 1e-5;
+  const RealType small_v      = 1e-3;
+  const RealType small_g      = 1e-2;
+  const RealType small_l      = 5e-2;
+  int nfail                   = 0;
+  if (v_consistency_err / npos > small_fd)
+  {
+    app_log() << "Fail in evaluate_v, V error against evaluate_vgh = " << v_consistency_err / npos << std::endl;
+    nfail += 1;
+  }
+  if (model_fd_rel > small_fd)
+  {
+    app_log() << "Fail in the analytic orbitals, finite difference error = " << model_fd_rel << std::endl;
+    nfail += 1;
+  }
+  if (fd_rel > small_fd)
+  {
+    app_log() << "Fail in evaluate_vgh, finite difference error = " << fd_rel << std::endl;
+    nfail += 1;
+  }
+  for (const RegionErrors* e : {&hybrid_sphere, &hybrid_between})
+  {
+    if (std::sqrt(e->v_err / e->v_ref) > small_v)
+    {
+      app_log() << "Fail in evaluate_vgh, V error = " << std::sqrt(e->v_err / e->v_ref) << std::endl;
+      nfail += 1;
+    }
+    if (std::sqrt(e->g_err / e->g_ref) > small_g)
+    {
+      app_log() << "Fail in evaluate_vgh, G error = " << std::sqrt(e->g_err / e->g_ref) << std::endl;
+      nfail += 1;
+    }
+    if (std::sqrt(e->l_err / e->l_ref) > small_l)
+    {
+      app_log() << "Fail in evaluate_vgh, L error = " << std::sqrt(e->l_err / e->l_ref) << std::endl;
+      nfail += 1;
+    }
+  }
+  if (nfail == 0)
+    app_log() << "All checks passed for hybrid spo" << std::endl;
+
+  return 0;
+}
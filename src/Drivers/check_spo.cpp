@@ -23,9 +23,12 @@
 #include <Particle/ParticleSet.h>
 #include <Particle/ParticleSet_builder.hpp>
 #include <Utilities/RandomGenerator.h>
+#include <Utilities/Clock.h>
 #include <Input/Input.hpp>
 #include <QMCWaveFunctions/einspline_spo.hpp>
 #include <QMCWaveFunctions/einspline_spo_ref.hpp>
+#include <QMCWaveFunctions/einspline_spo_distributed.hpp>
+#include <QMCWaveFunctions/SyntheticOrbitals.h>
 #include <Drivers/NonLocalPP.hpp>
 #include <Utilities/qmcpack_version.h>
 #include <getopt.h>
@@ -37,15 +40,27 @@ void print_help()
 {
   // clang-format off
   app_summary() << "usage:" << '\n';
-  app_summary() << "  check_spo [-hvV] [-g \"n0 n1 n2\"] [-m meshfactor]"        << '\n';
+  app_summary() << "  check_spo [-hIDvV] [-g \"n0 n1 n2\"] [-m meshfactor]"       << '\n';
   app_summary() << "            [-n steps] [-r rmax] [-s seed]"                  << '\n';
+  app_summary() << "            [-d spline_storage] [-f coef_file]"              << '\n';
+  app_summary() << "            [-u numa_policy] [-B brick_edge] [-L support]"   << '\n';
+  app_summary() << "            [-C cache_MB] [-q coarse_fraction]"              << '\n';
   app_summary() << "options:"                                                    << '\n';
+  app_summary() << "  -B  spline brick edge, 0: x-major  default: 0"             << '\n';
+  app_summary() << "  -C  read the bricks of the -f file through a cache of this many MB default: 0 (map)" << '\n';
+  app_summary() << "  -d  spline storage: full|fp16|bf16 default: full"         << '\n';
+  app_summary() << "  -D  also check the orbitals distributed over the ranks of each node" << '\n';
+  app_summary() << "  -f  mmap spline coefficients file  default: none"         << '\n';
   app_summary() << "  -g  set the 3D tiling.             default: 1 1 1"         << '\n';
   app_summary() << "  -h  print help and exit"                                   << '\n';
+  app_summary() << "  -I  store half of the splines using inversion symmetry" << '\n';
+  app_summary() << "  -L  support of each tile, fraction of the cell default: 0 (full cell)" << '\n';
   app_summary() << "  -m  meshfactor                     default: 1.0"           << '\n';
   app_summary() << "  -n  number of MC steps             default: 5"             << '\n';
+  app_summary() << "  -q  report the pseudopotential ratios on a grid coarser by this fraction default: 0 (none)" << '\n';
   app_summary() << "  -r  set the Rmax.                  default: 1.7"           << '\n';
   app_summary() << "  -s  set the random seed.           default: 11"            << '\n';
+  app_summary() << "  -u  SPO NUMA policy: none|interleave|replicate default: none" << '\n';
   app_summary() << "  -v  verbose output"                                        << '\n';
   app_summary() << "  -V  print version information and exit"                    << '\n';
   // clang-format on
@@ -53,6 +68,96 @@ void print_help()
   exit(1); // print help and exit
 }
 
+/// squared errors and norms of the ratios on the coarse grid and of the orbitals at its points, and the times
+struct CoarseRatioErrors
+{
+  double ratio_err = 0, ratio_ref = 0, node_err = 0, node_ref = 0, coarse_time = 0, full_time = 0;
+};
+
+/// the ratios of the virtual moves around the ions with the coarse grid of spo_main against its full grid
+CoarseRatioErrors checkCoarseRatios(const einspline_spo<OHMMS_PRECISION>& spo_main,
+                                    const ParticleSet& ions,
+                                    int nsteps,
+                                    OHMMS_PRECISION Rmax)
+{
+  using spo_type      = einspline_spo<OHMMS_PRECISION>;
+  using RealType      = QMCTraits::RealType;
+  using ParticlePos_t = ParticleSet::ParticlePos_t;
+  double ratio_err = 0.0, ratio_ref = 0.0, node_err = 0.0, node_ref = 0.0;
+  double coarse_time = 0.0, full_time = 0.0;
+#pragma omp parallel reduction(+:ratio_err, ratio_ref, node_err, node_ref, coarse_time, full_time)
+  {
+    const int np = omp_get_num_threads();
+    const int ip = omp_get_thread_num();
+    RandomGenerator<RealType> random_th(MakeSeed(ip, np));
+    ParticleSet els;
+    build_els(els, ions, random_th);
+    els.update();
+    NonLocalPP<OHMMS_PRECISION> ecp(random_th, ions);
+    const int nknots = ecp.size();
+
+    spo_type spo(spo_main, 1, 0);
+    spo_type spo_full(spo_main, 1, 0);
+    spo_full.Coarse.reset();
+    VirtualParticleSet vp(els, nknots);
+    ParticlePos_t rOnSphere(nknots), vpos(nknots);
+    SPOSet::ValueVector_t psi_vp(spo_main.size()), inv_vp(spo_main.size());
+    std::vector<SPOSet::ValueType> ratios(nknots), ratios_full(nknots);
+    random_th.generate_uniform(inv_vp.data(), inv_vp.size());
+
+#pragma omp for
+    for (int is = 0; is < nsteps * ions.getTotalNum(); is++)
+    {
+      RealType r;
+      random_th.generate_uniform(&r, 1);
+      ecp.randomize(rOnSphere);
+      const int iat = is % ions.getTotalNum();
+      for (int k = 0; k < nknots; k++)
+        vpos[k] = ions.R[iat] + Rmax * r * rOnSphere[k];
+      vp.makeMoves(is % els.getTotalNum(), vpos);
+      const double t0 = cpu_clock();
+      spo.evaluateDetRatios(vp, psi_vp, inv_vp, ratios);
+      const double t1 = cpu_clock();
+      spo_full.evaluateDetRatios(vp, psi_vp, inv_vp, ratios_full);
+      coarse_time += t1 - t0;
+      full_time += cpu_clock() - t1;
+      for (int k = 0; k < nknots; k++)
+      {
+        ratio_err += (ratios[k] - ratios_full[k]) * (ratios[k] - ratios_full[k]);
+        ratio_ref += ratios_full[k] * ratios_full[k];
+      }
+    }
+
+    // the coarse splines interpolate the full resolution ones at their grid points
+    const TinyVector<int, 3> ng = spo.Coarse->getGridNum();
+#pragma omp for
+    for (int ix = 0; ix < ng[0]; ix++)
+      for (int iy = 0; iy < ng[1]; iy++)
+        for (int iz = 0; iz < ng[2]; iz++)
+        {
+          const TinyVector<RealType, 3> u(RealType(ix) / ng[0], RealType(iy) / ng[1], RealType(iz) / ng[2]);
+          spo.Coarse->evaluate_v_blocks(u);
+          spo_full.evaluate_v_blocks(u);
+          for (int ib = 0; ib < spo.nBlocks; ib++)
+            for (int n = 0; n < spo.nSplinesPerBlock; n++)
+            {
+              const RealType d = spo.Coarse->psi[ib][n] - spo_full.psi[ib][n];
+              node_err += d * d;
+              node_ref += spo_full.psi[ib][n] * spo_full.psi[ib][n];
+            }
+        }
+  }
+
+  CoarseRatioErrors errors;
+  errors.ratio_err   = ratio_err;
+  errors.ratio_ref   = ratio_ref;
+  errors.node_err    = node_err;
+  errors.node_ref    = node_ref;
+  errors.coarse_time = coarse_time;
+  errors.full_time   = full_time;
+  return errors;
+}
+
 int main(int argc, char** argv)
 {
   // clang-format off
@@ -79,6 +184,16 @@ int main(int argc, char** argv)
 
   bool verbose = false;
 
+  spline2::SplineStorage spline_storage = spline2::SplineStorage::FULL;
+  int brick_shift                       = 0;
+  RealType support                      = 0;
+  bool inversion                        = false;
+  size_t cache_MB                       = 0;
+  bool distributed                      = false;
+  RealType coarse_fraction              = 0;
+  std::string coef_file;
+  NumaPolicy numa_policy = NumaPolicy::NONE;
+
   if (!comm.root())
   {
     outputManager.shutOff();
@@ -87,7 +202,7 @@ int main(int argc, char** argv)
   int opt;
   while (optind < argc)
   {
-    if ((opt = getopt(argc, argv, "hvVa:c:f:g:m:n:r:s:")) != -1)
+    if ((opt = getopt(argc, argv, "hIDvVa:B:c:C:d:f:g:L:m:n:q:r:s:u:")) != -1)
     {
       switch (opt)
       {
@@ -97,12 +212,41 @@ int main(int argc, char** argv)
       case 'c': // number of members per team
         team_size = atoi(optarg);
         break;
+      case 'C':
+        cache_MB = atoi(optarg);
+        break;
+      case 'B':
+        if (!spline2::parseBrickEdge(atoi(optarg), brick_shift))
+        {
+          app_error() << "Spline brick edge should be 0 or a power of 2 up to 64, given: " << optarg << endl;
+          return 1;
+        }
+        break;
+      case 'd':
+        if (!spline2::parseSplineStorage(optarg, spline_storage))
+        {
+          app_error() << "Spline storage should be 'full', 'fp16' or 'bf16', name given: " << optarg << endl;
+          return 1;
+        }
+        break;
+      case 'D':
+        distributed = true;
+        break;
+      case 'f':
+        coef_file = optarg;
+        break;
       case 'g': // tiling1 tiling2 tiling3
         sscanf(optarg, "%d %d %d", &na, &nb, &nc);
         break;
       case 'h':
         print_help();
         break;
+      case 'I':
+        inversion = true;
+        break;
+      case 'L':
+        support = atof(optarg);
+        break;
       case 'm':
       {
         const RealType meshfactor = atof(optarg);
@@ -114,12 +258,22 @@ int main(int argc, char** argv)
       case 'n':
         nsteps = atoi(optarg);
         break;
+      case 'q':
+        coarse_fraction = atof(optarg);
+        break;
       case 'r': // rmax
         Rmax = atof(optarg);
         break;
       case 's':
         iseed = atoi(optarg);
         break;
+      case 'u':
+        if (!parseNumaPolicy(optarg, numa_policy))
+        {
+          app_error() << "NUMA policy should be 'none', 'interleave' or 'replicate', name given: " << optarg << endl;
+          return 1;
+        }
+        break;
       case 'v':
         verbose = true;
         break;
@@ -138,6 +292,19 @@ int main(int argc, char** argv)
     }
   }
 
+  if (cache_MB > 0 && (coef_file.empty() || brick_shift == 0))
+  {
+    app_error() << "Paging the spline coefficients requires a file (-f) with the brick layout (-B)" << endl;
+    return 1;
+  }
+
+  if (distributed && (!coef_file.empty() || (support > 0 && support < 1)))
+  {
+    app_error() << "Distributing the orbitals (-D) does not support coefficient files (-f) or localized orbitals (-L)"
+                << endl;
+    return 1;
+  }
+
   if (comm.root())
   {
     if (verbose)
@@ -157,6 +324,9 @@ int main(int argc, char** argv)
   using spo_ref_type = miniqmcreference::einspline_spo_ref<OHMMS_PRECISION>;
   spo_ref_type spo_ref_main;
   int nTiles = 1;
+  // the ranks of a node share the distributed orbitals
+  std::unique_ptr<Communicate> node_comm;
+  std::unique_ptr<einspline_spo_distributed<OHMMS_PRECISION>> spo_dist;
 
   ParticleSet ions;
   // initialize ions and splines which are shared by all threads later
@@ -168,7 +338,8 @@ int main(int argc, char** argv)
     nTiles         = norb / tileSize;
 
     const size_t SPO_coeff_size =
-        static_cast<size_t>(norb) * (nx + 3) * (ny + 3) * (nz + 3) * sizeof(RealType);
+        static_cast<size_t>(norb) * (inversion ? nx / 2 + 4 : nx + 3) * (ny + 3) * (nz + 3) *
+        spline2::getSplineStorageBytes(spline_storage, sizeof(RealType));
     const double SPO_coeff_size_MB = SPO_coeff_size * 1.0 / 1024 / 1024;
 
     app_summary() << "Number of orbitals/splines = " << norb << endl
@@ -183,11 +354,65 @@ int main(int argc, char** argv)
 
     app_summary() << "\nSPO coefficients size = " << SPO_coeff_size << " bytes ("
                   << SPO_coeff_size_MB << " MB)" << endl;
-
-    spo_main.set(nx, ny, nz, norb, nTiles);
+    app_summary() << "SPO coefficients storage = " << spline2::getSplineStorageName(spline_storage) << endl;
+    app_summary() << "SPO coefficients layout = " << spline2::getSplineLayoutName(brick_shift) << endl;
+    if (inversion)
+      app_summary() << "SPO inversion symmetry = half of the grid stored" << endl;
+    if (support > 0 && support < 1)
+      app_summary() << "SPO orbital support = " << support << " of the cell edge per tile" << endl;
+    app_summary() << "SPO kernels = " << spline2::getSplineISAName(spline2::getSplineISA()) << endl;
+
+    if (coef_file.empty())
+    {
+      spo_main.set(nx, ny, nz, norb, nTiles, true, spline_storage, brick_shift, inversion);
+      spo_main.localize(support);
+    }
+    else if (cache_MB > 0)
+    {
+      const size_t cache_bytes = cache_MB << 20;
+      if (!spo_main.page(coef_file, nx, ny, nz, norb, nTiles, brick_shift, inversion, cache_bytes))
+      {
+        spo_type spo_file;
+        spo_file.set(nx, ny, nz, norb, nTiles, true, spline_storage, brick_shift, inversion);
+        spo_file.localize(support);
+        spo_file.save(coef_file);
+        app_summary() << "SPO coefficients written to " << coef_file << endl;
+        spo_main.page(coef_file, nx, ny, nz, norb, nTiles, brick_shift, inversion, cache_bytes);
+      }
+      spo_main.localize(support);
+      app_summary() << "SPO coefficients paged from " << coef_file << " through a cache of " << cache_MB << " MB"
+                    << endl;
+    }
+    else if (spo_main.load(coef_file, nx, ny, nz, norb, nTiles, spline_storage, brick_shift, inversion))
+    {
+      spo_main.localize(support);
+      app_summary() << "SPO coefficients mapped from " << coef_file << endl;
+    }
+    else
+    {
+      spo_main.set(nx, ny, nz, norb, nTiles, true, spline_storage, brick_shift, inversion);
+      spo_main.localize(support);
+      spo_main.save(coef_file);
+      app_summary() << "SPO coefficients written to " << coef_file << endl;
+    }
     spo_main.Lattice.set(lattice_b);
-    spo_ref_main.set(nx, ny, nz, norb, nTiles);
+    const int num_domains = spo_main.applyNumaPolicy(numa_policy);
+    app_summary() << "SPO coefficients NUMA policy = " << getNumaPolicyName(numa_policy) << " over " << num_domains
+                  << " domain(s)" << endl;
+    if (distributed)
+    {
+      node_comm = comm.createNodeComm();
+      spo_dist.reset(new einspline_spo_distributed<OHMMS_PRECISION>(*node_comm));
+      spo_dist->set(nx, ny, nz, norb, nTiles, true, spline_storage, brick_shift, inversion);
+      spo_dist->Slice.Lattice.set(lattice_b);
+      app_summary() << "SPO coefficients distributed over " << node_comm->size() << " rank(s) per node, "
+                    << spo_dist->getSliceSize(node_comm->rank()) << " orbitals on the first rank" << endl;
+    }
+    spo_ref_main.set(nx, ny, nz, norb, nTiles, true, inversion);
     spo_ref_main.Lattice.set(lattice_b);
+    // the reference evaluates the localized orbitals everywhere
+    for (int i = 0; i < static_cast<int>(spo_main.Supports.size()); i++)
+      spo_type::clearOutsideSupport(spo_ref_main.einsplines[i], spo_main.Supports[i]);
   }
 
   double nspheremoves = 0;
@@ -197,10 +422,18 @@ int main(int argc, char** argv)
   double evalVGH_v_err = 0.0;
   double evalVGH_g_err = 0.0;
   double evalVGH_h_err = 0.0;
+  double evalVGH_batch_err = 0.0;
+  double evalVGH_team_err  = 0.0;
+  double evalV_ratios_err  = 0.0;
+  double evalVGH_dist_err  = 0.0;
+  // time of the evaluations of a walker by a team and by its first member alone
+  double team_time   = 0.0;
+  double single_time = 0.0;
 
   // clang-format off
   #pragma omp parallel reduction(+:ratio,nspheremoves,dNumVGHCalls) \
-   reduction(+:evalV_v_err,evalVGH_v_err,evalVGH_g_err,evalVGH_h_err)
+   reduction(+:evalV_v_err,evalVGH_v_err,evalVGH_g_err,evalVGH_h_err,evalVGH_batch_err,evalVGH_team_err) \
+   reduction(+:evalV_ratios_err,evalVGH_dist_err,team_time,single_time)
   // clang-format on
   {
     const int np        = omp_get_num_threads();
@@ -215,6 +448,11 @@ int main(int argc, char** argv)
     build_els(els, ions, random_th);
     els.update();
 
+    // a second walker to check the batched evaluation
+    ParticleSet els_b;
+    build_els(els_b, ions, random_th);
+    els_b.update();
+
     const int nions = ions.getTotalNum();
     const int nels  = els.getTotalNum();
     const int nels3 = 3 * nels;
@@ -225,6 +463,33 @@ int main(int argc, char** argv)
     spo_type spo(spo_main, team_size, member_id);
     spo_ref_type spo_ref(spo_ref_main, team_size, member_id);
 
+    // walker views and outputs of the batched evaluation
+    spo_type spo_w0(spo_main, team_size, member_id);
+    spo_type spo_w1(spo_main, team_size, member_id);
+    const std::vector<SPOSet*> spo_list = {&spo_w0, &spo_w1};
+    const std::vector<ParticleSet*> P_list = {&els, &els_b};
+    std::vector<SPOSet::ValueVector_t> psi_v(2, SPOSet::ValueVector_t(spo_main.size()));
+    std::vector<SPOSet::GradVector_t> dpsi_v(2, SPOSet::GradVector_t(spo_main.size()));
+    std::vector<SPOSet::ValueVector_t> d2psi_v(2, SPOSet::ValueVector_t(spo_main.size()));
+    std::vector<SPOSet::ValueVector_t*> psi_v_list = {&psi_v[0], &psi_v[1]};
+    std::vector<SPOSet::GradVector_t*> dpsi_v_list = {&dpsi_v[0], &dpsi_v[1]};
+    std::vector<SPOSet::ValueVector_t*> d2psi_v_list = {&d2psi_v[0], &d2psi_v[1]};
+
+    // the blocks of the view split over a team of threads and its outputs
+    spo_type spo_team(spo_main, team_size, member_id);
+    spo_team.createTeam(spo_team.nBlocks);
+    spo_type spo_single(spo_main, team_size, member_id);
+    SPOSet::ValueVector_t psi_t(spo_main.size());
+    SPOSet::GradVector_t dpsi_t(spo_main.size());
+    SPOSet::ValueVector_t d2psi_t(spo_main.size());
+
+    // all the blocks to check the distributed orbitals, the first thread of each rank evaluates them
+    spo_type spo_all(spo_main, 1, 0);
+    SPOSet::ValueVector_t psi_d(spo_main.size());
+    SPOSet::GradVector_t dpsi_d(spo_main.size());
+    SPOSet::ValueVector_t d2psi_d(spo_main.size());
+    const bool check_dist = spo_dist && ip == 0;
+
     // use teams
     // if(team_size>1 && team_size>=nTiles ) spo.set_range(team_size,ip%team_size);
 
@@ -234,6 +499,13 @@ int main(int argc, char** argv)
     ParticlePos_t delta(nels);
     ParticlePos_t rOnSphere(nknots);
 
+    // all the knots evaluated together by evaluateDetRatios against one at a time
+    VirtualParticleSet vp(els, nknots);
+    ParticlePos_t vpos(nknots);
+    SPOSet::ValueVector_t psi_vp(spo_main.size()), inv_vp(spo_main.size());
+    std::vector<SPOSet::ValueType> ratios_vp(nknots), ratios_vp_ref(nknots);
+    random_th.generate_uniform(inv_vp.data(), inv_vp.size());
+
     RealType accept  = 0.5;
 
     vector<RealType> ur(nels);
@@ -276,6 +548,69 @@ int main(int argc, char** argv)
           els.acceptMove(iel);
           my_accepted++;
         }
+
+        // batched evaluation of both walkers against the single walker one
+        els.makeMove(iel, delta[iel]);
+        els_b.makeMove(iel, delta[iel]);
+        spo_w0.multi_evaluate(spo_list, P_list, iel, psi_v_list, dpsi_v_list, d2psi_v_list);
+        for (int iw = 0; iw < 2; iw++)
+        {
+          spo.evaluate_vgh(*P_list[iw], iel);
+          const spo_type& spo_w = (iw == 0) ? spo_w0 : spo_w1;
+          for (int ib = 0; ib < spo.nBlocks; ib++)
+            for (int n = 0; n < spo.nSplinesPerBlock; n++)
+            {
+              const int j = (spo.firstBlock + ib) * spo.nSplinesPerBlock + n;
+              evalVGH_batch_err += std::fabs(psi_v[iw][j] - spo.psi[ib][n]);
+              for (int d = 0; d < 3; d++)
+                evalVGH_batch_err += std::fabs(dpsi_v[iw][j][d] - spo.grad[ib].data(d)[n]);
+              for (int d = 0; d < 6; d++)
+                evalVGH_batch_err += std::fabs(spo_w.hess[ib].data(d)[n] - spo.hess[ib].data(d)[n]);
+            }
+        }
+
+        // team evaluation against the single thread one
+        const double t0 = cpu_clock();
+        spo_team.evaluate(els, iel, psi_t, dpsi_t, d2psi_t);
+        team_time += cpu_clock() - t0;
+        spo.evaluate_vgh(els, iel);
+        for (int ib = 0; ib < spo.nBlocks; ib++)
+          for (int n = 0; n < spo.nSplinesPerBlock; n++)
+          {
+            const int j = (spo.firstBlock + ib) * spo.nSplinesPerBlock + n;
+            evalVGH_team_err += std::fabs(psi_t[j] - spo.psi[ib][n]);
+            for (int d = 0; d < 3; d++)
+              evalVGH_team_err += std::fabs(dpsi_t[j][d] - spo.grad[ib].data(d)[n]);
+            evalVGH_team_err += std::fabs(d2psi_t[j] - spo.hess[ib].data(0)[n] - spo.hess[ib].data(3)[n] -
+                                          spo.hess[ib].data(5)[n]);
+          }
+        const double t1 = cpu_clock();
+        spo_single.evaluate(els, iel, psi_t, dpsi_t, d2psi_t);
+        single_time += cpu_clock() - t1;
+
+        // distributed evaluation against all the blocks, the ranks evaluate together
+        if (check_dist)
+        {
+          spo_dist->evaluate(els, iel, psi_d, dpsi_d, d2psi_d);
+          spo_all.evaluate(els, iel, psi_t, dpsi_t, d2psi_t);
+          for (int j = 0; j < spo_main.size(); j++)
+          {
+            evalVGH_dist_err += std::fabs(psi_d[j] - psi_t[j]);
+            for (int d = 0; d < 3; d++)
+              evalVGH_dist_err += std::fabs(dpsi_d[j][d] - dpsi_t[j][d]);
+            evalVGH_dist_err += std::fabs(d2psi_d[j] - d2psi_t[j]);
+          }
+
+          for (int k = 0; k < nknots; k++)
+            vpos[k] = els.R[iel] + Rmax * rOnSphere[k];
+          vp.makeMoves(iel, vpos);
+          spo_dist->evaluateDetRatios(vp, psi_vp, inv_vp, ratios_vp);
+          spo_all.evaluateDetRatios(vp, psi_vp, inv_vp, ratios_vp_ref);
+          for (int k = 0; k < nknots; k++)
+            evalVGH_dist_err += std::fabs(ratios_vp[k] - ratios_vp_ref[k]);
+        }
+        els.rejectMove(iel);
+        els_b.rejectMove(iel);
       }
 
       random_th.generate_uniform(ur.data(), nels);
@@ -300,7 +635,14 @@ int main(int argc, char** argv)
             for (int ib = 0; ib < spo.nBlocks; ib++)
               for (int n = 0; n < spo.nSplinesPerBlock; n++)
                 evalV_v_err += std::fabs(spo.psi[ib][n] - spo_ref.psi[ib][n]);
+            vpos[k] = centerP + r * rOnSphere[k];
           }
+          els.rejectMove(iel);
+          vp.makeMoves(iel, vpos);
+          spo.evaluateDetRatios(vp, psi_vp, inv_vp, ratios_vp);
+          spo.SPOSet::evaluateDetRatios(vp, psi_vp, inv_vp, ratios_vp_ref);
+          for (int k = 0; k < nknots; k++)
+            evalV_ratios_err += std::fabs(ratios_vp[k] - ratios_vp_ref[k]);
         } // els
       }   // ions
 
@@ -318,13 +660,28 @@ int main(int argc, char** argv)
   evalVGH_v_err /= dNumVGHCalls;
   evalVGH_g_err /= dNumVGHCalls;
   evalVGH_h_err /= dNumVGHCalls;
-
-  int np                     = omp_get_max_threads();
-  constexpr RealType small_v = std::numeric_limits<RealType>::epsilon() * 1e4;
-  constexpr RealType small_g = std::numeric_limits<RealType>::epsilon() * 3e6;
-  constexpr RealType small_h = std::numeric_limits<RealType>::epsilon() * 6e8;
-  int nfail                  = 0;
+  evalVGH_batch_err /= dNumVGHCalls;
+  evalVGH_team_err /= dNumVGHCalls;
+  evalV_ratios_err /= nspheremoves;
+  evalVGH_dist_err /= dNumVGHCalls;
+
+  int np = omp_get_max_threads();
+  // 16-bit coefficients are checked against their own unit roundoff
+  const RealType eps =
+      std::max(static_cast<double>(std::numeric_limits<RealType>::epsilon()),
+               spline2::getSplineStorageEpsilon(spline_storage));
+  const RealType small_v = eps * 1e4;
+  const RealType small_g = eps * 3e6;
+  const RealType small_h = eps * 6e8;
+  int nfail              = 0;
   app_log() << std::endl;
+  if (spline_storage != spline2::SplineStorage::FULL)
+    app_log() << "Accuracy of " << spline2::getSplineStorageName(spline_storage)
+              << " coefficients against the reference:" << std::endl
+              << "  evaluate_v   V error = " << evalV_v_err / np << std::endl
+              << "  evaluate_vgh V error = " << evalVGH_v_err / np << std::endl
+              << "  evaluate_vgh G error = " << evalVGH_g_err / np << std::endl
+              << "  evaluate_vgh H error = " << evalVGH_h_err / np << std::endl;
   if (evalV_v_err / np > small_v)
   {
     app_log() << "Fail in evaluate_v, V error =" << evalV_v_err / np << std::endl;
@@ -345,6 +702,156 @@ int main(int argc, char** argv)
     app_log() << "Fail in evaluate_vgh, H error =" << evalVGH_h_err / np << std::endl;
     nfail += 1;
   }
+  if (evalVGH_batch_err / np > small_h)
+  {
+    app_log() << "Fail in batched evaluate_vgh, VGH error =" << evalVGH_batch_err / np << std::endl;
+    nfail += 1;
+  }
+  if (evalVGH_team_err / np > small_h)
+  {
+    app_log() << "Fail in team evaluate_vgh, VGH error =" << evalVGH_team_err / np << std::endl;
+    nfail += 1;
+  }
+
+  if (evalV_ratios_err / np > small_v)
+  {
+    app_log() << "Fail in evaluateDetRatios, ratio error =" << evalV_ratios_err / np << std::endl;
+    nfail += 1;
+  }
+  if (evalVGH_dist_err / np > small_h)
+  {
+    app_log() << "Fail in distributed evaluate, VGL and ratio error =" << evalVGH_dist_err / np << std::endl;
+    nfail += 1;
+  }
+  if (verbose)
+    app_log() << "Team evaluate per walker move = " << team_time / (dNumVGHCalls * nsteps) * 1e6
+              << " us, alone = " << single_time / (dNumVGHCalls * nsteps) * 1e6 << " us" << std::endl;
+
+  // every supported instruction set of the spline kernels against the reference
+  if (spline_storage == spline2::SplineStorage::FULL && !spo_main.Paged)
+  {
+    const int npos = nsteps * 64;
+    const int ns   = spo_main.nSplinesPerBlock;
+    std::vector<RealType> upos(3 * npos);
+    RandomGenerator<RealType> random_pos(MakeSeed(0, 1));
+    random_pos.generate_uniform(upos.data(), 3 * npos);
+
+    for (auto isa : {spline2::SplineISA::GENERIC, spline2::SplineISA::AVX2, spline2::SplineISA::AVX512})
+    {
+      if (!spline2::isSplineISASupported(isa))
+        continue;
+      const auto& kernels = spline2::getMultiBsplineKernels<RealType>(isa);
+      double v_err = 0.0, g_err = 0.0, l_err = 0.0, h_err = 0.0;
+#pragma omp parallel reduction(+:v_err, g_err, l_err, h_err)
+      {
+        aligned_vector<RealType> v(ns), g(3 * ns), h(6 * ns);
+        aligned_vector<RealType> v_ref(ns), g_ref(3 * ns), h_ref(6 * ns);
+#pragma omp for
+        for (int ipos = 0; ipos < npos; ipos++)
+        {
+          const RealType* u = upos.data() + 3 * ipos;
+          for (int ib = 0; ib < spo_main.nBlocks; ib++)
+          {
+            const auto* spline     = spo_main.einsplines[ib];
+            const auto* spline_ref = spo_ref_main.einsplines[ib];
+            kernels.evaluate_v(spline, u[0], u[1], u[2], v.data(), ns);
+            miniqmcreference::MultiBsplineEvalRef::evaluate_v(spline_ref, u[0], u[1], u[2], v_ref.data(), ns);
+            for (int n = 0; n < ns; n++)
+              v_err += std::fabs(v[n] - v_ref[n]);
+
+            kernels.evaluate_vg(spline, u[0], u[1], u[2], v.data(), g.data(), ns);
+            miniqmcreference::MultiBsplineEvalRef::evaluate_vgh(spline_ref, u[0], u[1], u[2], v_ref.data(),
+                                                                g_ref.data(), h_ref.data(), ns);
+            for (int n = 0; n < ns; n++)
+              v_err += std::fabs(v[n] - v_ref[n]);
+            for (int n = 0; n < 3 * ns; n++)
+              g_err += std::fabs(g[n] - g_ref[n]);
+
+            kernels.evaluate_vgl(spline, u[0], u[1], u[2], v.data(), g.data(), h.data(), ns);
+            miniqmcreference::MultiBsplineEvalRef::evaluate_vgl(spline_ref, u[0], u[1], u[2], v_ref.data(),
+                                                                g_ref.data(), h_ref.data(), ns);
+            for (int n = 0; n < ns; n++)
+              l_err += std::fabs(h[n] - h_ref[n]);
+
+            kernels.evaluate_l(spline, u[0], u[1], u[2], h.data(), ns);
+            for (int n = 0; n < ns; n++)
+              l_err += std::fabs(h[n] - h_ref[n]);
+
+            kernels.evaluate_vgh(spline, u[0], u[1], u[2], v.data(), g.data(), h.data(), ns);
+            miniqmcreference::MultiBsplineEvalRef::evaluate_vgh(spline_ref, u[0], u[1], u[2], v_ref.data(),
+                                                                g_ref.data(), h_ref.data(), ns);
+            for (int n = 0; n < ns; n++)
+              v_err += std::fabs(v[n] - v_ref[n]);
+            for (int n = 0; n < 3 * ns; n++)
+              g_err += std::fabs(g[n] - g_ref[n]);
+            for (int n = 0; n < 6 * ns; n++)
+              h_err += std::fabs(h[n] - h_ref[n]);
+          }
+        }
+      }
+      v_err /= 3 * npos;
+      g_err /= 2 * npos;
+      l_err /= 2 * npos;
+      h_err /= npos;
+      const std::string name = spline2::getSplineISAName(isa);
+      if (verbose)
+        app_log() << "Spline kernels " << name << ", V error = " << v_err << ", G error = " << g_err
+                  << ", L error = " << l_err << ", H error = " << h_err << std::endl;
+      if (v_err > small_v || g_err > small_g || l_err > small_h || h_err > small_h)
+      {
+        app_log() << "Fail in " << name << " spline kernels, V error = " << v_err << ", G error = " << g_err
+                  << ", L error = " << l_err << ", H error = " << h_err << std::endl;
+        nfail += 1;
+      }
+    }
+  }
+  // the ratios of the virtual moves on the coarse grid against the full resolution ones, with the random
+  // orbitals and with smooth ones which the coarse grid resolves
+  if (coarse_fraction > 0 && coarse_fraction < 1)
+  {
+    spo_type spo_smooth;
+    spo_smooth.set(nx, ny, nz, spo_main.nSplines, nTiles, false);
+    spo_smooth.Lattice = spo_main.Lattice;
+    {
+      SyntheticOrbitals<RealType> orbitals(ions, spo_main.nSplines);
+      const int norb = spo_main.nSplines;
+      std::vector<RealType> values(static_cast<size_t>(nx) * ny * nz * norb);
+#pragma omp parallel for
+      for (int ix = 0; ix < nx; ix++)
+        for (int iy = 0; iy < ny; iy++)
+          for (int iz = 0; iz < nz; iz++)
+          {
+            const PosType u(RealType(ix) / nx, RealType(iy) / ny, RealType(iz) / nz);
+            orbitals.evaluate_v(spo_smooth.Lattice.toCart(u), values.data() + ((ix * ny + iy) * nz + iz) * norb, false);
+          }
+      spo_smooth.interpolate(values);
+    }
+
+    spo_main.setCoarse(coarse_fraction);
+    spo_smooth.setCoarse(coarse_fraction);
+    const TinyVector<int, 3> ng = spo_main.Coarse->getGridNum();
+    size_t coarse_bytes         = 0;
+    for (const auto* spline : spo_main.Coarse->einsplines)
+      coarse_bytes += spline->coefs_size * sizeof(RealType);
+    app_log() << "Pseudopotential ratios on the grid " << ng[0] << "x" << ng[1] << "x" << ng[2] << " of " << nx << "x"
+              << ny << "x" << nz << ", " << coarse_bytes / 1024.0 / 1024.0 << " MB:" << std::endl;
+    for (int k = 0; k < 2; k++)
+    {
+      const CoarseRatioErrors e = checkCoarseRatios(k ? spo_smooth : spo_main, ions, nsteps, Rmax);
+      app_log() << (k ? "  smooth orbitals" : "  random orbitals") << " relative RMS error of the ratios = "
+                << std::sqrt(e.ratio_err / e.ratio_ref) << ", evaluateDetRatios time full = " << e.full_time
+                << " s, coarse = " << e.coarse_time << " s, speedup = " << e.full_time / e.coarse_time << std::endl;
+      if (std::sqrt(e.node_err / e.node_ref) > small_v)
+      {
+        app_log() << "Fail in the coarse splines, relative error at the grid points = "
+                  << std::sqrt(e.node_err / e.node_ref) << std::endl;
+        nfail += 1;
+      }
+    }
+  }
+  if (spo_main.Paged)
+    app_log() << "Spline cache hits = " << spo_main.Paged->getHits() << ", misses = " << spo_main.Paged->getMisses()
+              << " of " << spo_main.Paged->getCapacity() << " cached bricks" << std::endl;
   comm.reduce(nfail);
 
   if (nfail == 0)
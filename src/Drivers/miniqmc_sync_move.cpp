@@ -114,9 +114,15 @@
 #include <Input/Input.hpp>
 #include <QMCWaveFunctions/SPOSet.h>
 #include <QMCWaveFunctions/SPOSet_builder.h>
+#include <QMCWaveFunctions/SplineTileProfile.h>
+#include <Utilities/HugePages.h>
+#include <Numerics/Spline2/MultiBsplineSIMD.h>
+#include <Numerics/Spline2/MultiBsplineEvalHelper.hpp>
 #include <QMCWaveFunctions/WaveFunction.h>
+#include <QMCWaveFunctions/DiracMatrix.h>
 #include <Drivers/Mover.hpp>
 #include <getopt.h>
+#include <map>
 
 using namespace std;
 using namespace qmcplusplus;
@@ -150,30 +156,46 @@ void print_help()
 {
   // clang-format off
   app_summary() << "usage:" << '\n';
-  app_summary() << "  miniqmc   [-bhjPvV] [-g \"n0 n1 n2\"] [-m meshfactor]"     << '\n';
+  app_summary() << "  miniqmc   [-bhIjPvVz] [-g \"n0 n1 n2\"] [-m meshfactor]"     << '\n';
   app_summary() << "            [-n steps] [-N substeps] [-x rmax]"              << '\n';
   app_summary() << "            [-r AcceptanceRatio] [-s seed] [-w walkers]"     << '\n';
   app_summary() << "            [-a tile_size] [-t timer_level] [-c nw_b]"       << '\n';
-  app_summary() << "            [-k delay_rank]"                                 << '\n';
+  app_summary() << "            [-k delay_rank] [-R residual] [-d spline_storage]" << '\n';
+  app_summary() << "            [-f coef_file] [-i spline_isa] [-l huge_pages]"  << '\n';
+  app_summary() << "            [-u numa_policy] [-B brick_edge] [-L support]"   << '\n';
+  app_summary() << "            [-C cache_MB] [-q coarse_fraction] [-K inversion]" << '\n';
   app_summary() << "options:"                                                    << '\n';
-  app_summary() << "  -a  size of each spline tile       default: num of orbs"   << '\n';
+  app_summary() << "  -a  size of each spline tile       default: tuned or num of orbs"<< '\n';
   app_summary() << "  -b  use reference implementations  default: off"           << '\n';
+  app_summary() << "  -B  spline brick edge, 0: x-major  default: 0"             << '\n';
+  app_summary() << "  -C  read the bricks of the -f file through a cache of this many MB default: 0 (map)" << '\n';
   app_summary() << "  -c  number of walkers per batch    default: 1"             << '\n';
+  app_summary() << "  -d  spline storage: full|fp16|bf16 default: full"         << '\n';
+  app_summary() << "  -f  mmap spline coefficients file  default: none"         << '\n';
   app_summary() << "  -g  set the 3D tiling.             default: 1 1 1"         << '\n';
   app_summary() << "  -h  print help and exit"                                   << '\n';
+  app_summary() << "  -i  spline kernels: auto|generic|avx2|avx512 default: auto" << '\n';
+  app_summary() << "  -I  store half of the splines using inversion symmetry" << '\n';
   app_summary() << "  -j  enable three body Jastrow      default: off"           << '\n';
+  app_summary() << "  -L  support of each tile, fraction of the cell default: 0 (full cell)" << '\n';
+  app_summary() << "  -l  huge pages: spline,det,dist|all|none default: none"  << '\n';
   app_summary() << "  -m  meshfactor                     default: 1.0"           << '\n';
   app_summary() << "  -n  number of MC steps             default: 5"             << '\n';
   app_summary() << "  -N  number of MC substeps          default: 1"             << '\n';
   app_summary() << "  -P  not running pseudo potential   default: off"           << '\n';
+  app_summary() << "  -q  grid of the pseudopotential ratios, fraction of the spline grid default: 0 (same grid)" << '\n';
   app_summary() << "  -r  set the acceptance ratio.      default: 0.5"           << '\n';
+  app_summary() << "  -R  invert anew when a sampled residual of the inverse exceeds this default: 0 (off)" << '\n';
   app_summary() << "  -s  set the random seed.           default: 11"            << '\n';
   app_summary() << "  -t  timer level: coarse or fine    default: fine"          << '\n';
-  app_summary() << "  -k  matrix delayed update rank     default: 32"            << '\n';
+  app_summary() << "  -k  matrix delayed update rank, auto: tuned at run time default: 32" << '\n';
+  app_summary() << "  -K  matrix inversion: lapack|blocked|auto default: auto" << '\n';
+  app_summary() << "  -u  SPO NUMA policy: none|interleave|replicate default: none" << '\n';
   app_summary() << "  -v  verbose output"                                        << '\n';
   app_summary() << "  -V  print version information and exit"                    << '\n';
   app_summary() << "  -w  number of walker(movers)       default: num of threads"<< '\n';
   app_summary() << "  -x  set the Rmax.                  default: 1.7"           << '\n';
+  app_summary() << "  -z  evaluate the laplacians of the accepted moves once per step default: off" << '\n';
   // clang-format on
 }
 
@@ -206,7 +228,17 @@ int main(int argc, char** argv)
   RealType Rmax(1.7);
   RealType accept  = 0.5;
   int delay_rank = 32;
+  RealType residual_threshold = 0;
+  bool lazy_laplacians        = false;
   bool useRef   = false;
+  spline2::SplineStorage spline_storage = spline2::SplineStorage::FULL;
+  int brick_shift                       = 0;
+  RealType support                      = 0;
+  RealType coarse_fraction              = 0;
+  bool inversion                        = false;
+  size_t cache_MB                       = 0;
+  std::string coef_file;
+  NumaPolicy numa_policy = NumaPolicy::NONE;
   bool enableJ3 = false;
   bool run_pseudo = true;
 
@@ -223,7 +255,7 @@ int main(int argc, char** argv)
   int opt;
   while (optind < argc)
   {
-    if ((opt = getopt(argc, argv, "bhjPvVa:c:g:m:n:N:r:s:t:k:w:x:")) != -1)
+    if ((opt = getopt(argc, argv, "bhIjPvVza:B:c:C:d:f:g:i:l:L:m:n:N:q:r:R:s:t:k:K:u:w:x:")) != -1)
     {
       switch (opt)
       {
@@ -236,6 +268,26 @@ int main(int argc, char** argv)
       case 'c': // number of walkers per batch
         nw_b = atoi(optarg);
         break;
+      case 'C':
+        cache_MB = atoi(optarg);
+        break;
+      case 'B':
+        if (!spline2::parseBrickEdge(atoi(optarg), brick_shift))
+        {
+          app_error() << "Spline brick edge should be 0 or a power of 2 up to 64, given: " << optarg << endl;
+          return 1;
+        }
+        break;
+      case 'd':
+        if (!spline2::parseSplineStorage(optarg, spline_storage))
+        {
+          app_error() << "Spline storage should be 'full', 'fp16' or 'bf16', name given: " << optarg << endl;
+          return 1;
+        }
+        break;
+      case 'f':
+        coef_file = optarg;
+        break;
       case 'g': // tiling1 tiling2 tiling3
         sscanf(optarg, "%d %d %d", &na, &nb, &nc);
         break;
@@ -243,6 +295,9 @@ int main(int argc, char** argv)
         print_help();
         return 1;
         break;
+      case 'I':
+        inversion = true;
+        break;
       case 'j':
         enableJ3 = true;
         break;
@@ -266,6 +321,9 @@ int main(int argc, char** argv)
       case 'r':
         accept = atof(optarg);
         break;
+      case 'R':
+        residual_threshold = atof(optarg);
+        break;
       case 's':
         iseed = atoi(optarg);
         break;
@@ -273,7 +331,56 @@ int main(int argc, char** argv)
         timer_level_name = std::string(optarg);
         break;
       case 'k':
-        delay_rank = atoi(optarg);
+        // 0 for a delay rank tuned at run time
+        delay_rank = std::string(optarg) == "auto" ? 0 : atoi(optarg);
+        break;
+      case 'K':
+      {
+        InverseKernel kernel;
+        if (!parseInverseKernel(optarg, kernel))
+        {
+          app_error() << "Matrix inversion should be 'lapack', 'blocked' or 'auto', name given: " << optarg << endl;
+          return 1;
+        }
+        setInverseKernel(kernel);
+      }
+      break;
+      case 'i':
+      {
+        spline2::SplineISA isa;
+        if (!spline2::parseSplineISA(optarg, isa))
+        {
+          app_error() << "Spline kernels should be 'auto', 'generic', 'avx2' or 'avx512', name given: " << optarg
+                      << endl;
+          return 1;
+        }
+        if (!spline2::setSplineISA(isa))
+        {
+          app_error() << "Spline kernels " << optarg << " are not supported on this CPU" << endl;
+          return 1;
+        }
+      }
+      break;
+      case 'l':
+        if (!parseHugePagePolicy(optarg))
+        {
+          app_error() << "Huge pages should be a list of 'spline', 'det' and 'dist', or 'all' or 'none', given: "
+                      << optarg << endl;
+          return 1;
+        }
+        break;
+      case 'L':
+        support = atof(optarg);
+        break;
+      case 'q':
+        coarse_fraction = atof(optarg);
+        break;
+      case 'u':
+        if (!parseNumaPolicy(optarg, numa_policy))
+        {
+          app_error() << "NUMA policy should be 'none', 'interleave' or 'replicate', name given: " << optarg << endl;
+          return 1;
+        }
         break;
       case 'v':
         verbose = true;
@@ -288,6 +395,9 @@ int main(int argc, char** argv)
       case 'x': // rmax
         Rmax = atof(optarg);
         break;
+      case 'z':
+        lazy_laplacians = true;
+        break;
       default:
         print_help();
         return 1;
@@ -327,6 +437,12 @@ int main(int argc, char** argv)
   TimerList_t Timers;
   setup_timers(Timers, MiniQMCTimerNames, timer_level_coarse);
 
+  if (cache_MB > 0 && (coef_file.empty() || brick_shift == 0))
+  {
+    app_error() << "Paging the spline coefficients requires a file (-f) with the brick layout (-B)" << endl;
+    return 1;
+  }
+
   if (comm.root())
   {
     if (verbose)
@@ -348,17 +464,26 @@ int main(int argc, char** argv)
     build_ions(ions, tmat, lattice_b);
     const int nels = count_electrons(ions, 1);
     const int norb = nels / 2;
-    tileSize       = (tileSize > 0) ? tileSize : norb;
+    // without -a, the tile size tuned by tune_spo on this host if any
+    std::string tile_source = "-a";
+    if (tileSize <= 0)
+    {
+      tileSize    = loadTileSize(getTileProfileName(),
+                              getSplineTileKey<RealType>(nx, ny, nz, norb, spline_storage, brick_shift));
+      tile_source = (tileSize > 0) ? getTileProfileName() : "default";
+    }
+    tileSize = (tileSize > 0) ? tileSize : norb;
     nTiles         = norb / tileSize;
 
     number_of_electrons = nels;
 
     const size_t SPO_coeff_size =
-        static_cast<size_t>(norb) * (nx + 3) * (ny + 3) * (nz + 3) * sizeof(RealType);
+        static_cast<size_t>(norb) * (inversion ? nx / 2 + 4 : nx + 3) * (ny + 3) * (nz + 3) *
+        spline2::getSplineStorageBytes(spline_storage, sizeof(RealType));
     const double SPO_coeff_size_MB = SPO_coeff_size * 1.0 / 1024 / 1024;
 
     app_summary() << "Number of orbitals/splines = " << norb << endl
-                  << "Tile size = " << tileSize << endl
+                  << "Tile size = " << tileSize << " (" << tile_source << ")" << endl
                   << "Number of tiles = " << nTiles << endl
                   << "Number of electrons = " << nels << endl
                   << "Rmax = " << Rmax << endl
@@ -373,9 +498,27 @@ int main(int argc, char** argv)
 
     app_summary() << "\nSPO coefficients size = " << SPO_coeff_size << " bytes ("
                   << SPO_coeff_size_MB << " MB)" << endl;
-    app_summary() << "delayed update rank = " << delay_rank << endl;
-
-    spo_main = build_SPOSet(useRef, nx, ny, nz, norb, nTiles, lattice_b);
+    app_summary() << "SPO coefficients storage = " << spline2::getSplineStorageName(spline_storage) << endl;
+    app_summary() << "SPO coefficients layout = " << spline2::getSplineLayoutName(brick_shift) << endl;
+    if (inversion)
+      app_summary() << "SPO inversion symmetry = half of the grid stored" << endl;
+    if (support > 0 && support < 1)
+      app_summary() << "SPO orbital support = " << support << " of the cell edge per tile" << endl;
+    if (coarse_fraction > 0 && coarse_fraction < 1)
+      app_summary() << "SPO pseudopotential ratios grid = " << coarse_fraction << " of the spline grid" << endl;
+    app_summary() << "SPO kernels = " << spline2::getSplineISAName(spline2::getSplineISA()) << endl;
+    if (delay_rank > 0)
+      app_summary() << "delayed update rank = " << delay_rank << endl;
+    else
+      app_summary() << "delayed update rank = auto, tuned at run time" << endl;
+    app_summary() << "matrix inversion = " << getInverseKernelName(getInverseKernel()) << endl;
+    if (residual_threshold > 0)
+      app_summary() << "inverse residual threshold = " << residual_threshold << endl;
+    app_summary() << "lazy laplacians = " << (lazy_laplacians ? "on" : "off") << endl;
+    app_summary() << "huge pages = " << getHugePagePolicyName() << endl;
+
+    spo_main = build_SPOSet(useRef, nx, ny, nz, norb, nTiles, lattice_b, true, spline_storage, coef_file, numa_policy,
+                            brick_shift, support, inversion, cache_MB << 20, coarse_fraction);
     Timers[Timer_Setup]->stop();
   }
 
@@ -401,7 +544,8 @@ int main(int argc, char** argv)
     mover_list[iw]    = thiswalker;
 
     // create wavefunction per mover
-    build_WaveFunction(useRef, spo_main, thiswalker->wavefunction, ions, thiswalker->els, thiswalker->rng, delay_rank, enableJ3);
+    build_WaveFunction(useRef, spo_main, thiswalker->wavefunction, ions, thiswalker->els, thiswalker->rng, delay_rank,
+                       residual_threshold, lazy_laplacians, enableJ3, 1);
 
     // initialize virtual particle sets
     thiswalker->nlpp.initialize_VPs(ions, thiswalker->els, Rmax);
@@ -521,6 +665,20 @@ int main(int argc, char** argv)
     } // batch
   } // nsteps
   Timers[Timer_Total]->stop();
+  const std::vector<HugePageUsage> huge_page_usage = getHugePageUsage();
+  // number of determinants using each delay rank at the end of the run
+  std::map<int, int> delay_rank_counts;
+  int num_reinversions = 0;
+  for (auto mover : mover_list)
+  {
+    for (int rank : mover->wavefunction.getDelayRanks())
+      delay_rank_counts[rank]++;
+    num_reinversions += mover->wavefunction.getNumReinversions();
+  }
+  const int delay_rank_used = std::max_element(delay_rank_counts.begin(), delay_rank_counts.end(),
+                                               [](const std::pair<const int, int>& a,
+                                                  const std::pair<const int, int>& b) { return a.second < b.second; })
+                                  ->first;
 
   // free all movers
   #pragma omp parallel for
@@ -545,6 +703,29 @@ int main(int argc, char** argv)
            << (nmovers * comm.size() * std::pow(double(nels),2) / Timers[Timer_ECP]->get_total()) << std::endl;
     cout << endl;
 
+    if (getHugePagePolicyName() != "none")
+    {
+      cout << "========== Huge pages ============ " << endl << endl;
+      printHugePageUsage(cout, huge_page_usage);
+      cout << endl;
+    }
+
+    if (delay_rank <= 0)
+    {
+      cout << "========== Delayed update ======== " << endl << endl;
+      cout << "delayed update rank = " << delay_rank_used << endl;
+      for (auto& rank_count : delay_rank_counts)
+        cout << "  rank " << rank_count.first << " used by " << rank_count.second << " determinants" << endl;
+      cout << endl;
+    }
+
+    if (residual_threshold > 0)
+    {
+      cout << "========== Inverse residual ====== " << endl << endl;
+      cout << "inversions anew after a residual above " << residual_threshold << " = " << num_reinversions << endl;
+      cout << endl;
+    }
+
     XMLDocument doc;
     XMLNode* resources = doc.NewElement("resources");
     XMLNode* hardware  = doc.NewElement("hardware");
@@ -566,6 +747,9 @@ int main(int argc, char** argv)
     driver_info->InsertEndChild(MakeTextElement(doc, "name", "miniqmc"));
     driver_info->InsertEndChild(MakeTextElement(doc, "steps", std::to_string(nsteps)));
     driver_info->InsertEndChild(MakeTextElement(doc, "substeps", std::to_string(nsubsteps)));
+    driver_info->InsertEndChild(MakeTextElement(doc, "delay_rank", std::to_string(delay_rank_used)));
+    driver_info->InsertEndChild(MakeTextElement(doc, "delay_rank_tuned", delay_rank > 0 ? "no" : "yes"));
+    driver_info->InsertEndChild(MakeTextElement(doc, "reinversions", std::to_string(num_reinversions)));
     run_info->InsertEndChild(driver_info);
     resources->InsertEndChild(run_info);
 
@@ -0,0 +1,279 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file tune_spo.cpp
+ * @brief Miniapp to tune the spline tile size on this host.
+ *
+ * Every tile size dividing the number of orbitals into SIMD aligned tiles is
+ * timed with evaluate_v and evaluate_vgh on the actual mesh, with all the
+ * threads running their own walker. The fastest one is saved in the per-host
+ * profile read by miniqmc and miniqmc_sync_move when -a is not given.
+ */
+#include <Utilities/Configuration.h>
+#include <Utilities/Communicate.h>
+#include <Particle/ParticleSet.h>
+#include <Particle/ParticleSet_builder.hpp>
+#include <Utilities/RandomGenerator.h>
+#include <Input/Input.hpp>
+#include <QMCWaveFunctions/einspline_spo.hpp>
+#include <QMCWaveFunctions/SplineTileProfile.h>
+#include <Numerics/Spline2/MultiBsplineSIMD.h>
+#include <Numerics/Spline2/MultiBsplineEvalHelper.hpp>
+#include <Utilities/qmcpack_version.h>
+#include <getopt.h>
+
+using namespace std;
+using namespace qmcplusplus;
+
+void print_help()
+{
+  // clang-format off
+  app_summary() << "usage:" << '\n';
+  app_summary() << "  tune_spo  [-hvV] [-g \"n0 n1 n2\"] [-m meshfactor]"        << '\n';
+  app_summary() << "            [-n steps] [-o profile]"                        << '\n';
+  app_summary() << "            [-d spline_storage] [-i spline_isa] [-B brick_edge]" << '\n';
+  app_summary() << "options:"                                                    << '\n';
+  app_summary() << "  -B  spline brick edge, 0: x-major  default: 0"             << '\n';
+  app_summary() << "  -d  spline storage: full|fp16|bf16 default: full"         << '\n';
+  app_summary() << "  -g  set the 3D tiling.             default: 1 1 1"         << '\n';
+  app_summary() << "  -h  print help and exit"                                   << '\n';
+  app_summary() << "  -i  spline kernels: auto|generic|avx2|avx512 default: auto" << '\n';
+  app_summary() << "  -m  meshfactor                     default: 1.0"           << '\n';
+  app_summary() << "  -n  number of timed sweeps         default: 5"             << '\n';
+  app_summary() << "  -o  tile profile                   default: $MINIQMC_TILE_PROFILE or spline_tiles.<host>.txt" << '\n';
+  app_summary() << "  -v  verbose output"                                        << '\n';
+  app_summary() << "  -V  print version information and exit"                    << '\n';
+  // clang-format on
+
+  exit(1); // print help and exit
+}
+
+int main(int argc, char** argv)
+{
+  // clang-format off
+  typedef QMCTraits::RealType           RealType;
+  typedef ParticleSet::ParticlePos_t    ParticlePos_t;
+  // clang-format on
+
+  Communicate comm(argc, argv);
+
+  int na     = 1;
+  int nb     = 1;
+  int nc     = 1;
+  int nsteps = 5;
+  int nx = 37, ny = 37, nz = 37;
+
+  bool verbose = false;
+
+  spline2::SplineStorage spline_storage = spline2::SplineStorage::FULL;
+  int brick_shift                       = 0;
+  std::string profile_name              = getTileProfileName();
+
+  if (!comm.root())
+  {
+    outputManager.shutOff();
+  }
+
+  int opt;
+  while (optind < argc)
+  {
+    if ((opt = getopt(argc, argv, "hvVB:d:g:i:m:n:o:")) != -1)
+    {
+      switch (opt)
+      {
+      case 'B':
+        if (!spline2::parseBrickEdge(atoi(optarg), brick_shift))
+        {
+          app_error() << "Spline brick edge should be 0 or a power of 2 up to 64, given: " << optarg << endl;
+          return 1;
+        }
+        break;
+      case 'd':
+        if (!spline2::parseSplineStorage(optarg, spline_storage))
+        {
+          app_error() << "Spline storage should be 'full', 'fp16' or 'bf16', name given: " << optarg << endl;
+          return 1;
+        }
+        break;
+      case 'g': // tiling1 tiling2 tiling3
+        sscanf(optarg, "%d %d %d", &na, &nb, &nc);
+        break;
+      case 'h':
+        print_help();
+        break;
+      case 'i':
+      {
+        spline2::SplineISA isa;
+        if (!spline2::parseSplineISA(optarg, isa))
+        {
+          app_error() << "Spline kernels should be 'auto', 'generic', 'avx2' or 'avx512', name given: " << optarg
+                      << endl;
+          return 1;
+        }
+        if (!spline2::setSplineISA(isa))
+        {
+          app_error() << "Spline kernels " << optarg << " are not supported on this CPU" << endl;
+          return 1;
+        }
+      }
+      break;
+      case 'm':
+      {
+        const RealType meshfactor = atof(optarg);
+        nx *= meshfactor;
+        ny *= meshfactor;
+        nz *= meshfactor;
+      }
+      break;
+      case 'n':
+        nsteps = atoi(optarg);
+        break;
+      case 'o':
+        profile_name = optarg;
+        break;
+      case 'v':
+        verbose = true;
+        break;
+      case 'V':
+        print_version(true);
+        return 1;
+        break;
+      default:
+        print_help();
+      }
+    }
+    else // disallow non-option arguments
+    {
+      app_error() << "Non-option arguments not allowed" << endl;
+      print_help();
+    }
+  }
+
+  if (comm.root())
+  {
+    if (verbose)
+      outputManager.setVerbosity(Verbosity::HIGH);
+    else
+      outputManager.setVerbosity(Verbosity::LOW);
+  }
+
+  print_version(verbose);
+
+  Tensor<int, 3> tmat(na, 0, 0, 0, nb, 0, 0, 0, nc);
+
+  using spo_type = einspline_spo<OHMMS_PRECISION>;
+
+  ParticleSet ions;
+  Tensor<OHMMS_PRECISION, 3> lattice_b;
+  build_ions(ions, tmat, lattice_b);
+  const int norb = count_electrons(ions, 1) / 2;
+
+  const SplineTileKey key = getSplineTileKey<RealType>(nx, ny, nz, norb, spline_storage, brick_shift);
+
+  const std::vector<int> candidates = getTileSizeCandidates<RealType>(norb);
+
+  app_summary() << "Number of orbitals/splines = " << norb << endl
+                << "Grid = " << nx << " x " << ny << " x " << nz << endl
+                << "Iterations = " << nsteps << endl
+                << "OpenMP threads = " << omp_get_max_threads() << endl
+                << "SPO coefficients storage = " << spline2::getSplineStorageName(spline_storage) << endl
+                << "SPO coefficients layout = " << spline2::getSplineLayoutName(brick_shift) << endl
+                << "SPO kernels = " << key.kernels << endl
+                << "Candidate tile sizes =";
+  for (int ts : candidates)
+    app_summary() << " " << ts;
+  app_summary() << endl << endl;
+
+  int best_size    = norb;
+  double best_time = std::numeric_limits<double>::max();
+  app_summary() << "  tile size  tiles  evaluate_v (us)  evaluate_vgh (us)" << endl;
+  for (int tileSize : candidates)
+  {
+    const int nTiles = norb / tileSize;
+    spo_type spo_main;
+    spo_main.set(nx, ny, nz, norb, nTiles, true, spline_storage, brick_shift);
+    spo_main.Lattice.set(lattice_b);
+
+    double time_v = 0.0, time_vgh = 0.0, num_calls = 0.0;
+#pragma omp parallel reduction(+ : num_calls)
+    {
+      const int np = omp_get_num_threads();
+      const int ip = omp_get_thread_num();
+
+      // the same walkers for every candidate
+      RandomGenerator<RealType> random_th(MakeSeed(ip, np));
+      ParticleSet els;
+      build_els(els, ions, random_th);
+      els.update();
+      const int nels = els.getTotalNum();
+
+      spo_type spo(spo_main, 1, 0);
+      ParticlePos_t delta(nels);
+
+      // the first sweep touches the coefficients and is not timed
+      for (int mc = -1; mc < nsteps; ++mc)
+      {
+        random_th.generate_normal(&delta[0][0], 3 * nels);
+#pragma omp barrier
+        double t0 = omp_get_wtime();
+        for (int iel = 0; iel < nels; ++iel)
+        {
+          els.makeMove(iel, delta[iel]);
+          spo.evaluate_vgh(els, iel);
+          els.rejectMove(iel);
+        }
+#pragma omp barrier
+        double t1 = omp_get_wtime();
+        for (int iel = 0; iel < nels; ++iel)
+        {
+          els.makeMove(iel, delta[iel]);
+          spo.evaluate_v(els, iel);
+          els.rejectMove(iel);
+        }
+#pragma omp barrier
+        double t2 = omp_get_wtime();
+        if (mc >= 0)
+        {
+#pragma omp master
+          {
+            time_vgh += t1 - t0;
+            time_v += t2 - t1;
+          }
+          num_calls += nels;
+        }
+      }
+    }
+    // wall time per call of a walker
+    const double calls_per_thread = num_calls / omp_get_max_threads();
+    const double us_v             = time_v / calls_per_thread * 1e6;
+    const double us_vgh           = time_vgh / calls_per_thread * 1e6;
+    app_summary() << std::setw(11) << tileSize << std::setw(7) << nTiles << std::setw(17) << us_v << std::setw(19)
+                  << us_vgh << endl;
+    if (us_v + us_vgh < best_time)
+    {
+      best_time = us_v + us_vgh;
+      best_size = tileSize;
+    }
+  }
+
+  app_summary() << endl << "Best tile size = " << best_size << endl;
+  if (comm.root())
+  {
+    if (!saveTileSize(profile_name, key, best_size, best_time))
+    {
+      app_error() << "Cannot write the tile profile " << profile_name << endl;
+      return 1;
+    }
+    app_summary() << "Tile profile written to " << profile_name << endl;
+  }
+
+  return 0;
+}
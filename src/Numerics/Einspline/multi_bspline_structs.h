@@ -33,6 +33,11 @@ struct multi_UBspline_3d_s
   type_code tcode;
   float* restrict coefs;
   intptr_t x_stride, y_stride, z_stride;
+  // log2 of the brick edge (0: x-major) and the strides between bricks
+  int brick_shift;
+  intptr_t x_brick_stride, y_brick_stride, z_brick_stride;
+  // parity of the splines under inversion, 0 if the whole grid is stored, +-1 if only x <= 1/2 is
+  int inversion;
   Ugrid x_grid, y_grid, z_grid;
   BCtype_s xBC, yBC, zBC;
   int num_splines;
@@ -48,6 +53,11 @@ struct multi_UBspline_3d_d
   type_code tcode;
   double* restrict coefs;
   intptr_t x_stride, y_stride, z_stride;
+  // log2 of the brick edge (0: x-major) and the strides between bricks
+  int brick_shift;
+  intptr_t x_brick_stride, y_brick_stride, z_brick_stride;
+  // parity of the splines under inversion, 0 if the whole grid is stored, +-1 if only x <= 1/2 is
+  int inversion;
   Ugrid x_grid, y_grid, z_grid;
   BCtype_d xBC, yBC, zBC;
   int num_splines;
@@ -0,0 +1,237 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file SolidHarmonics.h
+ * @brief Real solid harmonics as polynomials of the Cartesian coordinates
+ */
+#ifndef QMCPLUSPLUS_SOLID_HARMONICS_H
+#define QMCPLUSPLUS_SOLID_HARMONICS_H
+
+#include <array>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <Utilities/Constants.h>
+#include <Numerics/OhmmsPETE/TinyVector.h>
+
+namespace qmcplusplus
+{
+/** real solid harmonics \f$S_{lm}({\bf r}) = r^l Y_{lm}(\hat{r})\f$ up to lmax
+ *
+ * Y_lm are the orthonormal real spherical harmonics indexed by lm = l*(l+1)+m, -l<=m<=l,
+ * with cos(m phi) for m>0 and sin(|m| phi) for m<0. Each S_lm is a homogeneous polynomial
+ * of degree l stored as the coefficients of its monomials x^a y^b z^c, built once from
+ * the explicit formula of the Racah normalized solid harmonics.
+ */
+template<typename T>
+class SolidHarmonics
+{
+public:
+  explicit SolidHarmonics(int lmax) : Lmax(lmax), L((lmax + 1) * (lmax + 1))
+  {
+    if (lmax < 0 || lmax + 3 > MaxPower)
+      throw std::runtime_error("SolidHarmonics supports lmax from 0 to " + std::to_string(MaxPower - 3));
+    using Monomial   = std::array<int, 3>;
+    using Polynomial = std::map<Monomial, double>;
+    auto multiply    = [](const Polynomial& p, const Polynomial& q) {
+      Polynomial pq;
+      for (const auto& tp : p)
+        for (const auto& tq : q)
+        {
+          const Monomial e = {tp.first[0] + tq.first[0], tp.first[1] + tq.first[1], tp.first[2] + tq.first[2]};
+          pq[e] += tp.second * tq.second;
+        }
+      return pq;
+    };
+    auto factorial = [](int n) {
+      double f = 1;
+      for (int i = 2; i <= n; i++)
+        f *= i;
+      return f;
+    };
+    auto binomial = [&factorial](int n, int k) { return factorial(n) / (factorial(k) * factorial(n - k)); };
+
+    const Polynomial r2 = {{{2, 0, 0}, 1.0}, {{0, 2, 0}, 1.0}, {{0, 0, 2}, 1.0}};
+    for (int l = 0; l <= Lmax; l++)
+      for (int m = 0; m <= l; m++)
+      {
+        // Pi_l^m(z, r) without the normalization
+        Polynomial pi;
+        Polynomial r2k = {{{0, 0, 0}, 1.0}};
+        for (int k = 0; 2 * k <= l - m; k++)
+        {
+          const double coef = ((k % 2) ? -1.0 : 1.0) * std::pow(2.0, -l) * binomial(l, k) * binomial(2 * l - 2 * k, l) *
+              factorial(l - 2 * k) / factorial(l - 2 * k - m);
+          for (const auto& t : r2k)
+            pi[{t.first[0], t.first[1], t.first[2] + l - 2 * k - m}] += coef * t.second;
+          r2k = multiply(r2k, r2);
+        }
+        double norm = std::sqrt((2 * l + 1) / (4 * M_PI) * factorial(l - m) / factorial(l + m));
+        if (m == 0)
+        {
+          addTerms(l * (l + 1), pi, norm);
+          continue;
+        }
+        // A_m and B_m, the real and imaginary parts of (x + iy)^m
+        norm *= std::sqrt(2.0);
+        Polynomial am, bm;
+        for (int p = 0; p <= m; p++)
+        {
+          const int phase = (m - p) % 4;
+          if (phase == 0 || phase == 2)
+            am[{p, m - p, 0}] += (phase == 0 ? 1.0 : -1.0) * binomial(m, p);
+          else
+            bm[{p, m - p, 0}] += (phase == 1 ? 1.0 : -1.0) * binomial(m, p);
+        }
+        addTerms(l * (l + 1) + m, multiply(pi, am), norm);
+        addTerms(l * (l + 1) - m, multiply(pi, bm), norm);
+      }
+  }
+
+  /// maximum angular momentum
+  inline int getLmax() const { return Lmax; }
+  /// number of harmonics, (lmax+1)^2
+  inline int size() const { return L.size(); }
+  /// angular momentum of the lm-th harmonic
+  inline int getL(int lm) const { return L[lm]; }
+
+  /// evaluate the values of all the harmonics at (x,y,z)
+  inline void evaluate(T x, T y, T z, T* restrict vals) const
+  {
+    T px[MaxPower], py[MaxPower], pz[MaxPower];
+    computePowers(x, y, z, px, py, pz);
+    std::fill(vals, vals + size(), T(0));
+    for (const Term& t : Terms)
+      vals[t.lm] += t.coef * px[t.e[0] + 2] * py[t.e[1] + 2] * pz[t.e[2] + 2];
+  }
+
+  /** evaluate the values, gradients and Hessians of all the harmonics at (x,y,z)
+   * @param grads gradients, x, y and z components each of size()
+   * @param hess Hessians, xx, xy, xz, yy, yz and zz components each of size()
+   */
+  inline void evaluateVGH(T x, T y, T z, T* restrict vals, T* restrict grads, T* restrict hess) const
+  {
+    T px[MaxPower], py[MaxPower], pz[MaxPower];
+    computePowers(x, y, z, px, py, pz);
+    const int n = size();
+    std::fill(vals, vals + n, T(0));
+    std::fill(grads, grads + 3 * n, T(0));
+    std::fill(hess, hess + 6 * n, T(0));
+    for (const Term& t : Terms)
+    {
+      // powers with the exponents shifted by 2, negative exponents are 0
+      const int a = t.e[0] + 2, b = t.e[1] + 2, c = t.e[2] + 2;
+      const T ca = t.coef * t.e[0], cb = t.coef * t.e[1], cc = t.coef * t.e[2];
+      vals[t.lm] += t.coef * px[a] * py[b] * pz[c];
+      grads[t.lm] += ca * px[a - 1] * py[b] * pz[c];
+      grads[n + t.lm] += cb * px[a] * py[b - 1] * pz[c];
+      grads[2 * n + t.lm] += cc * px[a] * py[b] * pz[c - 1];
+      hess[t.lm] += ca * (t.e[0] - 1) * px[a - 2] * py[b] * pz[c];
+      hess[n + t.lm] += ca * t.e[1] * px[a - 1] * py[b - 1] * pz[c];
+      hess[2 * n + t.lm] += ca * t.e[2] * px[a - 1] * py[b] * pz[c - 1];
+      hess[3 * n + t.lm] += cb * (t.e[1] - 1) * px[a] * py[b - 2] * pz[c];
+      hess[4 * n + t.lm] += cb * t.e[2] * px[a] * py[b - 1] * pz[c - 1];
+      hess[5 * n + t.lm] += cc * (t.e[2] - 1) * px[a] * py[b] * pz[c - 2];
+    }
+  }
+
+  /** product quadrature on the unit sphere
+   * @param degree the spherical polynomials up to this degree are integrated exactly
+   * @param dirs directions of the quadrature points
+   * @param weights weights of the points, they sum to 4 pi
+   *
+   * Gauss-Legendre points in cos(theta) times uniform points in phi.
+   */
+  static void getQuadrature(int degree, std::vector<TinyVector<T, 3>>& dirs, std::vector<T>& weights)
+  {
+    const int ntheta = degree / 2 + 1;
+    const int nphi   = degree + 1;
+    std::vector<double> x(ntheta), w(ntheta);
+    // Newton iterations on the Legendre polynomial of order ntheta
+    for (int i = 0; i < ntheta; i++)
+    {
+      double xi = std::cos(M_PI * (i + 0.75) / (ntheta + 0.5));
+      double dp = 1;
+      for (int iter = 0; iter < 100; iter++)
+      {
+        double p0 = 1, p1 = xi;
+        for (int k = 2; k <= ntheta; k++)
+        {
+          const double p2 = ((2 * k - 1) * xi * p1 - (k - 1) * p0) / k;
+          p0              = p1;
+          p1              = p2;
+        }
+        dp              = ntheta * (xi * p1 - p0) / (xi * xi - 1);
+        const double dx = p1 / dp;
+        xi -= dx;
+        if (std::abs(dx) < 1e-15)
+          break;
+      }
+      x[i] = xi;
+      w[i] = 2 / ((1 - xi * xi) * dp * dp);
+    }
+    dirs.clear();
+    weights.clear();
+    for (int i = 0; i < ntheta; i++)
+    {
+      const double sin_theta = std::sqrt(1 - x[i] * x[i]);
+      for (int j = 0; j < nphi; j++)
+      {
+        const double phi = 2 * M_PI * j / nphi;
+        dirs.push_back(TinyVector<T, 3>(sin_theta * std::cos(phi), sin_theta * std::sin(phi), x[i]));
+        weights.push_back(w[i] * 2 * M_PI / nphi);
+      }
+    }
+  }
+
+private:
+  /// x^a y^b z^c of a harmonic
+  struct Term
+  {
+    int lm;
+    std::array<int, 3> e;
+    T coef;
+  };
+
+  static constexpr int MaxPower = 16;
+
+  int Lmax;
+  /// angular momentum of each harmonic
+  std::vector<int> L;
+  std::vector<Term> Terms;
+
+  template<typename Polynomial>
+  void addTerms(int lm, const Polynomial& p, double norm)
+  {
+    L[lm] = static_cast<int>(std::sqrt(lm + 0.5));
+    for (const auto& t : p)
+      if (t.second != 0.0)
+        Terms.push_back(Term{lm, t.first, static_cast<T>(t.second * norm)});
+  }
+
+  /// powers 0..lmax of x, y and z at the indices 2.., the first two are 0 for the derivatives
+  inline void computePowers(T x, T y, T z, T* px, T* py, T* pz) const
+  {
+    px[0] = px[1] = py[0] = py[1] = pz[0] = pz[1] = T(0);
+    px[2] = py[2] = pz[2] = T(1);
+    for (int k = 1; k <= Lmax; k++)
+    {
+      px[k + 2] = px[k + 1] * x;
+      py[k + 2] = py[k + 1] * y;
+      pz[k + 2] = pz[k + 1] * z;
+    }
+  }
+};
+
+} // namespace qmcplusplus
+#endif
@@ -16,8 +16,10 @@
 #define QMCPLUSPLUS_EINSPLINE_BSPLINE_ALLOCATOR_H
 
 #include "Utilities/SIMD/Mallocator.hpp"
+#include "Utilities/NumaTools.h"
 #include <cmath>
 #include "Numerics/Spline2/bspline_traits.hpp"
+#include "Numerics/Spline2/MultiBsplineEvalHelper.hpp"
 #include <Numerics/OhmmsPETE/OhmmsArray.h>
 
 namespace qmcplusplus
@@ -50,9 +52,25 @@ public:
     delete (spline);
   }
 
-  ///allocate a multi-bspline structure
-  SplineType* allocateMultiBspline(
-      Ugrid x_grid, Ugrid y_grid, Ugrid z_grid, BCType xBC, BCType yBC, BCType zBC, int num_splines);
+  /** allocate a multi-bspline structure
+   * @param brick_shift log2 of the edge of the coefficient bricks, 0 for the x-major layout
+   * @param inversion parity of the splines under inversion, 0 to store the whole grid
+   *
+   * With bricks, the grid is padded to whole bricks of 2^brick_shift points along each
+   * direction. The bricks are stored x-major and the points of a brick are contiguous,
+   * so that the 4x4x4 stencil of an evaluation spans at most 8 compact regions.
+   * With inversion symmetry, only the x planes up to the middle of the periodic grid are
+   * allocated, see spline2::foldInversion.
+   */
+  SplineType* allocateMultiBspline(Ugrid x_grid,
+                                   Ugrid y_grid,
+                                   Ugrid z_grid,
+                                   BCType xBC,
+                                   BCType yBC,
+                                   BCType zBC,
+                                   int num_splines,
+                                   int brick_shift = 0,
+                                   int inversion   = 0);
 
   /** allocate a multi_UBspline_3d_(s,d)
    * @tparam T datatype
@@ -60,8 +78,14 @@ public:
    * @tparam IntT 3D container for ng
    */
   template<typename ValT, typename IntT>
-  typename bspline_traits<T, 3>::SplineType*
-  createMultiBspline(T dummy, ValT& start, ValT& end, IntT& ng, bc_code bc, int num_splines);
+  typename bspline_traits<T, 3>::SplineType* createMultiBspline(T dummy,
+                                                                ValT& start,
+                                                                ValT& end,
+                                                                IntT& ng,
+                                                                bc_code bc,
+                                                                int num_splines,
+                                                                int brick_shift = 0,
+                                                                int inversion   = 0);
 
   /** Set coefficients for a single orbital (band)
    * @param i index of the orbital
@@ -79,12 +103,28 @@ public:
      */
   template<typename UBT, typename MBT>
   void copy(UBT* single, MBT* multi, int i, const int* offset, const int* N);
+
+  /** create a multi-bspline with the coefficients of another one converted to T
+   * @param in source multi-bspline of any precision
+   * @param numa_node NUMA domain to place the coefficients, -1 for first touch
+   *
+   * Grids, boundary conditions and the layout are copied, padded coefficients are zeroed.
+   */
+  template<typename MBT>
+  SplineType* createConvertedMultiBspline(const MBT* in, int numa_node = -1);
 };
 
 template<typename T, size_t ALIGN, typename ALLOC>
 typename BsplineAllocator<T, ALIGN, ALLOC>::SplineType*
-BsplineAllocator<T, ALIGN, ALLOC>::allocateMultiBspline(
-    Ugrid x_grid, Ugrid y_grid, Ugrid z_grid, BCType xBC, BCType yBC, BCType zBC, int num_splines)
+BsplineAllocator<T, ALIGN, ALLOC>::allocateMultiBspline(Ugrid x_grid,
+                                                        Ugrid y_grid,
+                                                        Ugrid z_grid,
+                                                        BCType xBC,
+                                                        BCType yBC,
+                                                        BCType zBC,
+                                                        int num_splines,
+                                                        int brick_shift,
+                                                        int inversion)
 {
   // Create new spline
   SplineType* restrict spline = new SplineType;
@@ -92,6 +132,7 @@ BsplineAllocator<T, ALIGN, ALLOC>::allocateMultiBspline(
   spline->yBC                 = yBC;
   spline->zBC                 = zBC;
   spline->num_splines         = num_splines;
+  spline->inversion           = inversion;
 
   // Setup internal variables
   int Mx = x_grid.num;
@@ -124,12 +165,40 @@ BsplineAllocator<T, ALIGN, ALLOC>::allocateMultiBspline(
   spline->z_grid   = z_grid;
 
   const int N = getAlignedSize<real_type, ALIGN>(num_splines);
+  // only the x planes of the irreducible half are stored with inversion symmetry
+  if (inversion)
+    Nx = spline2::getStoredPlanesX(spline);
+
+  spline->brick_shift = brick_shift;
+  if (brick_shift == 0)
+  {
+    spline->x_stride = (size_t)Ny * (size_t)Nz * (size_t)N;
+    spline->y_stride = Nz * N;
+    spline->z_stride = N;
+
+    spline->x_brick_stride = spline->x_stride;
+    spline->y_brick_stride = spline->y_stride;
+    spline->z_brick_stride = spline->z_stride;
+
+    spline->coefs_size = (size_t)Nx * spline->x_stride;
+  }
+  else
+  {
+    const int B   = 1 << brick_shift;
+    const int NBy = (Ny + B - 1) / B;
+    const int NBz = (Nz + B - 1) / B;
+    const int NBx = (Nx + B - 1) / B;
+
+    spline->x_stride = (size_t)B * B * N;
+    spline->y_stride = (size_t)B * N;
+    spline->z_stride = N;
 
-  spline->x_stride = (size_t)Ny * (size_t)Nz * (size_t)N;
-  spline->y_stride = Nz * N;
-  spline->z_stride = N;
+    spline->z_brick_stride = (size_t)B * B * B * N;
+    spline->y_brick_stride = NBz * spline->z_brick_stride;
+    spline->x_brick_stride = NBy * spline->y_brick_stride;
 
-  spline->coefs_size = (size_t)Nx * spline->x_stride;
+    spline->coefs_size = (size_t)NBx * spline->x_brick_stride;
+  }
   spline->coefs      = mAllocator.allocate(spline->coefs_size);
 
   return spline;
@@ -138,7 +207,7 @@ BsplineAllocator<T, ALIGN, ALLOC>::allocateMultiBspline(
 template<typename T, size_t ALIGN, typename ALLOC>
 template<typename ValT, typename IntT>
 typename bspline_traits<T, 3>::SplineType* BsplineAllocator<T, ALIGN, ALLOC>::createMultiBspline(
-    T dummy, ValT& start, ValT& end, IntT& ng, bc_code bc, int num_splines)
+    T dummy, ValT& start, ValT& end, IntT& ng, bc_code bc, int num_splines, int brick_shift, int inversion)
 {
   Ugrid x_grid, y_grid, z_grid;
   typename bspline_traits<T, 3>::BCType xBC, yBC, zBC;
@@ -154,7 +223,7 @@ typename bspline_traits<T, 3>::SplineType* BsplineAllocator<T, ALIGN, ALLOC>::cr
   xBC.lCode = xBC.rCode = bc;
   yBC.lCode = yBC.rCode = bc;
   zBC.lCode = zBC.rCode = bc;
-  return allocateMultiBspline(x_grid, y_grid, z_grid, xBC, yBC, zBC, num_splines);
+  return allocateMultiBspline(x_grid, y_grid, z_grid, xBC, yBC, zBC, num_splines, brick_shift, inversion);
 }
 
 template<typename T, size_t ALIGN, typename ALLOC>
@@ -169,15 +238,13 @@ void BsplineAllocator<T, ALIGN, ALLOC>::setCoefficientsForOrbitals(int first,
     prefactor[ind] = std::cos(2 * M_PI * ind / size);
 
 #pragma omp parallel for collapse(3)
-  for (int ix = 0; ix < spline->x_grid.num + 3; ix++)
+  for (int ix = 0; ix < spline2::getStoredPlanesX(spline); ix++)
     for (int iy = 0; iy < spline->y_grid.num + 3; iy++)
       for (int iz = 0; iz < spline->z_grid.num + 3; iz++)
       {
-        intptr_t xs = spline->x_stride;
-        intptr_t ys = spline->y_stride;
-        intptr_t zs = spline->z_stride;
+        T* restrict row = spline->coefs + spline2::getRowOffset(spline, ix, iy, iz);
         for (int ind = first; ind < last; ind++)
-          spline->coefs[ix * xs + iy * ys + iz * zs + ind] = coeff(ix, iy, iz) * prefactor[ind];
+          row[ind] = coeff(ix, iy, iz) * prefactor[ind];
       }
 }
 
@@ -190,9 +257,6 @@ void BsplineAllocator<T, ALIGN, ALLOC>::copy(
   typedef typename bspline_type<UBT>::value_type in_type;
   intptr_t x_stride_in  = single->x_stride;
   intptr_t y_stride_in  = single->y_stride;
-  intptr_t x_stride_out = multi->x_stride;
-  intptr_t y_stride_out = multi->y_stride;
-  intptr_t z_stride_out = multi->z_stride;
   intptr_t offset0      = static_cast<intptr_t>(offset[0]);
   intptr_t offset1      = static_cast<intptr_t>(offset[1]);
   intptr_t offset2      = static_cast<intptr_t>(offset[2]);
@@ -201,15 +265,82 @@ void BsplineAllocator<T, ALIGN, ALLOC>::copy(
   for (intptr_t ix = 0; ix < n0; ++ix)
     for (intptr_t iy = 0; iy < n1; ++iy)
     {
-      out_type* restrict out = multi->coefs + ix * x_stride_out + iy * y_stride_out + istart;
       const in_type* restrict in =
           single->coefs + (ix + offset0) * x_stride_in + (iy + offset1) * y_stride_in + offset2;
       for (intptr_t iz = 0; iz < n2; ++iz)
       {
-        out[iz * z_stride_out] = static_cast<out_type>(in[iz]);
+        multi->coefs[spline2::getRowOffset(multi, ix, iy, iz) + istart] = static_cast<out_type>(in[iz]);
       }
     }
 }
 
+template<typename T, size_t ALIGN, typename ALLOC>
+template<typename MBT>
+typename BsplineAllocator<T, ALIGN, ALLOC>::SplineType*
+BsplineAllocator<T, ALIGN, ALLOC>::createConvertedMultiBspline(const MBT* in, int numa_node)
+{
+  typedef typename bspline_type<MBT>::value_type in_type;
+  BCType xBC, yBC, zBC;
+  xBC.lCode = in->xBC.lCode;
+  xBC.rCode = in->xBC.rCode;
+  xBC.lVal  = in->xBC.lVal;
+  xBC.rVal  = in->xBC.rVal;
+  yBC.lCode = in->yBC.lCode;
+  yBC.rCode = in->yBC.rCode;
+  yBC.lVal  = in->yBC.lVal;
+  yBC.rVal  = in->yBC.rVal;
+  zBC.lCode = in->zBC.lCode;
+  zBC.rCode = in->zBC.rCode;
+  zBC.lVal  = in->zBC.lVal;
+  zBC.rVal  = in->zBC.rVal;
+  SplineType* spline =
+      allocateMultiBspline(in->x_grid, in->y_grid, in->z_grid, xBC, yBC, zBC, in->num_splines, in->brick_shift,
+                           in->inversion);
+  if (numa_node >= 0)
+    bindMemoryToNumaDomain(spline->coefs, spline->coefs_size * sizeof(T), numa_node);
+
+  // both have the same layout, only the padding of the rows may differ
+  const intptr_t num_rows = in->coefs_size / in->z_stride;
+  const int num_splines   = in->num_splines;
+  const int num_padded    = spline->z_stride;
+#pragma omp parallel for
+  for (intptr_t row = 0; row < num_rows; row++)
+  {
+    const in_type* restrict src = in->coefs + row * in->z_stride;
+    T* restrict dest            = spline->coefs + row * spline->z_stride;
+    for (int n = 0; n < num_splines; n++)
+      dest[n] = static_cast<T>(src[n]);
+    for (int n = num_splines; n < num_padded; n++)
+      dest[n] = static_cast<T>(0.0f);
+  }
+  return spline;
+}
+
+namespace spline2
+{
+/** make the coefficients of a periodic spline periodic and of a given parity under inversion
+ * @param coef coefficients of the n+3 points along each direction, the index j is the grid point j-1
+ * @param parity 1 for an even and -1 for an odd spline
+ *
+ * The coefficients of each grid point are averaged with the ones of the inverted point.
+ */
+template<typename T>
+void makeInversionSymmetric(Array<T, 3>& coef, int parity)
+{
+  const int n[3] = {static_cast<int>(coef.size(0)) - 3, static_cast<int>(coef.size(1)) - 3,
+                    static_cast<int>(coef.size(2)) - 3};
+  Array<T, 3> sym(coef.size(0), coef.size(1), coef.size(2));
+  for (int jx = 0; jx < n[0] + 3; jx++)
+    for (int jy = 0; jy < n[1] + 3; jy++)
+      for (int jz = 0; jz < n[2] + 3; jz++)
+      {
+        const int gx = (jx + n[0] - 1) % n[0], gy = (jy + n[1] - 1) % n[1], gz = (jz + n[2] - 1) % n[2];
+        const int mx = (n[0] - gx) % n[0], my = (n[1] - gy) % n[1], mz = (n[2] - gz) % n[2];
+        sym(jx, jy, jz) = T(0.5) * (coef(gx + 1, gy + 1, gz + 1) + parity * coef(mx + 1, my + 1, mz + 1));
+      }
+  coef = sym;
+}
+} // namespace spline2
+
 } // namespace qmcplusplus
 #endif
@@ -0,0 +1,118 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/**@file BsplineInterpolation.hpp
+ *
+ * Coefficients of the cubic B-splines interpolating values on a uniform grid
+ */
+#ifndef SPLINE2_BSPLINE_INTERPOLATION_HPP
+#define SPLINE2_BSPLINE_INTERPOLATION_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace qmcplusplus
+{
+namespace spline2
+{
+/** replace values on a uniform grid by the coefficients of the interpolating cubic B-spline
+ * @param data n rows of width values, stride apart, the values of each column are interpolated independently
+ * @param n number of grid points
+ * @param stride distance between the rows
+ * @param width number of values in a row
+ * @param periodic if false, the values are extended by the end rows and only the coefficients
+ *        more than a few points away from the ends are accurate
+ *
+ * The coefficients c of the grid points satisfy (c[i-1] + 4 c[i] + c[i+1]) / 6 = data[i].
+ * They are obtained with the causal and anticausal recursive filters of the pole sqrt(3)-2.
+ */
+template<typename T>
+void solveCubicBsplineRows(T* data, int n, size_t stride, size_t width, bool periodic)
+{
+  const T pole = std::sqrt(T(3)) - T(2);
+  const T gain = T(-6) * pole;
+  // the geometric sums over a period are truncated once the powers of the pole are negligible
+  const int num_terms = periodic ? std::min(n, 64) : 1;
+  const T period_inv  = periodic ? T(1) / (T(1) - std::pow(pole, n)) : T(1) / (T(1) - pole);
+  std::vector<T> first(width);
+
+  for (int i = 0; i < n; i++)
+    for (size_t j = 0; j < width; j++)
+      data[i * stride + j] *= gain;
+
+  // causal filter
+  std::fill(first.begin(), first.end(), T(0));
+  T zk = T(1);
+  for (int k = 0; k < num_terms; k++, zk *= pole)
+  {
+    const T* row = data + ((n - k) % n) * stride;
+    for (size_t j = 0; j < width; j++)
+      first[j] += zk * row[j];
+  }
+  for (size_t j = 0; j < width; j++)
+    data[j] = first[j] * period_inv;
+  for (int i = 1; i < n; i++)
+  {
+    T* row        = data + i * stride;
+    const T* prev = row - stride;
+    for (size_t j = 0; j < width; j++)
+      row[j] += pole * prev[j];
+  }
+
+  // anticausal filter
+  std::fill(first.begin(), first.end(), T(0));
+  zk = T(1);
+  for (int k = 0; k < num_terms; k++, zk *= pole)
+  {
+    const T* row = data + ((n - 1 + k) % n) * stride;
+    for (size_t j = 0; j < width; j++)
+      first[j] += zk * row[j];
+  }
+  for (size_t j = 0; j < width; j++)
+    data[(n - 1) * stride + j] = first[j] * period_inv;
+  for (int i = n - 2; i >= 0; i--)
+  {
+    T* row        = data + i * stride;
+    const T* next = row + stride;
+    for (size_t j = 0; j < width; j++)
+      row[j] += pole * next[j];
+  }
+}
+
+/** replace values on a periodic 3D grid by the coefficients of the interpolating cubic B-splines
+ * @param data values at the grid points, the width values of the point (ix,iy,iz) start at ((ix*ny+iy)*nz+iz)*width
+ * @param nx,ny,nz number of grid points in each direction
+ * @param width number of values at a grid point
+ */
+template<typename T>
+void solveCubicBsplineGrid(T* data, int nx, int ny, int nz, size_t width)
+{
+  const size_t plane = static_cast<size_t>(ny) * nz;
+  // one direction at a time
+#pragma omp parallel for
+  for (int ix = 0; ix < nx; ix++)
+    for (int iy = 0; iy < ny; iy++)
+      solveCubicBsplineRows(data + (ix * ny + iy) * nz * width, nz, width, width, true);
+#pragma omp parallel for
+  for (int ix = 0; ix < nx; ix++)
+    for (int iz = 0; iz < nz; iz++)
+      solveCubicBsplineRows(data + (ix * plane + iz) * width, ny, nz * width, width, true);
+#pragma omp parallel for
+  for (int iy = 0; iy < ny; iy++)
+    for (int iz = 0; iz < nz; iz++)
+      solveCubicBsplineRows(data + (iy * nz + iz) * width, nx, plane * width, width, true);
+}
+
+} // namespace spline2
+} // namespace qmcplusplus
+#endif
@@ -22,7 +22,12 @@
 #ifndef QMCPLUSPLUS_MULTIEINSPLINE_COMMON_HPP
 #define QMCPLUSPLUS_MULTIEINSPLINE_COMMON_HPP
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <vector>
+#include <tuple>
 #include <Numerics/Spline2/MultiBsplineData.hpp>
 #include <Numerics/Spline2/MultiBsplineEvalHelper.hpp>
 #include <stdlib.h>
@@ -31,18 +36,18 @@ namespace qmcplusplus
 {
 namespace MultiBsplineEval
 {
-template<typename T>
-inline void evaluate_v(const typename bspline_traits<T, 3>::SplineType* restrict spline_m, T x, T y,
-                       T z, T* restrict vals, size_t num_splines)
+template<typename SplineType, typename T>
+inline void evaluate_v(const SplineType* restrict spline_m, T x, T y, T z, T* restrict vals, size_t num_splines)
 {
+  using coef_type = typename bspline_type<SplineType>::value_type;
+
   int ix, iy, iz;
   T a[4], b[4], c[4];
 
   spline2::computeLocationAndFractional(spline_m, x, y, z, ix, iy, iz, a, b, c);
 
-  const intptr_t xs = spline_m->x_stride;
-  const intptr_t ys = spline_m->y_stride;
-  const intptr_t zs = spline_m->z_stride;
+  intptr_t ox[4], oy[4], oz[4];
+  spline2::computeRowOffsets(spline_m, ix, iy, iz, ox, oy, oz);
 
   constexpr T zero(0);
   ASSUME_ALIGNED(vals);
@@ -51,31 +56,191 @@ inline void evaluate_v(const typename bspline_traits<T, 3>::SplineType* restrict
   for (size_t i = 0; i < 4; i++)
     for (size_t j = 0; j < 4; j++)
     {
-      const T pre00           = a[i] * b[j];
-      const T* restrict coefs = spline_m->coefs + ((ix + i) * xs + (iy + j) * ys + iz * zs);
+      const T pre00                   = a[i] * b[j];
+      const coef_type* restrict coefs = spline_m->coefs + (ox[i] + oy[j]);
       ASSUME_ALIGNED(coefs);
+      const coef_type* restrict coefs0 = coefs + oz[0];
+      const coef_type* restrict coefs1 = coefs + oz[1];
+      const coef_type* restrict coefs2 = coefs + oz[2];
+      const coef_type* restrict coefs3 = coefs + oz[3];
       //#pragma omp simd
       for (size_t n = 0; n < num_splines; n++)
         vals[n] += pre00 *
-            (c[0] * coefs[n] + c[1] * coefs[n + zs] + c[2] * coefs[n + 2 * zs] +
-             c[3] * coefs[n + 3 * zs]);
+            (c[0] * T(coefs0[n]) + c[1] * T(coefs1[n]) + c[2] * T(coefs2[n]) + c[3] * T(coefs3[n]));
     }
 }
 
-template<typename T>
-inline void
-evaluate_vgl(const typename bspline_traits<T, 3>::SplineType* restrict spline_m, T x, T y, T z,
-             T* restrict vals, T* restrict grads, T* restrict lapl, size_t num_splines)
+/** issue prefetches for the 4x4x4 coefficient rows of an evaluation at (x,y,z)
+ *
+ * The rows are brought to the second level cache, to be read by a later evaluation.
+ */
+template<typename SplineType, typename T>
+inline void prefetch(const SplineType* restrict spline_m, T x, T y, T z, size_t num_splines)
 {
+  using coef_type = typename bspline_type<SplineType>::value_type;
+
+  int ix, iy, iz;
+  T tx, ty, tz;
+  x = (x - spline_m->x_grid.start) * spline_m->x_grid.delta_inv;
+  y = (y - spline_m->y_grid.start) * spline_m->y_grid.delta_inv;
+  z = (z - spline_m->z_grid.start) * spline_m->z_grid.delta_inv;
+  spline2::foldInversion(spline_m, x, y, z);
+  spline2::getSplineBound(x, tx, ix, spline_m->x_grid.num - 1);
+  spline2::getSplineBound(y, ty, iy, spline_m->y_grid.num - 1);
+  spline2::getSplineBound(z, tz, iz, spline_m->z_grid.num - 1);
+
+  intptr_t ox[4], oy[4], oz[4];
+  spline2::computeRowOffsets(spline_m, ix, iy, iz, ox, oy, oz);
+
+  const size_t row_bytes = num_splines * sizeof(coef_type);
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      for (int k = 0; k < 4; k++)
+      {
+        const char* row = reinterpret_cast<const char*>(spline_m->coefs + (ox[i] + oy[j] + oz[k]));
+        for (size_t b = 0; b < row_bytes; b += QMC_CLINE)
+          __builtin_prefetch(row + b, 0, 2);
+      }
+}
+
+/** evaluate the values and gradients only
+ *
+ * Half of the outputs and about half of the arithmetic of evaluate_vgh, for the moves
+ * accepted or rejected on the ratio and the gradient.
+ */
+template<typename SplineType, typename T>
+inline void evaluate_vg(const SplineType* restrict spline_m, T x, T y, T z, T* restrict vals, T* restrict grads,
+                        size_t num_splines)
+{
+  using coef_type = typename bspline_type<SplineType>::value_type;
+
+  int ix, iy, iz;
+  T a[4], b[4], c[4], da[4], db[4], dc[4], d2a[4], d2b[4], d2c[4];
+
+  spline2::computeLocationAndFractional(spline_m, x, y, z, ix, iy, iz, a, b, c, da, db, dc, d2a, d2b, d2c);
+
+  intptr_t ox[4], oy[4], oz[4];
+  spline2::computeRowOffsets(spline_m, ix, iy, iz, ox, oy, oz);
+
+  const size_t out_offset = spline_m->num_splines;
+
+  ASSUME_ALIGNED(vals);
+  T* restrict gx = grads;
+  ASSUME_ALIGNED(gx);
+  T* restrict gy = grads + out_offset;
+  ASSUME_ALIGNED(gy);
+  T* restrict gz = grads + 2 * out_offset;
+  ASSUME_ALIGNED(gz);
+
+  std::fill(vals, vals + num_splines, T());
+  std::fill(gx, gx + num_splines, T());
+  std::fill(gy, gy + num_splines, T());
+  std::fill(gz, gz + num_splines, T());
+
+  const T dxInv = spline_m->x_grid.delta_inv;
+  const T dyInv = spline_m->y_grid.delta_inv;
+  const T dzInv = spline_m->z_grid.delta_inv;
+
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+    {
+      const T pre00 = a[i] * b[j];
+      const T pre10 = da[i] * b[j] * dxInv;
+      const T pre01 = a[i] * db[j] * dyInv;
+      const T pre0z = pre00 * dzInv;
+
+      const coef_type* restrict coefs    = spline_m->coefs + (ox[i] + oy[j] + oz[0]);
+      const coef_type* restrict coefszs  = spline_m->coefs + (ox[i] + oy[j] + oz[1]);
+      const coef_type* restrict coefs2zs = spline_m->coefs + (ox[i] + oy[j] + oz[2]);
+      const coef_type* restrict coefs3zs = spline_m->coefs + (ox[i] + oy[j] + oz[3]);
+
+#pragma omp simd
+      for (int n = 0; n < num_splines; n++)
+      {
+        const T coefsv    = coefs[n];
+        const T coefsvzs  = coefszs[n];
+        const T coefsv2zs = coefs2zs[n];
+        const T coefsv3zs = coefs3zs[n];
+
+        const T sum0 = c[0] * coefsv + c[1] * coefsvzs + c[2] * coefsv2zs + c[3] * coefsv3zs;
+        const T sum1 = dc[0] * coefsv + dc[1] * coefsvzs + dc[2] * coefsv2zs + dc[3] * coefsv3zs;
+        vals[n] += pre00 * sum0;
+        gx[n] += pre10 * sum0;
+        gy[n] += pre01 * sum0;
+        gz[n] += pre0z * sum1;
+      }
+    }
+}
+
+/** evaluate the laplacians only
+ *
+ * The trace of the hessian, two of the three z contractions of evaluate_vgh and three
+ * accumulators, for the laplacians left out by evaluate_vg.
+ */
+template<typename SplineType, typename T>
+inline void evaluate_l(const SplineType* restrict spline_m, T x, T y, T z, T* restrict lapl, size_t num_splines)
+{
+  using coef_type = typename bspline_type<SplineType>::value_type;
+
+  int ix, iy, iz;
+  T a[4], b[4], c[4], da[4], db[4], dc[4], d2a[4], d2b[4], d2c[4];
+
+  spline2::computeLocationAndFractional(spline_m, x, y, z, ix, iy, iz, a, b, c, da, db, dc, d2a, d2b, d2c);
+
+  intptr_t ox[4], oy[4], oz[4];
+  spline2::computeRowOffsets(spline_m, ix, iy, iz, ox, oy, oz);
+
+  const T dxInv = spline_m->x_grid.delta_inv;
+  const T dyInv = spline_m->y_grid.delta_inv;
+  const T dzInv = spline_m->z_grid.delta_inv;
+  const T dxx   = dxInv * dxInv;
+  const T dyy   = dyInv * dyInv;
+  const T dzz   = dzInv * dzInv;
+
+  ASSUME_ALIGNED(lapl);
+  std::fill(lapl, lapl + num_splines, T());
+
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+    {
+      // the grid spacing is folded into the prefactors, one accumulator is enough
+      const T pre2 = d2a[i] * b[j] * dxx + a[i] * d2b[j] * dyy;
+      const T pre0 = a[i] * b[j] * dzz;
+
+      const coef_type* restrict coefs    = spline_m->coefs + (ox[i] + oy[j] + oz[0]);
+      const coef_type* restrict coefszs  = spline_m->coefs + (ox[i] + oy[j] + oz[1]);
+      const coef_type* restrict coefs2zs = spline_m->coefs + (ox[i] + oy[j] + oz[2]);
+      const coef_type* restrict coefs3zs = spline_m->coefs + (ox[i] + oy[j] + oz[3]);
+
+#pragma omp simd
+      for (int n = 0; n < num_splines; n++)
+      {
+        const T coefsv    = coefs[n];
+        const T coefsvzs  = coefszs[n];
+        const T coefsv2zs = coefs2zs[n];
+        const T coefsv3zs = coefs3zs[n];
+
+        const T sum0 = c[0] * coefsv + c[1] * coefsvzs + c[2] * coefsv2zs + c[3] * coefsv3zs;
+        const T sum2 = d2c[0] * coefsv + d2c[1] * coefsvzs + d2c[2] * coefsv2zs + d2c[3] * coefsv3zs;
+        lapl[n] += pre2 * sum0 + pre0 * sum2;
+      }
+    }
+}
+
+template<typename SplineType, typename T>
+inline void evaluate_vgl(const SplineType* restrict spline_m, T x, T y, T z, T* restrict vals, T* restrict grads,
+                         T* restrict lapl, size_t num_splines)
+{
+  using coef_type = typename bspline_type<SplineType>::value_type;
+
   int ix, iy, iz;
   T a[4], b[4], c[4], da[4], db[4], dc[4], d2a[4], d2b[4], d2c[4];
 
   spline2::computeLocationAndFractional(spline_m, x, y, z, ix, iy, iz, a, b, c, da, db, dc, d2a,
                                         d2b, d2c);
 
-  const intptr_t xs = spline_m->x_stride;
-  const intptr_t ys = spline_m->y_stride;
-  const intptr_t zs = spline_m->z_stride;
+  intptr_t ox[4], oy[4], oz[4];
+  spline2::computeRowOffsets(spline_m, ix, iy, iz, ox, oy, oz);
 
   const size_t out_offset = spline_m->num_splines;
 
@@ -111,13 +276,13 @@ evaluate_vgl(const typename bspline_traits<T, 3>::SplineType* restrict spline_m,
       const T pre01 = a[i] * db[j];
       const T pre02 = a[i] * d2b[j];
 
-      const T* restrict coefs = spline_m->coefs + ((ix + i) * xs + (iy + j) * ys + iz * zs);
+      const coef_type* restrict coefs = spline_m->coefs + (ox[i] + oy[j] + oz[0]);
       ASSUME_ALIGNED(coefs);
-      const T* restrict coefszs = coefs + zs;
+      const coef_type* restrict coefszs = spline_m->coefs + (ox[i] + oy[j] + oz[1]);
       ASSUME_ALIGNED(coefszs);
-      const T* restrict coefs2zs = coefs + 2 * zs;
+      const coef_type* restrict coefs2zs = spline_m->coefs + (ox[i] + oy[j] + oz[2]);
       ASSUME_ALIGNED(coefs2zs);
-      const T* restrict coefs3zs = coefs + 3 * zs;
+      const coef_type* restrict coefs3zs = spline_m->coefs + (ox[i] + oy[j] + oz[3]);
       ASSUME_ALIGNED(coefs3zs);
 
 #pragma noprefetch
@@ -160,20 +325,20 @@ evaluate_vgl(const typename bspline_traits<T, 3>::SplineType* restrict spline_m,
   }
 }
 
-template<typename T>
-inline void
-evaluate_vgh(const typename bspline_traits<T, 3>::SplineType* restrict spline_m, T x, T y, T z,
-             T* restrict vals, T* restrict grads, T* restrict hess, size_t num_splines)
+template<typename SplineType, typename T>
+inline void evaluate_vgh(const SplineType* restrict spline_m, T x, T y, T z, T* restrict vals, T* restrict grads,
+                         T* restrict hess, size_t num_splines)
 {
+  using coef_type = typename bspline_type<SplineType>::value_type;
+
   int ix, iy, iz;
   T a[4], b[4], c[4], da[4], db[4], dc[4], d2a[4], d2b[4], d2c[4];
 
   spline2::computeLocationAndFractional(spline_m, x, y, z, ix, iy, iz, a, b, c, da, db, dc, d2a,
                                         d2b, d2c);
 
-  const intptr_t xs = spline_m->x_stride;
-  const intptr_t ys = spline_m->y_stride;
-  const intptr_t zs = spline_m->z_stride;
+  intptr_t ox[4], oy[4], oz[4];
+  spline2::computeRowOffsets(spline_m, ix, iy, iz, ox, oy, oz);
 
   const size_t out_offset = spline_m->num_splines;
 
@@ -212,13 +377,13 @@ evaluate_vgh(const typename bspline_traits<T, 3>::SplineType* restrict spline_m,
   for (int i = 0; i < 4; i++)
     for (int j = 0; j < 4; j++)
     {
-      const T* restrict coefs = spline_m->coefs + ((ix + i) * xs + (iy + j) * ys + iz * zs);
+      const coef_type* restrict coefs = spline_m->coefs + (ox[i] + oy[j] + oz[0]);
       ASSUME_ALIGNED(coefs);
-      const T* restrict coefszs = coefs + zs;
+      const coef_type* restrict coefszs = spline_m->coefs + (ox[i] + oy[j] + oz[1]);
       ASSUME_ALIGNED(coefszs);
-      const T* restrict coefs2zs = coefs + 2 * zs;
+      const coef_type* restrict coefs2zs = spline_m->coefs + (ox[i] + oy[j] + oz[2]);
       ASSUME_ALIGNED(coefs2zs);
-      const T* restrict coefs3zs = coefs + 3 * zs;
+      const coef_type* restrict coefs3zs = spline_m->coefs + (ox[i] + oy[j] + oz[3]);
       ASSUME_ALIGNED(coefs3zs);
 
       const T pre20 = d2a[i] * b[j];
@@ -279,6 +444,312 @@ evaluate_vgh(const typename bspline_traits<T, 3>::SplineType* restrict spline_m,
   }
 }
 
+/** scratch of the batched evaluations, kept by the caller to avoid allocations on every call
+ *
+ * The containers only grow.
+ */
+template<typename T>
+struct MultiBsplineScratch
+{
+  /// stencil of a position
+  struct Location
+  {
+    intptr_t ox[4], oy[4], oz[4];
+    T a[4], b[4], c[4], da[4], db[4], dc[4], d2a[4], d2b[4], d2c[4];
+  };
+  /// a coefficient column (ix+i, iy+j) of the stencil of a position
+  struct Visit
+  {
+    /// column, then the z cell of the stencil
+    int64_t key;
+    int pos;
+    /// 4*i+j
+    int ij;
+    bool operator<(const Visit& rhs) const { return key < rhs.key; }
+  };
+
+  std::vector<Location> locs;
+  std::vector<Visit> visits;
+
+  /// cell and fractions of a virtual position of evaluate_ratios_multi
+  struct RatioLocation
+  {
+    int ix, iy, iz;
+    T a[4], b[4], c[4];
+  };
+
+  std::vector<RatioLocation> ratio_locs;
+  /// offsets of the coefficient rows of the gathered bounding box
+  std::vector<intptr_t> rows;
+  /// rows contracted with inv
+  std::vector<T> contractions;
+};
+
+/** evaluate values, gradients and hessians of a batch of positions with one pass over the coefficients
+ * @param spline_m spline shared by all the positions
+ * @param x,y,z unit coordinates of num_pos positions
+ * @param vals,grads,hess output arrays of each position, laid out as in evaluate_vgh
+ * @param num_splines number of splines
+ * @param scratch locations and visits of the positions
+ *
+ * The 4x4 coefficient columns of the stencils of all the positions are sorted by their
+ * grid column and by the z cell within a column. Each column is then swept once for all
+ * the positions whose stencils contain it: the 4 rows of a position are read while the rows
+ * of the previous positions in the same column are still in the first level cache, so
+ * overlapping stencils of different walkers share their coefficient loads.
+ */
+template<typename SplineType, typename T>
+inline void evaluate_vgh_multi(const SplineType* restrict spline_m, const T* restrict x, const T* restrict y,
+                               const T* restrict z, int num_pos, T* const* vals, T* const* grads, T* const* hess,
+                               size_t num_splines, MultiBsplineScratch<T>& scratch)
+{
+  using coef_type = typename bspline_type<SplineType>::value_type;
+  using Location  = typename MultiBsplineScratch<T>::Location;
+  using Visit     = typename MultiBsplineScratch<T>::Visit;
+
+  if (scratch.locs.size() < num_pos)
+    scratch.locs.resize(num_pos);
+  if (scratch.visits.size() < 16 * num_pos)
+    scratch.visits.resize(16 * num_pos);
+  Location* restrict locs = scratch.locs.data();
+  Visit* restrict visits  = scratch.visits.data();
+
+  // cells along y and z of the padded grid
+  const int64_t ny = spline_m->y_grid.num + 3;
+  const int64_t nz = spline_m->z_grid.num + 3;
+  for (int iw = 0; iw < num_pos; iw++)
+  {
+    Location& loc = locs[iw];
+    int ix, iy, iz;
+    spline2::computeLocationAndFractional(spline_m, x[iw], y[iw], z[iw], ix, iy, iz, loc.a, loc.b, loc.c, loc.da,
+                                          loc.db, loc.dc, loc.d2a, loc.d2b, loc.d2c);
+    spline2::computeRowOffsets(spline_m, ix, iy, iz, loc.ox, loc.oy, loc.oz);
+    for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++)
+      {
+        Visit& v = visits[16 * iw + 4 * i + j];
+        v.key    = ((ix + i) * ny + iy + j) * nz + iz;
+        v.pos    = iw;
+        v.ij     = 4 * i + j;
+      }
+  }
+  std::sort(visits, visits + 16 * num_pos);
+
+  const size_t out_offset = spline_m->num_splines;
+
+  for (int iw = 0; iw < num_pos; iw++)
+  {
+    std::fill(vals[iw], vals[iw] + num_splines, T());
+    for (int d = 0; d < 3; d++)
+      std::fill(grads[iw] + d * out_offset, grads[iw] + d * out_offset + num_splines, T());
+    for (int d = 0; d < 6; d++)
+      std::fill(hess[iw] + d * out_offset, hess[iw] + d * out_offset + num_splines, T());
+  }
+
+  for (int k = 0; k < 16 * num_pos; k++)
+  {
+    const int iw        = visits[k].pos;
+    const int i         = visits[k].ij >> 2;
+    const int j         = visits[k].ij & 3;
+    const Location& loc = locs[iw];
+
+    const coef_type* restrict coefs = spline_m->coefs + (loc.ox[i] + loc.oy[j] + loc.oz[0]);
+    ASSUME_ALIGNED(coefs);
+    const coef_type* restrict coefszs = spline_m->coefs + (loc.ox[i] + loc.oy[j] + loc.oz[1]);
+    ASSUME_ALIGNED(coefszs);
+    const coef_type* restrict coefs2zs = spline_m->coefs + (loc.ox[i] + loc.oy[j] + loc.oz[2]);
+    ASSUME_ALIGNED(coefs2zs);
+    const coef_type* restrict coefs3zs = spline_m->coefs + (loc.ox[i] + loc.oy[j] + loc.oz[3]);
+    ASSUME_ALIGNED(coefs3zs);
+
+    const T pre20 = loc.d2a[i] * loc.b[j];
+    const T pre10 = loc.da[i] * loc.b[j];
+    const T pre00 = loc.a[i] * loc.b[j];
+    const T pre11 = loc.da[i] * loc.db[j];
+    const T pre01 = loc.a[i] * loc.db[j];
+    const T pre02 = loc.a[i] * loc.d2b[j];
+
+    const T c0 = loc.c[0], c1 = loc.c[1], c2 = loc.c[2], c3 = loc.c[3];
+    const T dc0 = loc.dc[0], dc1 = loc.dc[1], dc2 = loc.dc[2], dc3 = loc.dc[3];
+    const T d2c0 = loc.d2c[0], d2c1 = loc.d2c[1], d2c2 = loc.d2c[2], d2c3 = loc.d2c[3];
+
+    T* restrict val = vals[iw];
+    ASSUME_ALIGNED(val);
+    T* restrict gx = grads[iw];
+    ASSUME_ALIGNED(gx);
+    T* restrict gy = grads[iw] + out_offset;
+    ASSUME_ALIGNED(gy);
+    T* restrict gz = grads[iw] + 2 * out_offset;
+    ASSUME_ALIGNED(gz);
+    T* restrict hxx = hess[iw];
+    ASSUME_ALIGNED(hxx);
+    T* restrict hxy = hess[iw] + out_offset;
+    ASSUME_ALIGNED(hxy);
+    T* restrict hxz = hess[iw] + 2 * out_offset;
+    ASSUME_ALIGNED(hxz);
+    T* restrict hyy = hess[iw] + 3 * out_offset;
+    ASSUME_ALIGNED(hyy);
+    T* restrict hyz = hess[iw] + 4 * out_offset;
+    ASSUME_ALIGNED(hyz);
+    T* restrict hzz = hess[iw] + 5 * out_offset;
+    ASSUME_ALIGNED(hzz);
+
+    const int iSplitPoint = num_splines;
+#pragma omp simd
+    for (int n = 0; n < iSplitPoint; n++)
+    {
+      T coefsv    = coefs[n];
+      T coefsvzs  = coefszs[n];
+      T coefsv2zs = coefs2zs[n];
+      T coefsv3zs = coefs3zs[n];
+
+      T sum0 = c0 * coefsv + c1 * coefsvzs + c2 * coefsv2zs + c3 * coefsv3zs;
+      T sum1 = dc0 * coefsv + dc1 * coefsvzs + dc2 * coefsv2zs + dc3 * coefsv3zs;
+      T sum2 = d2c0 * coefsv + d2c1 * coefsvzs + d2c2 * coefsv2zs + d2c3 * coefsv3zs;
+
+      hxx[n] += pre20 * sum0;
+      hxy[n] += pre11 * sum0;
+      hxz[n] += pre10 * sum1;
+      hyy[n] += pre02 * sum0;
+      hyz[n] += pre01 * sum1;
+      hzz[n] += pre00 * sum2;
+      gx[n] += pre10 * sum0;
+      gy[n] += pre01 * sum0;
+      gz[n] += pre00 * sum1;
+      val[n] += pre00 * sum0;
+    }
+  }
+
+  const T dxInv = spline_m->x_grid.delta_inv;
+  const T dyInv = spline_m->y_grid.delta_inv;
+  const T dzInv = spline_m->z_grid.delta_inv;
+  const T dxx   = dxInv * dxInv;
+  const T dyy   = dyInv * dyInv;
+  const T dzz   = dzInv * dzInv;
+  const T dxy   = dxInv * dyInv;
+  const T dxz   = dxInv * dzInv;
+  const T dyz   = dyInv * dzInv;
+
+  for (int iw = 0; iw < num_pos; iw++)
+  {
+    T* restrict gx  = grads[iw];
+    T* restrict gy  = grads[iw] + out_offset;
+    T* restrict gz  = grads[iw] + 2 * out_offset;
+    T* restrict hxx = hess[iw];
+    T* restrict hxy = hess[iw] + out_offset;
+    T* restrict hxz = hess[iw] + 2 * out_offset;
+    T* restrict hyy = hess[iw] + 3 * out_offset;
+    T* restrict hyz = hess[iw] + 4 * out_offset;
+    T* restrict hzz = hess[iw] + 5 * out_offset;
+#pragma omp simd
+    for (int n = 0; n < num_splines; n++)
+    {
+      gx[n] *= dxInv;
+      gy[n] *= dyInv;
+      gz[n] *= dzInv;
+      hxx[n] *= dxx;
+      hyy[n] *= dyy;
+      hzz[n] *= dzz;
+      hxy[n] *= dxy;
+      hxz[n] *= dxz;
+      hyz[n] *= dyz;
+    }
+  }
+}
+
+/** accumulate the values at num_pos positions contracted with inv, the ratios of virtual moves
+ *
+ * The coefficient rows of the bounding box of the 4x4x4 stencils are gathered and contracted
+ * with inv, four rows per pass over inv, and the num_pos x rows weight matrix, 64 nonzeros per
+ * position, is applied to the contractions. This pays only when the stencils overlap, as on a
+ * quadrature of small radius.
+ * @param max_rows the largest bounding box worth gathering
+ * @param scratch locations, rows and contractions of the positions
+ * @return false if the bounding box has more than max_rows rows, nothing is accumulated
+ */
+template<typename SplineType, typename T>
+inline bool evaluate_ratios_multi(const SplineType* restrict spline_m, const T* restrict x, const T* restrict y,
+                                  const T* restrict z, int num_pos, const T* restrict inv, T* restrict ratios,
+                                  size_t num_splines, int max_rows, MultiBsplineScratch<T>& scratch)
+{
+  using coef_type = typename bspline_type<SplineType>::value_type;
+  using Location  = typename MultiBsplineScratch<T>::RatioLocation;
+
+  if (scratch.ratio_locs.size() < num_pos)
+    scratch.ratio_locs.resize(num_pos);
+  Location* restrict locs = scratch.ratio_locs.data();
+  int lo[3] = {std::numeric_limits<int>::max(), std::numeric_limits<int>::max(), std::numeric_limits<int>::max()};
+  int hi[3] = {0, 0, 0};
+  for (int ip = 0; ip < num_pos; ip++)
+  {
+    Location& loc = locs[ip];
+    spline2::computeLocationAndFractional(spline_m, x[ip], y[ip], z[ip], loc.ix, loc.iy, loc.iz, loc.a, loc.b,
+                                          loc.c);
+    const int cell[3] = {loc.ix, loc.iy, loc.iz};
+    for (int d = 0; d < 3; d++)
+    {
+      lo[d] = std::min(lo[d], cell[d]);
+      hi[d] = std::max(hi[d], cell[d] + 4);
+    }
+  }
+
+  const int nx = hi[0] - lo[0], ny = hi[1] - lo[1], nz = hi[2] - lo[2];
+  const int num_rows = nx * ny * nz;
+  if (num_rows > max_rows)
+    return false;
+
+  // rows of the bounding box, padded to a multiple of 4 with the last row
+  const int padded_rows = (num_rows + 3) / 4 * 4;
+  if (scratch.rows.size() < padded_rows)
+  {
+    scratch.rows.resize(padded_rows);
+    scratch.contractions.resize(padded_rows);
+  }
+  intptr_t* restrict rows = scratch.rows.data();
+  for (int i = 0, r = 0; i < nx; i++)
+    for (int j = 0; j < ny; j++)
+      for (int k = 0; k < nz; k++, r++)
+        rows[r] = spline2::getRowOffset(spline_m, lo[0] + i, lo[1] + j, lo[2] + k);
+  for (int r = num_rows; r < padded_rows; r++)
+    rows[r] = rows[num_rows - 1];
+
+  T* restrict contractions = scratch.contractions.data();
+  for (int r = 0; r < padded_rows; r += 4)
+  {
+    const coef_type* restrict row0 = spline_m->coefs + rows[r];
+    const coef_type* restrict row1 = spline_m->coefs + rows[r + 1];
+    const coef_type* restrict row2 = spline_m->coefs + rows[r + 2];
+    const coef_type* restrict row3 = spline_m->coefs + rows[r + 3];
+    T dot0(0), dot1(0), dot2(0), dot3(0);
+#pragma omp simd reduction(+ : dot0, dot1, dot2, dot3)
+    for (int n = 0; n < num_splines; n++)
+    {
+      dot0 += T(row0[n]) * inv[n];
+      dot1 += T(row1[n]) * inv[n];
+      dot2 += T(row2[n]) * inv[n];
+      dot3 += T(row3[n]) * inv[n];
+    }
+    contractions[r]     = dot0;
+    contractions[r + 1] = dot1;
+    contractions[r + 2] = dot2;
+    contractions[r + 3] = dot3;
+  }
+
+  for (int ip = 0; ip < num_pos; ip++)
+  {
+    const Location& loc = locs[ip];
+    T ratio(0);
+    for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++)
+      {
+        const T* restrict c_row = contractions + ((loc.ix + i - lo[0]) * ny + loc.iy + j - lo[1]) * nz + loc.iz - lo[2];
+        ratio += loc.a[i] * loc.b[j] * (loc.c[0] * c_row[0] + loc.c[1] * c_row[1] + loc.c[2] * c_row[2] + loc.c[3] * c_row[3]);
+      }
+    ratios[ip] += ratio;
+  }
+  return true;
+}
+
 } // namespace MultiBsplineEval
 } // namespace qmcplusplus
 #endif
@@ -0,0 +1,104 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file MultiBsplineAVX512.cpp
+ *
+ * AVX-512F multi-bspline kernels, compiled with -mavx512f.
+ * Only the intrinsics and the kernels are included, see MultiBsplineSIMDKernels.hpp.
+ */
+#include <immintrin.h>
+#define QMC_SPLINE_SIMD_KERNELS
+#include <Numerics/Spline2/MultiBsplineSIMDKernels.hpp>
+
+namespace qmcplusplus
+{
+namespace spline2
+{
+namespace
+{
+template<typename T>
+struct AVX512SIMD;
+
+template<>
+struct AVX512SIMD<double>
+{
+  using type                 = __m512d;
+  static constexpr int width = 8;
+  static type load(const double* p) { return _mm512_loadu_pd(p); }
+  static void store(double* p, type v) { _mm512_storeu_pd(p, v); }
+  static type set1(double a) { return _mm512_set1_pd(a); }
+  static type zero() { return _mm512_setzero_pd(); }
+  static type add(type a, type b) { return _mm512_add_pd(a, b); }
+  static type mul(type a, type b) { return _mm512_mul_pd(a, b); }
+  static type fmadd(type a, type b, type c) { return _mm512_fmadd_pd(a, b, c); }
+};
+
+template<>
+struct AVX512SIMD<float>
+{
+  using type                 = __m512;
+  static constexpr int width = 16;
+  static type load(const float* p) { return _mm512_loadu_ps(p); }
+  static void store(float* p, type v) { _mm512_storeu_ps(p, v); }
+  static type set1(float a) { return _mm512_set1_ps(a); }
+  static type zero() { return _mm512_setzero_ps(); }
+  static type add(type a, type b) { return _mm512_add_ps(a, b); }
+  static type mul(type a, type b) { return _mm512_mul_ps(a, b); }
+  static type fmadd(type a, type b, type c) { return _mm512_fmadd_ps(a, b, c); }
+};
+} // namespace
+
+namespace avx512
+{
+template<typename T>
+void evaluate_v(const SplineStencil<T>& st, T* vals, size_t num_splines)
+{
+  evaluate_v_simd<AVX512SIMD<T>>(st, vals, num_splines);
+}
+
+template<typename T>
+void evaluate_vg(const SplineStencil<T>& st, T* vals, T* grads, size_t num_splines)
+{
+  evaluate_vg_simd<AVX512SIMD<T>>(st, vals, grads, num_splines);
+}
+
+template<typename T>
+void evaluate_l(const SplineStencil<T>& st, T* lapl, size_t num_splines)
+{
+  evaluate_l_simd<AVX512SIMD<T>>(st, lapl, num_splines);
+}
+
+template<typename T>
+void evaluate_vgl(const SplineStencil<T>& st, T* vals, T* grads, T* lapl, size_t num_splines)
+{
+  evaluate_vgl_simd<AVX512SIMD<T>>(st, vals, grads, lapl, num_splines);
+}
+
+template<typename T>
+void evaluate_vgh(const SplineStencil<T>& st, T* vals, T* grads, T* hess, size_t num_splines)
+{
+  evaluate_vgh_simd<AVX512SIMD<T>>(st, vals, grads, hess, num_splines);
+}
+
+template void evaluate_v<float>(const SplineStencil<float>&, float*, size_t);
+template void evaluate_v<double>(const SplineStencil<double>&, double*, size_t);
+template void evaluate_vg<float>(const SplineStencil<float>&, float*, float*, size_t);
+template void evaluate_vg<double>(const SplineStencil<double>&, double*, double*, size_t);
+template void evaluate_l<float>(const SplineStencil<float>&, float*, size_t);
+template void evaluate_l<double>(const SplineStencil<double>&, double*, size_t);
+template void evaluate_vgl<float>(const SplineStencil<float>&, float*, float*, float*, size_t);
+template void evaluate_vgl<double>(const SplineStencil<double>&, double*, double*, double*, size_t);
+template void evaluate_vgh<float>(const SplineStencil<float>&, float*, float*, float*, size_t);
+template void evaluate_vgh<double>(const SplineStencil<double>&, double*, double*, double*, size_t);
+} // namespace avx512
+
+} // namespace spline2
+} // namespace qmcplusplus
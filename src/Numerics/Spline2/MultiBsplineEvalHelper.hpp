@@ -17,7 +17,11 @@
 #define SPLINE2_MULTIEINSPLINE_EVAL_HELPER_HPP
 
 #include <cmath>
+#include <cstdint>
 #include <algorithm>
+#include <limits>
+#include <string>
+#include <Numerics/Spline2/MultiBsplineData.hpp>
 
 namespace qmcplusplus
 {
@@ -63,53 +67,170 @@ inline void getSplineBound(T x, TRESIDUAL& dx, int& ind, int nmax)
   }
 }
 
+/** number of coefficient planes stored along x
+ *
+ * With inversion symmetry, only the planes of the cells up to the middle of the x grid are stored.
+ */
+template<typename SplineType>
+inline int getStoredPlanesX(const SplineType* restrict spline_m)
+{
+  return spline_m->inversion ? spline_m->x_grid.num / 2 + 4 : spline_m->x_grid.num + 3;
+}
+
+/** map grid coordinates beyond the middle of the x grid to the inverted position
+ * @param x,y,z coordinates in the units of the grid spacings from the start of the grids
+ * @return true if the position is inverted, the prefactors have to take the parity of the splines
+ *
+ * A periodic grid of n points is mapped to itself by x -> n - x, the inverted coordinates are in (0,n].
+ */
+template<typename SplineType, typename T>
+inline bool foldInversion(const SplineType* restrict spline_m, T& x, T& y, T& z)
+{
+  if (spline_m->inversion == 0 || x <= T(0.5) * spline_m->x_grid.num)
+    return false;
+  x = spline_m->x_grid.num - x;
+  y = spline_m->y_grid.num - y;
+  z = spline_m->z_grid.num - z;
+  return true;
+}
+
 /** define computeLocationAndFractional: common to any implementation
  * compute the location of the spline grid point and residual coordinates
  * also it precomputes auxilary array a, b and c
  */
-template<typename T>
+template<typename SplineType, typename T>
 inline void computeLocationAndFractional(
-    const typename qmcplusplus::bspline_traits<T, 3>::SplineType* restrict spline_m, T x, T y, T z,
+    const SplineType* restrict spline_m, T x, T y, T z,
     int& ix, int& iy, int& iz, T a[4], T b[4], T c[4])
 {
-  x -= spline_m->x_grid.start;
-  y -= spline_m->y_grid.start;
-  z -= spline_m->z_grid.start;
+  x = (x - spline_m->x_grid.start) * spline_m->x_grid.delta_inv;
+  y = (y - spline_m->y_grid.start) * spline_m->y_grid.delta_inv;
+  z = (z - spline_m->z_grid.start) * spline_m->z_grid.delta_inv;
+  const bool inverted = foldInversion(spline_m, x, y, z);
 
   T tx, ty, tz;
 
-  getSplineBound(x * spline_m->x_grid.delta_inv, tx, ix, spline_m->x_grid.num - 1);
-  getSplineBound(y * spline_m->y_grid.delta_inv, ty, iy, spline_m->y_grid.num - 1);
-  getSplineBound(z * spline_m->z_grid.delta_inv, tz, iz, spline_m->z_grid.num - 1);
+  getSplineBound(x, tx, ix, spline_m->x_grid.num - 1);
+  getSplineBound(y, ty, iy, spline_m->y_grid.num - 1);
+  getSplineBound(z, tz, iz, spline_m->z_grid.num - 1);
 
   MultiBsplineData<T>::compute_prefactors(a, tx);
   MultiBsplineData<T>::compute_prefactors(b, ty);
   MultiBsplineData<T>::compute_prefactors(c, tz);
+
+  // phi(r) = parity * phi(-r)
+  if (inverted)
+    for (int k = 0; k < 4; k++)
+      a[k] *= spline_m->inversion;
 }
 
 /** define computeLocationAndFractional: common to any implementation
  * compute the location of the spline grid point and residual coordinates
  * also it precomputes auxilary array (a,b,c) (da,db,dc) (d2a,d2b,d2c)
  */
-template<typename T>
+template<typename SplineType, typename T>
 inline void computeLocationAndFractional(
-    const typename qmcplusplus::bspline_traits<T, 3>::SplineType* restrict spline_m, T x, T y, T z,
+    const SplineType* restrict spline_m, T x, T y, T z,
     int& ix, int& iy, int& iz, T a[4], T b[4], T c[4], T da[4], T db[4], T dc[4], T d2a[4],
     T d2b[4], T d2c[4])
 {
-  x -= spline_m->x_grid.start;
-  y -= spline_m->y_grid.start;
-  z -= spline_m->z_grid.start;
+  x = (x - spline_m->x_grid.start) * spline_m->x_grid.delta_inv;
+  y = (y - spline_m->y_grid.start) * spline_m->y_grid.delta_inv;
+  z = (z - spline_m->z_grid.start) * spline_m->z_grid.delta_inv;
+  const bool inverted = foldInversion(spline_m, x, y, z);
 
   T tx, ty, tz;
 
-  getSplineBound(x * spline_m->x_grid.delta_inv, tx, ix, spline_m->x_grid.num - 1);
-  getSplineBound(y * spline_m->y_grid.delta_inv, ty, iy, spline_m->y_grid.num - 1);
-  getSplineBound(z * spline_m->z_grid.delta_inv, tz, iz, spline_m->z_grid.num - 1);
+  getSplineBound(x, tx, ix, spline_m->x_grid.num - 1);
+  getSplineBound(y, ty, iy, spline_m->y_grid.num - 1);
+  getSplineBound(z, tz, iz, spline_m->z_grid.num - 1);
 
   MultiBsplineData<T>::compute_prefactors(a, da, d2a, tx);
   MultiBsplineData<T>::compute_prefactors(b, db, d2b, ty);
   MultiBsplineData<T>::compute_prefactors(c, dc, d2c, tz);
+
+  // phi(r) = parity * phi(-r), the first derivatives change sign and the second ones do not
+  if (inverted)
+  {
+    const T parity = spline_m->inversion;
+    for (int k = 0; k < 4; k++)
+    {
+      a[k] *= parity;
+      da[k] *= -parity;
+      d2a[k] *= parity;
+      db[k] = -db[k];
+      dc[k] = -dc[k];
+    }
+  }
+}
+
+/** parse the edge of the coefficient bricks
+ * @param edge grid points of a brick along each direction, 0 or 1 for the x-major layout
+ * @param shift log2 of the edge
+ * @return false if the edge is not a power of 2
+ */
+inline bool parseBrickEdge(int edge, int& shift)
+{
+  if (edge < 0 || edge > 64 || (edge & (edge - 1)) != 0)
+    return false;
+  shift = 0;
+  while ((2 << shift) <= edge)
+    shift++;
+  return true;
+}
+
+/// name of the coefficient layout of a brick shift
+inline std::string getSplineLayoutName(int shift)
+{
+  if (shift == 0)
+    return "x-major";
+  const std::string edge = std::to_string(1 << shift);
+  return edge + "x" + edge + "x" + edge + " bricks";
+}
+
+/** offset of the coefficients of a grid point along one direction
+ * @param ind grid index
+ * @param shift log2 of the brick edge, 0 for the x-major layout
+ * @param stride stride inside a brick
+ * @param brick_stride stride between the bricks
+ */
+inline intptr_t getGridOffset(int ind, int shift, intptr_t stride, intptr_t brick_stride)
+{
+  return (ind >> shift) * brick_stride + (ind & ((1 << shift) - 1)) * stride;
+}
+
+/** compute the offsets of the 4x4x4 coefficient rows of the stencil at (ix,iy,iz)
+ *
+ * The row of grid point (ix+i,iy+j,iz+k) starts at coefs + ox[i] + oy[j] + oz[k],
+ * both in the x-major layout and in the brick layout, where the grid is split into
+ * bricks of 2^brick_shift points along each direction and each brick is contiguous.
+ */
+template<typename SplineType>
+inline void computeRowOffsets(const SplineType* restrict spline_m,
+                              int ix,
+                              int iy,
+                              int iz,
+                              intptr_t ox[4],
+                              intptr_t oy[4],
+                              intptr_t oz[4])
+{
+  const int shift = spline_m->brick_shift;
+  for (int k = 0; k < 4; k++)
+  {
+    ox[k] = getGridOffset(ix + k, shift, spline_m->x_stride, spline_m->x_brick_stride);
+    oy[k] = getGridOffset(iy + k, shift, spline_m->y_stride, spline_m->y_brick_stride);
+    oz[k] = getGridOffset(iz + k, shift, spline_m->z_stride, spline_m->z_brick_stride);
+  }
+}
+
+/// offset of the coefficient row of grid point (ix,iy,iz)
+template<typename SplineType>
+inline intptr_t getRowOffset(const SplineType* restrict spline_m, int ix, int iy, int iz)
+{
+  const int shift = spline_m->brick_shift;
+  return getGridOffset(ix, shift, spline_m->x_stride, spline_m->x_brick_stride) +
+      getGridOffset(iy, shift, spline_m->y_stride, spline_m->y_brick_stride) +
+      getGridOffset(iz, shift, spline_m->z_stride, spline_m->z_brick_stride);
 }
 
 } // namespace spline2
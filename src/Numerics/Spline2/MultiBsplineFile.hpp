@@ -0,0 +1,318 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file MultiBsplineFile.hpp
+ *
+ * Binary file format of multi-bspline coefficients and its memory-mapped reader.
+ *
+ * The file starts with a MultiBsplineFileHeader, followed by the parities of the
+ * multi-bsplines with inversion symmetry, padded to a multiple of MultiBsplineFileAlignment
+ * bytes. It is followed by num_blocks coefficient payloads, each starting at
+ * payload_offset + i * block_bytes, a multiple of MultiBsplineFileAlignment.
+ * A payload is the coefs array of a multi_UBspline_3d as laid out in memory,
+ * coefs_size coefficients of coef_bytes each, in the native byte order.
+ *
+ * The reader maps the file read-only so that the coefficients are paged in on
+ * demand and processes on a node share a single page-cache copy.
+ */
+#ifndef QMCPLUSPLUS_MULTIBSPLINE_FILE_HPP
+#define QMCPLUSPLUS_MULTIBSPLINE_FILE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <Numerics/Spline2/bspline_half.hpp>
+
+namespace qmcplusplus
+{
+namespace spline2
+{
+/// alignment of the header and the payloads in bytes, a multiple of the page size
+constexpr size_t MultiBsplineFileAlignment = 4096;
+
+/// header of a multi-bspline coefficient file
+struct MultiBsplineFileHeader
+{
+  /// "MQMCSPL"
+  char magic[8];
+  /// format version
+  uint32_t version;
+  /// bytes per coefficient
+  uint32_t coef_bytes;
+  /// SplineStorage of the coefficients
+  uint32_t storage;
+  /// number of multi-bsplines
+  uint32_t num_blocks;
+  /// number of splines of each multi-bspline
+  uint32_t num_splines;
+  /// boundary condition codes, lCode and rCode of x, y and z
+  uint32_t bc_code[6];
+  /// number of grid points of x, y and z
+  int32_t grid_num[3];
+  /// boundary condition values, lVal and rVal of x, y and z
+  double bc_val[6];
+  /// grid start, end, delta and delta_inv of x, y and z
+  double grid_start[3], grid_end[3], grid_delta[3], grid_delta_inv[3];
+  /// strides of the coefficients
+  int64_t x_stride, y_stride, z_stride;
+  /// log2 of the brick edge, 0 for the x-major layout, since version 2
+  int64_t brick_shift;
+  /// strides between the bricks, since version 2
+  int64_t x_brick_stride, y_brick_stride, z_brick_stride;
+  /// 1 if the multi-bsplines store half of the grid with inversion symmetry, since version 3,
+  /// the parity of each one is then an int8_t following the header
+  int64_t inversion;
+  /// number of coefficients of each multi-bspline
+  uint64_t coefs_size;
+  /// byte offset of the first payload
+  uint64_t payload_offset;
+  /// byte distance between two payloads
+  uint64_t block_bytes;
+
+  static constexpr uint32_t current_version = 3;
+
+  static const char* getMagic() { return "MQMCSPL"; }
+
+  /** true if this is the header of a file of file_length bytes written by writeMultiBsplines
+   *
+   * The payloads must fit in their blocks and the blocks in the file, the products are
+   * checked as quotients so that corrupt sizes cannot overflow.
+   */
+  bool isValid(size_t file_length) const
+  {
+    return std::strncmp(magic, getMagic(), sizeof(magic)) == 0 && version == current_version && coef_bytes > 0 &&
+        block_bytes > 0 && coefs_size <= block_bytes / coef_bytes && payload_offset <= file_length &&
+        num_blocks <= (file_length - payload_offset) / block_bytes &&
+        sizeof(MultiBsplineFileHeader) + (inversion ? num_blocks : 0) <= payload_offset &&
+        payload_offset % MultiBsplineFileAlignment == 0 && block_bytes % MultiBsplineFileAlignment == 0;
+  }
+};
+
+/** write multi-bsplines to a coefficient file
+ * @param fname file name
+ * @param splines multi-bsplines of the same grid and number of splines
+ * @param num_blocks number of multi-bsplines
+ * @param storage storage type of the coefficients
+ *
+ * The file is written under a temporary name and renamed once complete, so
+ * concurrent writers and readers never see a partial file.
+ */
+template<typename SplineType>
+void writeMultiBsplines(const std::string& fname, SplineType* const* splines, int num_blocks, SplineStorage storage)
+{
+  using coef_type          = typename bspline_type<SplineType>::value_type;
+  const SplineType* spline = splines[0];
+
+  MultiBsplineFileHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::strncpy(header.magic, MultiBsplineFileHeader::getMagic(), sizeof(header.magic));
+  header.version     = MultiBsplineFileHeader::current_version;
+  header.coef_bytes  = sizeof(coef_type);
+  header.storage     = static_cast<uint32_t>(storage);
+  header.num_blocks  = num_blocks;
+  header.num_splines = spline->num_splines;
+  const Ugrid* grids[3] = {&spline->x_grid, &spline->y_grid, &spline->z_grid};
+  const decltype(spline->xBC)* bcs[3] = {&spline->xBC, &spline->yBC, &spline->zBC};
+  for (int d = 0; d < 3; d++)
+  {
+    header.bc_code[2 * d]     = bcs[d]->lCode;
+    header.bc_code[2 * d + 1] = bcs[d]->rCode;
+    header.bc_val[2 * d]      = bcs[d]->lVal;
+    header.bc_val[2 * d + 1]  = bcs[d]->rVal;
+    header.grid_num[d]        = grids[d]->num;
+    header.grid_start[d]      = grids[d]->start;
+    header.grid_end[d]        = grids[d]->end;
+    header.grid_delta[d]      = grids[d]->delta;
+    header.grid_delta_inv[d]  = grids[d]->delta_inv;
+  }
+  header.x_stride   = spline->x_stride;
+  header.y_stride   = spline->y_stride;
+  header.z_stride   = spline->z_stride;
+  header.brick_shift    = spline->brick_shift;
+  header.x_brick_stride = spline->x_brick_stride;
+  header.y_brick_stride = spline->y_brick_stride;
+  header.z_brick_stride = spline->z_brick_stride;
+  header.inversion      = spline->inversion != 0;
+  header.coefs_size = spline->coefs_size;
+  std::vector<int8_t> parities;
+  for (int ib = 0; ib < num_blocks && header.inversion; ib++)
+    parities.push_back(splines[ib]->inversion);
+  const size_t payload_bytes = spline->coefs_size * sizeof(coef_type);
+  header.payload_offset      = (sizeof(header) + parities.size() + MultiBsplineFileAlignment - 1) /
+      MultiBsplineFileAlignment * MultiBsplineFileAlignment;
+  header.block_bytes =
+      (payload_bytes + MultiBsplineFileAlignment - 1) / MultiBsplineFileAlignment * MultiBsplineFileAlignment;
+
+  const std::string tmp_name = fname + ".tmp." + std::to_string(getpid());
+  int fd                     = ::open(tmp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    throw std::runtime_error("Cannot create the spline coefficient file " + tmp_name);
+  bool success = ::pwrite(fd, &header, sizeof(header), 0) == sizeof(header);
+  if (!parities.empty())
+    success = success &&
+        ::pwrite(fd, parities.data(), parities.size(), sizeof(header)) == static_cast<ssize_t>(parities.size());
+  for (int ib = 0; ib < num_blocks && success; ib++)
+  {
+    const char* payload = reinterpret_cast<const char*>(splines[ib]->coefs);
+    const off_t offset  = header.payload_offset + ib * header.block_bytes;
+    for (size_t done = 0; done < payload_bytes && success;)
+    {
+      const ssize_t written = ::pwrite(fd, payload + done, payload_bytes - done, offset + done);
+      success               = written > 0;
+      done += written;
+    }
+  }
+  // extend the file to the end of the last padded payload
+  success = success && ::ftruncate(fd, header.payload_offset + num_blocks * header.block_bytes) == 0;
+  success = (::close(fd) == 0) && success;
+  if (!success || std::rename(tmp_name.c_str(), fname.c_str()) != 0)
+  {
+    std::remove(tmp_name.c_str());
+    throw std::runtime_error("Failed in writing the spline coefficient file " + fname);
+  }
+}
+
+/** create a multi-bspline described by the header of a coefficient file, without coefficients
+ * @param inversion parity of the multi-bspline, stored after the header
+ */
+template<typename SplineType>
+SplineType* createMultiBsplineFromHeader(const MultiBsplineFileHeader& header, int inversion)
+{
+  using coef_type = typename bspline_type<SplineType>::value_type;
+  if (header.coef_bytes != sizeof(coef_type))
+    throw std::runtime_error("Mismatched coefficient size in the spline coefficient file");
+  SplineType* spline = new SplineType;
+  Ugrid* grids[3]    = {&spline->x_grid, &spline->y_grid, &spline->z_grid};
+  decltype(spline->xBC)* bcs[3] = {&spline->xBC, &spline->yBC, &spline->zBC};
+  for (int d = 0; d < 3; d++)
+  {
+    bcs[d]->lCode      = static_cast<bc_code>(header.bc_code[2 * d]);
+    bcs[d]->rCode      = static_cast<bc_code>(header.bc_code[2 * d + 1]);
+    bcs[d]->lVal       = header.bc_val[2 * d];
+    bcs[d]->rVal       = header.bc_val[2 * d + 1];
+    grids[d]->num       = header.grid_num[d];
+    grids[d]->start     = header.grid_start[d];
+    grids[d]->end       = header.grid_end[d];
+    grids[d]->delta     = header.grid_delta[d];
+    grids[d]->delta_inv = header.grid_delta_inv[d];
+  }
+  spline->num_splines = header.num_splines;
+  spline->x_stride    = header.x_stride;
+  spline->y_stride    = header.y_stride;
+  spline->z_stride    = header.z_stride;
+  spline->brick_shift    = header.brick_shift;
+  spline->x_brick_stride = header.x_brick_stride;
+  spline->y_brick_stride = header.y_brick_stride;
+  spline->z_brick_stride = header.z_brick_stride;
+  spline->inversion      = inversion;
+  spline->coefs_size  = header.coefs_size;
+  spline->coefs       = nullptr;
+  return spline;
+}
+
+/** read-only memory map of a multi-bspline coefficient file
+ *
+ * Multi-bsplines created by createMultiBspline point into the mapping and must be
+ * released by destroy before this object goes out of scope.
+ */
+class MappedMultiBsplines
+{
+  /// beginning of the mapping
+  char* base;
+  /// size of the mapping
+  size_t length;
+
+public:
+  /// header of the mapped file
+  MultiBsplineFileHeader header;
+
+  MappedMultiBsplines() : base(nullptr), length(0) {}
+  MappedMultiBsplines(const MappedMultiBsplines&) = delete;
+  MappedMultiBsplines& operator=(const MappedMultiBsplines&) = delete;
+  ~MappedMultiBsplines() { close(); }
+
+  /** map a coefficient file
+   * @return false if the file does not exist
+   *
+   * Throws if the file cannot be mapped or is not a valid coefficient file.
+   */
+  bool open(const std::string& fname)
+  {
+    close();
+    int fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(header))
+    {
+      ::close(fd);
+      throw std::runtime_error("Invalid spline coefficient file " + fname);
+    }
+    void* addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+      throw std::runtime_error("Failed in mapping the spline coefficient file " + fname);
+    base   = static_cast<char*>(addr);
+    length = st.st_size;
+    std::memcpy(&header, base, sizeof(header));
+    if (!header.isValid(length))
+    {
+      close();
+      throw std::runtime_error("Invalid spline coefficient file " + fname);
+    }
+    return true;
+  }
+
+  /// unmap the file
+  void close()
+  {
+    if (base)
+      ::munmap(base, length);
+    base   = nullptr;
+    length = 0;
+  }
+
+  /// storage type of the coefficients
+  SplineStorage getStorage() const { return static_cast<SplineStorage>(header.storage); }
+
+  /** create a multi-bspline of the ib-th payload
+   * @param ib index of the multi-bspline
+   *
+   * The coefficients are not copied and are read-only.
+   */
+  template<typename SplineType>
+  SplineType* createMultiBspline(int ib) const
+  {
+    using coef_type    = typename bspline_type<SplineType>::value_type;
+    const int parity   = header.inversion ? reinterpret_cast<const int8_t*>(base + sizeof(header))[ib] : 0;
+    SplineType* spline = createMultiBsplineFromHeader<SplineType>(header, parity);
+    spline->coefs      = reinterpret_cast<coef_type*>(base + header.payload_offset + ib * header.block_bytes);
+    return spline;
+  }
+
+  /// release a multi-bspline created by createMultiBspline
+  template<typename SplineType>
+  void destroy(SplineType* spline) const
+  {
+    delete spline;
+  }
+};
+
+} // namespace spline2
+} // namespace qmcplusplus
+#endif
@@ -0,0 +1,251 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file MultiBsplineSIMD.cpp
+ *
+ * CPU detection and the kernel tables. The explicitly vectorized kernels are
+ * compiled in when QMC_SPLINE_AVX2 and QMC_SPLINE_AVX512 are defined.
+ */
+#include <config.h>
+#include <stdexcept>
+#include <Numerics/Spline2/MultiBsplineSIMD.h>
+#include <Numerics/Spline2/MultiBsplineSIMDKernels.hpp>
+#include <Numerics/Spline2/MultiBspline.hpp>
+
+namespace qmcplusplus
+{
+namespace spline2
+{
+std::string getSplineISAName(SplineISA isa)
+{
+  if (isa == SplineISA::AVX2)
+    return "avx2";
+  else if (isa == SplineISA::AVX512)
+    return "avx512";
+  return "generic";
+}
+
+bool parseSplineISA(const std::string& name, SplineISA& isa)
+{
+  if (name == "auto")
+    isa = getBestSplineISA();
+  else if (name == "generic")
+    isa = SplineISA::GENERIC;
+  else if (name == "avx2")
+    isa = SplineISA::AVX2;
+  else if (name == "avx512")
+    isa = SplineISA::AVX512;
+  else
+    return false;
+  return true;
+}
+
+bool isSplineISASupported(SplineISA isa)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  // __builtin_cpu_supports also checks that the OS saves the extended registers
+  if (isa == SplineISA::AVX2)
+  {
+#ifdef QMC_SPLINE_AVX2
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+    return false;
+#endif
+  }
+  if (isa == SplineISA::AVX512)
+  {
+#ifdef QMC_SPLINE_AVX512
+    return __builtin_cpu_supports("avx512f");
+#else
+    return false;
+#endif
+  }
+#endif
+  return isa == SplineISA::GENERIC;
+}
+
+SplineISA getBestSplineISA()
+{
+  if (isSplineISASupported(SplineISA::AVX512))
+    return SplineISA::AVX512;
+  if (isSplineISASupported(SplineISA::AVX2))
+    return SplineISA::AVX2;
+  return SplineISA::GENERIC;
+}
+
+static SplineISA& activeSplineISA()
+{
+  static SplineISA isa = getBestSplineISA();
+  return isa;
+}
+
+SplineISA getSplineISA() { return activeSplineISA(); }
+
+bool setSplineISA(SplineISA isa)
+{
+  if (!isSplineISASupported(isa))
+    return false;
+  activeSplineISA() = isa;
+  return true;
+}
+
+/// scalar setup of the explicitly vectorized kernels
+template<typename T>
+static void computeStencil(const typename bspline_traits<T, 3>::SplineType* spline_m,
+                           T x,
+                           T y,
+                           T z,
+                           SplineStencil<T>& st)
+{
+  int ix, iy, iz;
+  T a[4], b[4], da[4], db[4], d2a[4], d2b[4];
+  computeLocationAndFractional(spline_m, x, y, z, ix, iy, iz, a, b, st.c, da, db, st.dc, d2a, d2b, st.d2c);
+
+  computeRowOffsets(spline_m, ix, iy, iz, st.ox, st.oy, st.oz);
+  st.coefs      = spline_m->coefs;
+  st.out_offset = spline_m->num_splines;
+
+  const T dxInv = spline_m->x_grid.delta_inv;
+  const T dyInv = spline_m->y_grid.delta_inv;
+  const T dzInv = spline_m->z_grid.delta_inv;
+  for (int k = 0; k < 4; k++)
+  {
+    st.dc[k] *= dzInv;
+    st.d2c[k] *= dzInv * dzInv;
+  }
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+    {
+      const int ij = 4 * i + j;
+      st.p00[ij]   = a[i] * b[j];
+      st.p10[ij]   = da[i] * b[j] * dxInv;
+      st.p01[ij]   = a[i] * db[j] * dyInv;
+      st.p20[ij]   = d2a[i] * b[j] * dxInv * dxInv;
+      st.p11[ij]   = da[i] * db[j] * dxInv * dyInv;
+      st.p02[ij]   = a[i] * d2b[j] * dyInv * dyInv;
+    }
+}
+
+/// value only kernels do not need the derivatives of the prefactors
+template<typename T>
+static void computeStencil_v(const typename bspline_traits<T, 3>::SplineType* spline_m,
+                             T x,
+                             T y,
+                             T z,
+                             SplineStencil<T>& st)
+{
+  int ix, iy, iz;
+  T a[4], b[4];
+  computeLocationAndFractional(spline_m, x, y, z, ix, iy, iz, a, b, st.c);
+  computeRowOffsets(spline_m, ix, iy, iz, st.ox, st.oy, st.oz);
+  st.coefs      = spline_m->coefs;
+  st.out_offset = spline_m->num_splines;
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+      st.p00[4 * i + j] = a[i] * b[j];
+}
+
+/// entry of an explicitly vectorized value kernel
+template<typename T, void (*KERNEL)(const SplineStencil<T>&, T*, size_t)>
+static void evaluate_v_entry(const typename bspline_traits<T, 3>::SplineType* spline_m,
+                             T x,
+                             T y,
+                             T z,
+                             T* vals,
+                             size_t num_splines)
+{
+  SplineStencil<T> st;
+  computeStencil_v(spline_m, x, y, z, st);
+  KERNEL(st, vals, num_splines);
+}
+
+/// entry of an explicitly vectorized laplacian kernel
+template<typename T, void (*KERNEL)(const SplineStencil<T>&, T*, size_t)>
+static void evaluate_l_entry(const typename bspline_traits<T, 3>::SplineType* spline_m,
+                             T x,
+                             T y,
+                             T z,
+                             T* lapl,
+                             size_t num_splines)
+{
+  SplineStencil<T> st;
+  computeStencil(spline_m, x, y, z, st);
+  KERNEL(st, lapl, num_splines);
+}
+
+/// entry of an explicitly vectorized vg kernel
+template<typename T, void (*KERNEL)(const SplineStencil<T>&, T*, T*, size_t)>
+static void evaluate_vg_entry(const typename bspline_traits<T, 3>::SplineType* spline_m,
+                              T x,
+                              T y,
+                              T z,
+                              T* vals,
+                              T* grads,
+                              size_t num_splines)
+{
+  SplineStencil<T> st;
+  computeStencil(spline_m, x, y, z, st);
+  KERNEL(st, vals, grads, num_splines);
+}
+
+/// entry of an explicitly vectorized vgl or vgh kernel
+template<typename T, void (*KERNEL)(const SplineStencil<T>&, T*, T*, T*, size_t)>
+static void evaluate_vgx_entry(const typename bspline_traits<T, 3>::SplineType* spline_m,
+                               T x,
+                               T y,
+                               T z,
+                               T* vals,
+                               T* grads,
+                               T* lx,
+                               size_t num_splines)
+{
+  SplineStencil<T> st;
+  computeStencil(spline_m, x, y, z, st);
+  KERNEL(st, vals, grads, lx, num_splines);
+}
+
+template<typename T>
+const MultiBsplineKernels<T>& getMultiBsplineKernels(SplineISA isa)
+{
+  using SplineType = typename bspline_traits<T, 3>::SplineType;
+  static const MultiBsplineKernels<T> generic = {&MultiBsplineEval::evaluate_v<SplineType, T>,
+                                                 &MultiBsplineEval::evaluate_vg<SplineType, T>,
+                                                 &MultiBsplineEval::evaluate_l<SplineType, T>,
+                                                 &MultiBsplineEval::evaluate_vgl<SplineType, T>,
+                                                 &MultiBsplineEval::evaluate_vgh<SplineType, T>};
+#ifdef QMC_SPLINE_AVX2
+  static const MultiBsplineKernels<T> avx2_kernels = {&evaluate_v_entry<T, &avx2::evaluate_v<T>>,
+                                                      &evaluate_vg_entry<T, &avx2::evaluate_vg<T>>,
+                                                      &evaluate_l_entry<T, &avx2::evaluate_l<T>>,
+                                                      &evaluate_vgx_entry<T, &avx2::evaluate_vgl<T>>,
+                                                      &evaluate_vgx_entry<T, &avx2::evaluate_vgh<T>>};
+  if (isa == SplineISA::AVX2 && isSplineISASupported(isa))
+    return avx2_kernels;
+#endif
+#ifdef QMC_SPLINE_AVX512
+  static const MultiBsplineKernels<T> avx512_kernels = {&evaluate_v_entry<T, &avx512::evaluate_v<T>>,
+                                                        &evaluate_vg_entry<T, &avx512::evaluate_vg<T>>,
+                                                        &evaluate_l_entry<T, &avx512::evaluate_l<T>>,
+                                                        &evaluate_vgx_entry<T, &avx512::evaluate_vgl<T>>,
+                                                        &evaluate_vgx_entry<T, &avx512::evaluate_vgh<T>>};
+  if (isa == SplineISA::AVX512 && isSplineISASupported(isa))
+    return avx512_kernels;
+#endif
+  if (isa != SplineISA::GENERIC)
+    throw std::runtime_error("Spline kernels " + getSplineISAName(isa) + " are not supported");
+  return generic;
+}
+
+template const MultiBsplineKernels<float>& getMultiBsplineKernels<float>(SplineISA isa);
+template const MultiBsplineKernels<double>& getMultiBsplineKernels<double>(SplineISA isa);
+
+} // namespace spline2
+} // namespace qmcplusplus
@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file MultiBsplineSIMD.h
+ *
+ * Runtime selection of the 3D multi-bspline evaluation kernels.
+ *
+ * Besides the generic kernels of MultiBsplineEval, explicitly vectorized kernels
+ * are compiled for AVX2+FMA and AVX-512 in their own translation units, when the
+ * compiler supports them. The best instruction set supported by the CPU is
+ * selected at the first use, and can be overridden with setSplineISA.
+ * Only the full precision multi-bsplines have the explicitly vectorized kernels.
+ */
+#ifndef QMCPLUSPLUS_MULTIBSPLINE_SIMD_H
+#define QMCPLUSPLUS_MULTIBSPLINE_SIMD_H
+
+#include <cstddef>
+#include <string>
+#include <Numerics/Spline2/bspline_traits.hpp>
+
+namespace qmcplusplus
+{
+namespace spline2
+{
+/// instruction set of the spline kernels
+enum class SplineISA
+{
+  GENERIC, // compiler vectorized
+  AVX2,    // AVX2 and FMA
+  AVX512   // AVX-512F
+};
+
+/// name of the instruction set
+std::string getSplineISAName(SplineISA isa);
+
+/** parse the name of the instruction set, auto for the best supported one
+ * @return false if the name is not recognized
+ */
+bool parseSplineISA(const std::string& name, SplineISA& isa);
+
+/// true if the kernels of isa are compiled in and supported by the CPU
+bool isSplineISASupported(SplineISA isa);
+
+/// the fastest instruction set supported
+SplineISA getBestSplineISA();
+
+/// instruction set of the kernels in use
+SplineISA getSplineISA();
+
+/** select the kernels in use, not thread safe
+ * @return false if isa is not supported, the selection is not changed
+ */
+bool setSplineISA(SplineISA isa);
+
+/// evaluation kernels of multi-bsplines of T, same interface as MultiBsplineEval
+template<typename T>
+struct MultiBsplineKernels
+{
+  using SplineType = typename bspline_traits<T, 3>::SplineType;
+
+  void (*evaluate_v)(const SplineType* spline_m, T x, T y, T z, T* vals, size_t num_splines);
+  void (*evaluate_vg)(const SplineType* spline_m, T x, T y, T z, T* vals, T* grads, size_t num_splines);
+  void (*evaluate_l)(const SplineType* spline_m, T x, T y, T z, T* lapl, size_t num_splines);
+  void (*evaluate_vgl)(const SplineType* spline_m, T x, T y, T z, T* vals, T* grads, T* lapl, size_t num_splines);
+  void (*evaluate_vgh)(const SplineType* spline_m, T x, T y, T z, T* vals, T* grads, T* hess, size_t num_splines);
+};
+
+/** kernels of an instruction set
+ *
+ * Throws if isa is not supported.
+ */
+template<typename T>
+const MultiBsplineKernels<T>& getMultiBsplineKernels(SplineISA isa);
+
+/// kernels in use
+template<typename T>
+inline const MultiBsplineKernels<T>& getMultiBsplineKernels()
+{
+  return getMultiBsplineKernels<T>(getSplineISA());
+}
+
+} // namespace spline2
+} // namespace qmcplusplus
+#endif
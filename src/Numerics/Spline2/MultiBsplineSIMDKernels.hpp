@@ -0,0 +1,323 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file MultiBsplineSIMDKernels.hpp
+ *
+ * Explicitly vectorized multi-bspline kernels, shared by the AVX2 and AVX-512
+ * translation units. Each of them includes this file after defining its vector
+ * types, and instantiates the kernels in its own namespace.
+ *
+ * The kernels take a SplineStencil prepared by the generic code, so that no
+ * function compiled with the extended instruction sets is shared with the rest
+ * of the program. Everything here has internal linkage for the same reason.
+ *
+ * A chunk of splines is accumulated in registers over the 4x4 rows of the stencil
+ * and stored once. The scaling by the grid spacing is folded into the prefactors.
+ */
+#ifndef QMCPLUSPLUS_MULTIBSPLINE_SIMD_KERNELS_HPP
+#define QMCPLUSPLUS_MULTIBSPLINE_SIMD_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace qmcplusplus
+{
+namespace spline2
+{
+/// position dependent data of an evaluation
+template<typename T>
+struct SplineStencil
+{
+  /// coefficients of the spline
+  const T* coefs;
+  /// offsets of the coefficient rows, see computeRowOffsets
+  intptr_t ox[4], oy[4], oz[4];
+  /// distance between the components of the outputs
+  size_t out_offset;
+  /// z prefactors, the derivatives scaled by the grid spacing
+  T c[4], dc[4], d2c[4];
+  /// prefactors of the 4x4 (x,y) rows, scaled by the grid spacing
+  T p00[16], p10[16], p01[16], p20[16], p11[16], p02[16];
+};
+
+namespace avx2
+{
+template<typename T>
+void evaluate_v(const SplineStencil<T>& st, T* vals, size_t num_splines);
+template<typename T>
+void evaluate_vg(const SplineStencil<T>& st, T* vals, T* grads, size_t num_splines);
+template<typename T>
+void evaluate_l(const SplineStencil<T>& st, T* lapl, size_t num_splines);
+template<typename T>
+void evaluate_vgl(const SplineStencil<T>& st, T* vals, T* grads, T* lapl, size_t num_splines);
+template<typename T>
+void evaluate_vgh(const SplineStencil<T>& st, T* vals, T* grads, T* hess, size_t num_splines);
+} // namespace avx2
+
+namespace avx512
+{
+template<typename T>
+void evaluate_v(const SplineStencil<T>& st, T* vals, size_t num_splines);
+template<typename T>
+void evaluate_vg(const SplineStencil<T>& st, T* vals, T* grads, size_t num_splines);
+template<typename T>
+void evaluate_l(const SplineStencil<T>& st, T* lapl, size_t num_splines);
+template<typename T>
+void evaluate_vgl(const SplineStencil<T>& st, T* vals, T* grads, T* lapl, size_t num_splines);
+template<typename T>
+void evaluate_vgh(const SplineStencil<T>& st, T* vals, T* grads, T* hess, size_t num_splines);
+} // namespace avx512
+
+#ifdef QMC_SPLINE_SIMD_KERNELS
+namespace
+{
+/// one-lane vector for the remainder of the splines
+template<typename T>
+struct ScalarSIMD
+{
+  using type                 = T;
+  static constexpr int width = 1;
+  static type load(const T* p) { return *p; }
+  static void store(T* p, type v) { *p = v; }
+  static type set1(T a) { return a; }
+  static type zero() { return T(0); }
+  static type add(type a, type b) { return a + b; }
+  static type mul(type a, type b) { return a * b; }
+  static type fmadd(type a, type b, type c) { return a * b + c; }
+};
+
+template<typename V, typename T>
+inline void v_chunk(const SplineStencil<T>& st, size_t n, T* vals)
+{
+  using vt      = typename V::type;
+  const vt c0   = V::set1(st.c[0]);
+  const vt c1   = V::set1(st.c[1]);
+  const vt c2   = V::set1(st.c[2]);
+  const vt c3   = V::set1(st.c[3]);
+  const T* base = st.coefs + n;
+  // one accumulator per x row to break the dependency chain
+  vt v[4] = {V::zero(), V::zero(), V::zero(), V::zero()};
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+    {
+      const T* p  = base + st.ox[i] + st.oy[j];
+      const vt s0 = V::fmadd(c0, V::load(p + st.oz[0]),
+                             V::fmadd(c1, V::load(p + st.oz[1]),
+                                      V::fmadd(c2, V::load(p + st.oz[2]), V::mul(c3, V::load(p + st.oz[3])))));
+      v[i] = V::fmadd(V::set1(st.p00[4 * i + j]), s0, v[i]);
+    }
+  V::store(vals + n, V::add(V::add(v[0], v[1]), V::add(v[2], v[3])));
+}
+
+template<typename V, typename T>
+inline void vg_chunk(const SplineStencil<T>& st, size_t n, T* vals, T* grads)
+{
+  using vt      = typename V::type;
+  const T* base = st.coefs + n;
+  vt v = V::zero(), gx = V::zero(), gy = V::zero(), gz = V::zero();
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+    {
+      const T* p     = base + st.ox[i] + st.oy[j];
+      const vt q0    = V::load(p + st.oz[0]);
+      const vt q1    = V::load(p + st.oz[1]);
+      const vt q2    = V::load(p + st.oz[2]);
+      const vt q3    = V::load(p + st.oz[3]);
+      const vt s0    = V::fmadd(V::set1(st.c[0]), q0,
+                             V::fmadd(V::set1(st.c[1]), q1,
+                                      V::fmadd(V::set1(st.c[2]), q2, V::mul(V::set1(st.c[3]), q3))));
+      const vt s1    = V::fmadd(V::set1(st.dc[0]), q0,
+                             V::fmadd(V::set1(st.dc[1]), q1,
+                                      V::fmadd(V::set1(st.dc[2]), q2, V::mul(V::set1(st.dc[3]), q3))));
+      const int ij   = 4 * i + j;
+      const vt pre00 = V::set1(st.p00[ij]);
+      v              = V::fmadd(pre00, s0, v);
+      gx             = V::fmadd(V::set1(st.p10[ij]), s0, gx);
+      gy             = V::fmadd(V::set1(st.p01[ij]), s0, gy);
+      gz             = V::fmadd(pre00, s1, gz);
+    }
+  V::store(vals + n, v);
+  V::store(grads + n, gx);
+  V::store(grads + st.out_offset + n, gy);
+  V::store(grads + 2 * st.out_offset + n, gz);
+}
+
+template<typename V, typename T>
+inline void l_chunk(const SplineStencil<T>& st, size_t n, T* lapl)
+{
+  using vt      = typename V::type;
+  const T* base = st.coefs + n;
+  vt l = V::zero();
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+    {
+      const T* p   = base + st.ox[i] + st.oy[j];
+      const vt q0  = V::load(p + st.oz[0]);
+      const vt q1  = V::load(p + st.oz[1]);
+      const vt q2  = V::load(p + st.oz[2]);
+      const vt q3  = V::load(p + st.oz[3]);
+      const vt s0  = V::fmadd(V::set1(st.c[0]), q0,
+                             V::fmadd(V::set1(st.c[1]), q1,
+                                      V::fmadd(V::set1(st.c[2]), q2, V::mul(V::set1(st.c[3]), q3))));
+      const vt s2  = V::fmadd(V::set1(st.d2c[0]), q0,
+                             V::fmadd(V::set1(st.d2c[1]), q1,
+                                      V::fmadd(V::set1(st.d2c[2]), q2, V::mul(V::set1(st.d2c[3]), q3))));
+      const int ij = 4 * i + j;
+      l            = V::fmadd(V::set1(st.p20[ij] + st.p02[ij]), s0, V::fmadd(V::set1(st.p00[ij]), s2, l));
+    }
+  V::store(lapl + n, l);
+}
+
+template<typename V, typename T>
+inline void vgl_chunk(const SplineStencil<T>& st, size_t n, T* vals, T* grads, T* lapl)
+{
+  using vt      = typename V::type;
+  const T* base = st.coefs + n;
+  vt v = V::zero(), gx = V::zero(), gy = V::zero(), gz = V::zero(), l = V::zero();
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+    {
+      const T* p    = base + st.ox[i] + st.oy[j];
+      const vt q0   = V::load(p + st.oz[0]);
+      const vt q1   = V::load(p + st.oz[1]);
+      const vt q2   = V::load(p + st.oz[2]);
+      const vt q3   = V::load(p + st.oz[3]);
+      const vt s0   = V::fmadd(V::set1(st.c[0]), q0,
+                             V::fmadd(V::set1(st.c[1]), q1,
+                                      V::fmadd(V::set1(st.c[2]), q2, V::mul(V::set1(st.c[3]), q3))));
+      const vt s1   = V::fmadd(V::set1(st.dc[0]), q0,
+                             V::fmadd(V::set1(st.dc[1]), q1,
+                                      V::fmadd(V::set1(st.dc[2]), q2, V::mul(V::set1(st.dc[3]), q3))));
+      const vt s2   = V::fmadd(V::set1(st.d2c[0]), q0,
+                             V::fmadd(V::set1(st.d2c[1]), q1,
+                                      V::fmadd(V::set1(st.d2c[2]), q2, V::mul(V::set1(st.d2c[3]), q3))));
+      const int ij  = 4 * i + j;
+      const vt pre00 = V::set1(st.p00[ij]);
+      v              = V::fmadd(pre00, s0, v);
+      gx             = V::fmadd(V::set1(st.p10[ij]), s0, gx);
+      gy             = V::fmadd(V::set1(st.p01[ij]), s0, gy);
+      gz             = V::fmadd(pre00, s1, gz);
+      l              = V::fmadd(V::set1(st.p20[ij] + st.p02[ij]), s0, V::fmadd(pre00, s2, l));
+    }
+  V::store(vals + n, v);
+  V::store(grads + n, gx);
+  V::store(grads + st.out_offset + n, gy);
+  V::store(grads + 2 * st.out_offset + n, gz);
+  V::store(lapl + n, l);
+}
+
+template<typename V, typename T>
+inline void vgh_chunk(const SplineStencil<T>& st, size_t n, T* vals, T* grads, T* hess)
+{
+  using vt      = typename V::type;
+  const T* base = st.coefs + n;
+  vt v = V::zero(), gx = V::zero(), gy = V::zero(), gz = V::zero();
+  vt hxx = V::zero(), hxy = V::zero(), hxz = V::zero(), hyy = V::zero(), hyz = V::zero(), hzz = V::zero();
+  for (int i = 0; i < 4; i++)
+    for (int j = 0; j < 4; j++)
+    {
+      const T* p    = base + st.ox[i] + st.oy[j];
+      const vt q0   = V::load(p + st.oz[0]);
+      const vt q1   = V::load(p + st.oz[1]);
+      const vt q2   = V::load(p + st.oz[2]);
+      const vt q3   = V::load(p + st.oz[3]);
+      const vt s0   = V::fmadd(V::set1(st.c[0]), q0,
+                             V::fmadd(V::set1(st.c[1]), q1,
+                                      V::fmadd(V::set1(st.c[2]), q2, V::mul(V::set1(st.c[3]), q3))));
+      const vt s1   = V::fmadd(V::set1(st.dc[0]), q0,
+                             V::fmadd(V::set1(st.dc[1]), q1,
+                                      V::fmadd(V::set1(st.dc[2]), q2, V::mul(V::set1(st.dc[3]), q3))));
+      const vt s2   = V::fmadd(V::set1(st.d2c[0]), q0,
+                             V::fmadd(V::set1(st.d2c[1]), q1,
+                                      V::fmadd(V::set1(st.d2c[2]), q2, V::mul(V::set1(st.d2c[3]), q3))));
+      const int ij   = 4 * i + j;
+      const vt pre00 = V::set1(st.p00[ij]);
+      const vt pre10 = V::set1(st.p10[ij]);
+      const vt pre01 = V::set1(st.p01[ij]);
+      v              = V::fmadd(pre00, s0, v);
+      gx             = V::fmadd(pre10, s0, gx);
+      gy             = V::fmadd(pre01, s0, gy);
+      gz             = V::fmadd(pre00, s1, gz);
+      hxx            = V::fmadd(V::set1(st.p20[ij]), s0, hxx);
+      hxy            = V::fmadd(V::set1(st.p11[ij]), s0, hxy);
+      hxz            = V::fmadd(pre10, s1, hxz);
+      hyy            = V::fmadd(V::set1(st.p02[ij]), s0, hyy);
+      hyz            = V::fmadd(pre01, s1, hyz);
+      hzz            = V::fmadd(pre00, s2, hzz);
+    }
+  const size_t off = st.out_offset;
+  V::store(vals + n, v);
+  V::store(grads + n, gx);
+  V::store(grads + off + n, gy);
+  V::store(grads + 2 * off + n, gz);
+  V::store(hess + n, hxx);
+  V::store(hess + off + n, hxy);
+  V::store(hess + 2 * off + n, hxz);
+  V::store(hess + 3 * off + n, hyy);
+  V::store(hess + 4 * off + n, hyz);
+  V::store(hess + 5 * off + n, hzz);
+}
+
+template<typename V, typename T>
+inline void evaluate_v_simd(const SplineStencil<T>& st, T* vals, size_t num_splines)
+{
+  const size_t num_full = num_splines / V::width * V::width;
+  for (size_t n = 0; n < num_full; n += V::width)
+    v_chunk<V>(st, n, vals);
+  for (size_t n = num_full; n < num_splines; n++)
+    v_chunk<ScalarSIMD<T>>(st, n, vals);
+}
+
+template<typename V, typename T>
+inline void evaluate_vg_simd(const SplineStencil<T>& st, T* vals, T* grads, size_t num_splines)
+{
+  const size_t num_full = num_splines / V::width * V::width;
+  for (size_t n = 0; n < num_full; n += V::width)
+    vg_chunk<V>(st, n, vals, grads);
+  for (size_t n = num_full; n < num_splines; n++)
+    vg_chunk<ScalarSIMD<T>>(st, n, vals, grads);
+}
+
+template<typename V, typename T>
+inline void evaluate_l_simd(const SplineStencil<T>& st, T* lapl, size_t num_splines)
+{
+  const size_t num_full = num_splines / V::width * V::width;
+  for (size_t n = 0; n < num_full; n += V::width)
+    l_chunk<V>(st, n, lapl);
+  for (size_t n = num_full; n < num_splines; n++)
+    l_chunk<ScalarSIMD<T>>(st, n, lapl);
+}
+
+template<typename V, typename T>
+inline void evaluate_vgl_simd(const SplineStencil<T>& st, T* vals, T* grads, T* lapl, size_t num_splines)
+{
+  const size_t num_full = num_splines / V::width * V::width;
+  for (size_t n = 0; n < num_full; n += V::width)
+    vgl_chunk<V>(st, n, vals, grads, lapl);
+  for (size_t n = num_full; n < num_splines; n++)
+    vgl_chunk<ScalarSIMD<T>>(st, n, vals, grads, lapl);
+}
+
+template<typename V, typename T>
+inline void evaluate_vgh_simd(const SplineStencil<T>& st, T* vals, T* grads, T* hess, size_t num_splines)
+{
+  const size_t num_full = num_splines / V::width * V::width;
+  for (size_t n = 0; n < num_full; n += V::width)
+    vgh_chunk<V>(st, n, vals, grads, hess);
+  for (size_t n = num_full; n < num_splines; n++)
+    vgh_chunk<ScalarSIMD<T>>(st, n, vals, grads, hess);
+}
+} // namespace
+#endif
+
+} // namespace spline2
+} // namespace qmcplusplus
+#endif
@@ -0,0 +1,290 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file PagedMultiBsplines.hpp
+ *
+ * Out-of-core multi-bsplines: the coefficient bricks of a file written by
+ * writeMultiBsplines are read on demand into a bounded LRU cache shared by all
+ * the threads, so that the coefficients may exceed the memory of a node.
+ * The cache is split in shards by brick, each with its own lock, so that the
+ * threads evaluating the SPOs rarely wait on one another.
+ */
+#ifndef QMCPLUSPLUS_PAGED_MULTIBSPLINES_HPP
+#define QMCPLUSPLUS_PAGED_MULTIBSPLINES_HPP
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <Numerics/Spline2/MultiBsplineFile.hpp>
+#include <Numerics/Spline2/MultiBsplineEvalHelper.hpp>
+#include <Utilities/NewTimer.h>
+#include <Utilities/SIMD/allocator.hpp>
+
+namespace qmcplusplus
+{
+namespace spline2
+{
+/** the 4x4x4 coefficient rows of one evaluation, gathered by PagedMultiBsplines::gather
+ *
+ * spline describes the whole grid in the x-major layout but only the rows of the last
+ * gathered stencil are valid, so it can be passed to any evaluation routine at that position.
+ */
+template<typename SplineType>
+struct MultiBsplineWindow
+{
+  using coef_type = typename bspline_type<SplineType>::value_type;
+  SplineType spline;
+  aligned_vector<coef_type> rows;
+};
+
+/** multi-bsplines of a coefficient file with the bricks read on demand
+ *
+ * The file must be written in the brick layout. A brick is read with pread on its first
+ * use and stays in the cache until it is the least recently used one of its shard and the
+ * shard is full. Consecutive bricks fall in different shards, see getShard.
+ * The bricks in use by a gather are kept alive by shared pointers, evicting them is safe.
+ */
+template<typename SplineType>
+class PagedMultiBsplines
+{
+public:
+  using coef_type = typename bspline_type<SplineType>::value_type;
+
+  PagedMultiBsplines() : fd(-1), capacity(0), num_shards(0)
+  {
+    // the misses are nested in the lookups, the hits are the difference of their calls
+    lookup_timer = TimerManager.createTimer("Spline cache lookup", timer_level_fine);
+    miss_timer   = TimerManager.createTimer("Spline cache miss", timer_level_fine);
+  }
+  PagedMultiBsplines(const PagedMultiBsplines&) = delete;
+  PagedMultiBsplines& operator=(const PagedMultiBsplines&) = delete;
+  ~PagedMultiBsplines() { close(); }
+
+  /// header of the file
+  MultiBsplineFileHeader header;
+
+  /** open a coefficient file
+   * @param cache_bytes bound of the memory of the cached bricks, at least 8 bricks are cached
+   * @return false if the file does not exist
+   *
+   * Throws if the file is not a valid coefficient file in the brick layout.
+   */
+  bool open(const std::string& fname, size_t cache_bytes)
+  {
+    close();
+    fd = ::open(fname.c_str(), O_RDONLY);
+    if (fd < 0)
+      return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(header) ||
+        ::pread(fd, &header, sizeof(header), 0) != sizeof(header) || !header.isValid(st.st_size))
+    {
+      close();
+      throw std::runtime_error("Invalid spline coefficient file " + fname);
+    }
+    if (header.brick_shift == 0)
+    {
+      close();
+      throw std::runtime_error("Paging the spline coefficient file " + fname + " requires the brick layout");
+    }
+
+    std::vector<int8_t> parities(header.num_blocks, 0);
+    if (header.inversion &&
+        ::pread(fd, parities.data(), parities.size(), sizeof(header)) != static_cast<ssize_t>(parities.size()))
+    {
+      close();
+      throw std::runtime_error("Invalid spline coefficient file " + fname);
+    }
+    for (int ib = 0; ib < header.num_blocks; ib++)
+      splines.emplace_back(createMultiBsplineFromHeader<SplineType>(header, parities[ib]));
+
+    // at least the 8 bricks of a stencil per shard
+    capacity   = std::max(cache_bytes / getBrickBytes(), size_t(min_shard_capacity));
+    num_shards = std::min(capacity / min_shard_capacity, size_t(max_shards));
+    for (size_t i = 0; i < num_shards; i++)
+    {
+      shards.emplace_back(new Shard);
+      shards.back()->capacity = capacity / num_shards + (i < capacity % num_shards);
+    }
+    return true;
+  }
+
+  /// close the file and empty the cache
+  void close()
+  {
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+    splines.clear();
+    shards.clear();
+    num_shards = 0;
+  }
+
+  /// multi-bspline of the ib-th payload without coefficients, to locate positions on its grid
+  SplineType* getMultiBspline(int ib) const { return splines[ib].get(); }
+
+  /// bytes of a brick
+  size_t getBrickBytes() const { return header.z_brick_stride * sizeof(coef_type); }
+  /// maximum number of cached bricks
+  size_t getCapacity() const { return capacity; }
+  /// number of shards of the cache
+  size_t getNumShards() const { return num_shards; }
+  /// number of bricks found in the cache
+  size_t getHits() const { return sumShards(&Shard::hits); }
+  /// number of bricks read from the file
+  size_t getMisses() const { return sumShards(&Shard::misses); }
+
+  /** gather the coefficient rows of the ib-th multi-bspline needed by an evaluation at (x,y,z)
+   *
+   * The position is located as in computeLocationAndFractional, the rows are copied to
+   * window.rows and window.spline is set up so that the rows are found at their offsets in
+   * the x-major layout of the whole grid.
+   */
+  template<typename T>
+  void gather(int ib, T x, T y, T z, MultiBsplineWindow<SplineType>& window)
+  {
+    const SplineType* spline = splines[ib].get();
+    int ix, iy, iz;
+    T a[4], b[4], c[4];
+    computeLocationAndFractional(spline, x, y, z, ix, iy, iz, a, b, c);
+
+    const intptr_t row_size = spline->z_stride;
+    window.rows.resize(64 * row_size);
+    window.spline             = *spline;
+    window.spline.brick_shift = 0;
+    window.spline.z_stride = window.spline.z_brick_stride = row_size;
+    window.spline.y_stride = window.spline.y_brick_stride = 4 * row_size;
+    window.spline.x_stride = window.spline.x_brick_stride = 16 * row_size;
+    window.spline.coefs_size = window.rows.size();
+    // the rows of the stencil at (ix,iy,iz) start at coefs + getRowOffset(ix+i,iy+j,iz+k)
+    const intptr_t origin = getRowOffset(&window.spline, ix, iy, iz) * sizeof(coef_type);
+    window.spline.coefs   = reinterpret_cast<coef_type*>(reinterpret_cast<intptr_t>(window.rows.data()) - origin);
+
+    // the distinct bricks of the stencil, at most 8 with bricks of 4 points or more
+    const int shift = spline->brick_shift;
+    const int mask  = (1 << shift) - 1;
+    intptr_t brick_offsets[64];
+    std::shared_ptr<Brick> bricks[64];
+    int num_bricks = 0;
+    for (int i = 0; i < 4; i++)
+      for (int j = 0; j < 4; j++)
+        for (int k = 0; k < 4; k++)
+        {
+          const intptr_t brick = ((ix + i) >> shift) * spline->x_brick_stride +
+              ((iy + j) >> shift) * spline->y_brick_stride + ((iz + k) >> shift) * spline->z_brick_stride;
+          const int ibrick = std::find(brick_offsets, brick_offsets + num_bricks, brick) - brick_offsets;
+          if (ibrick == num_bricks)
+          {
+            brick_offsets[num_bricks] = brick;
+            bricks[num_bricks++]      = getBrick(ib, brick);
+          }
+          const intptr_t row = ((ix + i) & mask) * spline->x_stride + ((iy + j) & mask) * spline->y_stride +
+              ((iz + k) & mask) * spline->z_stride;
+          std::copy_n(bricks[ibrick]->data() + row, row_size, window.rows.data() + ((i * 4 + j) * 4 + k) * row_size);
+        }
+  }
+
+private:
+  using Brick = aligned_vector<coef_type>;
+  /// cached bricks and their position in lru
+  struct CacheEntry
+  {
+    std::shared_ptr<Brick> brick;
+    std::list<size_t>::iterator position;
+  };
+
+  /// bricks of the keys equal modulo num_shards
+  struct Shard
+  {
+    /// guards all the members
+    mutable std::mutex mutex;
+    /// keys of the cached bricks, the most recently used first
+    std::list<size_t> lru;
+    std::unordered_map<size_t, CacheEntry> cache;
+    size_t capacity = 0;
+    size_t hits     = 0;
+    size_t misses   = 0;
+  };
+  /// shards of caches of min_shard_capacity bricks or more
+  static constexpr size_t min_shard_capacity = 8;
+  static constexpr size_t max_shards         = 64;
+
+  int fd;
+  size_t capacity;
+  size_t num_shards;
+  NewTimer* lookup_timer;
+  NewTimer* miss_timer;
+  std::vector<std::unique_ptr<SplineType>> splines;
+  /// allocated one by one, so that the locks of two shards do not share a cache line
+  std::vector<std::unique_ptr<Shard>> shards;
+
+  /// shard of a brick, the neighbouring bricks of a stencil are in distinct shards
+  Shard& getShard(size_t key) { return *shards[key % num_shards]; }
+
+  size_t sumShards(size_t Shard::*count) const
+  {
+    size_t sum = 0;
+    for (size_t i = 0; i < num_shards; i++)
+    {
+      std::lock_guard<std::mutex> lock(shards[i]->mutex);
+      sum += shards[i].get()->*count;
+    }
+    return sum;
+  }
+
+  /// brick of the ib-th payload starting at the coefficient offset brick, read from the file if not cached
+  std::shared_ptr<Brick> getBrick(int ib, intptr_t brick)
+  {
+    ScopedTimer local_timer(lookup_timer);
+    const size_t brick_size = header.z_brick_stride;
+    const size_t key        = ib * (header.coefs_size / brick_size) + brick / brick_size;
+    Shard& shard            = getShard(key);
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto it = shard.cache.find(key);
+      if (it != shard.cache.end())
+      {
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second.position);
+        shard.hits++;
+        return it->second.brick;
+      }
+    }
+
+    // read without holding the lock, another thread may read the same brick meanwhile
+    std::shared_ptr<Brick> loaded(new Brick(brick_size));
+    {
+      ScopedTimer read_timer(miss_timer);
+      const off_t offset = header.payload_offset + ib * header.block_bytes + brick * sizeof(coef_type);
+      if (::pread(fd, loaded->data(), getBrickBytes(), offset) != static_cast<ssize_t>(getBrickBytes()))
+        throw std::runtime_error("Failed in reading a brick of the spline coefficient file");
+    }
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.misses++;
+    auto it = shard.cache.find(key);
+    if (it != shard.cache.end())
+      return it->second.brick;
+    while (shard.cache.size() >= shard.capacity)
+    {
+      shard.cache.erase(shard.lru.back());
+      shard.lru.pop_back();
+    }
+    shard.lru.push_front(key);
+    shard.cache[key] = CacheEntry{loaded, shard.lru.begin()};
+    return loaded;
+  }
+};
+
+} // namespace spline2
+} // namespace qmcplusplus
+#endif
@@ -0,0 +1,213 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file bspline_half.hpp
+ *
+ * 16-bit storage types of the spline coefficients and the multi-bspline
+ * structure holding them. Coefficients are widened to float when they are
+ * loaded in the evaluation kernels, all the accumulations are done in the
+ * precision of the output.
+ */
+#ifndef QMCPLUSPLUS_BSPLINE_SPLINE2_HALF_H
+#define QMCPLUSPLUS_BSPLINE_SPLINE2_HALF_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <Numerics/Spline2/bspline_traits.hpp>
+
+namespace qmcplusplus
+{
+namespace spline2
+{
+/// storage type of the spline coefficients
+enum class SplineStorage
+{
+  FULL, // OHMMS_PRECISION
+  FP16, // IEEE 754 binary16
+  BF16  // bfloat16
+};
+
+/// name of the storage type
+inline std::string getSplineStorageName(SplineStorage storage)
+{
+  if (storage == SplineStorage::FP16)
+    return "fp16";
+  else if (storage == SplineStorage::BF16)
+    return "bf16";
+  return "full";
+}
+
+/// unit roundoff of the 16-bit storage types, 0 for full precision
+inline double getSplineStorageEpsilon(SplineStorage storage)
+{
+  if (storage == SplineStorage::FP16)
+    return 9.765625e-4; // 2^-10
+  else if (storage == SplineStorage::BF16)
+    return 7.8125e-3; // 2^-7
+  return 0.0;
+}
+
+/// bytes per coefficient, \p full_bytes for full precision
+inline size_t getSplineStorageBytes(SplineStorage storage, size_t full_bytes)
+{
+  return storage == SplineStorage::FULL ? full_bytes : sizeof(uint16_t);
+}
+
+/** parse the name of the storage type
+ * @return false if the name is not recognized
+ */
+inline bool parseSplineStorage(const std::string& name, SplineStorage& storage)
+{
+  if (name == "full")
+    storage = SplineStorage::FULL;
+  else if (name == "fp16")
+    storage = SplineStorage::FP16;
+  else if (name == "bf16")
+    storage = SplineStorage::BF16;
+  else
+    return false;
+  return true;
+}
+
+inline uint32_t float_as_bits(float f)
+{
+  uint32_t u;
+  std::memcpy(&u, &f, sizeof(float));
+  return u;
+}
+
+inline float bits_as_float(uint32_t u)
+{
+  float f;
+  std::memcpy(&f, &u, sizeof(float));
+  return f;
+}
+
+/** IEEE 754 half precision
+ *
+ * Conversions are done in software with round to nearest even. The widening
+ * is branch free so that the loads in the evaluation kernels are vectorized.
+ */
+struct fp16
+{
+  uint16_t bits;
+
+  fp16() = default;
+
+  explicit fp16(float f)
+  {
+    constexpr uint32_t f32infty     = 255u << 23;
+    constexpr uint32_t f16max       = (127u + 16u) << 23;
+    constexpr uint32_t denorm_magic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+    uint32_t u                      = float_as_bits(f);
+    const uint32_t sign             = u & 0x80000000u;
+    u ^= sign;
+    uint32_t o;
+    if (u >= f16max) // overflow to inf, keep NaN
+      o = (u > f32infty) ? 0x7e00u : 0x7c00u;
+    else if (u < (113u << 23)) // subnormal or zero
+      o = float_as_bits(bits_as_float(u) + bits_as_float(denorm_magic)) - denorm_magic;
+    else
+    {
+      const uint32_t mant_odd = (u >> 13) & 1u;
+      u += (uint32_t(15 - 127) << 23) + 0xfffu + mant_odd;
+      o = u >> 13;
+    }
+    bits = static_cast<uint16_t>(o | (sign >> 16));
+  }
+
+  operator float() const
+  {
+    constexpr uint32_t shifted_exp = 0x7c00u << 13;
+    const uint32_t o               = ((bits & 0x7fffu) << 13) + ((127u - 15u) << 23);
+    const uint32_t exp             = (bits & 0x7c00u) << 13;
+    const uint32_t inf_nan         = o + ((128u - 16u) << 23);
+    const uint32_t subnormal       = float_as_bits(bits_as_float(o + (1u << 23)) - bits_as_float(113u << 23));
+    const uint32_t r               = (exp == shifted_exp) ? inf_nan : ((exp == 0) ? subnormal : o);
+    return bits_as_float(r | (uint32_t(bits & 0x8000u) << 16));
+  }
+};
+
+/** bfloat16, the upper half of a float
+ *
+ * Same exponent range as float with an 8-bit significand.
+ */
+struct bf16
+{
+  uint16_t bits;
+
+  bf16() = default;
+
+  explicit bf16(float f)
+  {
+    const uint32_t u = float_as_bits(f);
+    if ((u & 0x7fffffffu) > 0x7f800000u) // quiet NaN
+      bits = static_cast<uint16_t>((u >> 16) | 0x40u);
+    else // round to nearest even
+      bits = static_cast<uint16_t>((u + 0x7fffu + ((u >> 16) & 1u)) >> 16);
+  }
+
+  operator float() const { return bits_as_float(uint32_t(bits) << 16); }
+};
+
+} // namespace spline2
+
+/** multi_UBspline_3d with 16-bit coefficients
+ * @tparam ST storage type, spline2::fp16 or spline2::bf16
+ *
+ * Same members as multi_UBspline_3d_s so that the allocator and the
+ * evaluation kernels handle it as any other multi-bspline.
+ */
+template<typename ST>
+struct multi_UBspline_3d_half
+{
+  spline_code spcode;
+  type_code tcode;
+  ST* restrict coefs;
+  intptr_t x_stride, y_stride, z_stride;
+  int brick_shift;
+  intptr_t x_brick_stride, y_brick_stride, z_brick_stride;
+  int inversion;
+  Ugrid x_grid, y_grid, z_grid;
+  BCtype_s xBC, yBC, zBC;
+  int num_splines;
+  size_t coefs_size;
+};
+
+template<>
+struct bspline_traits<spline2::fp16, 3>
+{
+  typedef multi_UBspline_3d_half<spline2::fp16> SplineType;
+  typedef UBspline_3d_s SingleSplineType;
+  typedef BCtype_s BCType;
+  typedef spline2::fp16 real_type;
+  typedef spline2::fp16 value_type;
+};
+
+template<>
+struct bspline_traits<spline2::bf16, 3>
+{
+  typedef multi_UBspline_3d_half<spline2::bf16> SplineType;
+  typedef UBspline_3d_s SingleSplineType;
+  typedef BCtype_s BCType;
+  typedef spline2::bf16 real_type;
+  typedef spline2::bf16 value_type;
+};
+
+template<typename ST>
+struct bspline_type<multi_UBspline_3d_half<ST>>
+{
+  typedef ST value_type;
+};
+
+} // namespace qmcplusplus
+#endif
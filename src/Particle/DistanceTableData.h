@@ -27,6 +27,7 @@
 #include "Numerics/OhmmsPETE/OhmmsVector.h"
 #include "Numerics/OhmmsPETE/OhmmsMatrix.h"
 #include "Utilities/SIMD/allocator.hpp"
+#include "Utilities/SIMD/HugePageAllocator.hpp"
 #include <Numerics/Containers.h>
 #include <limits>
 #include <bitset>
@@ -80,6 +81,7 @@ struct DistanceTableData
   using IndexVectorType = aligned_vector<IndexType>;
   using ripair          = std::pair<RealType, IndexType>;
   using RowContainer    = VectorSoAContainer<RealType, DIM>;
+  using TableAllocator  = HugePageAllocator<RealType, QMC_CLINE, HugePageCategory::DISTANCE_TABLE>;
 
   /// type of cell
   int CellType;
@@ -91,13 +93,13 @@ struct DistanceTableData
   /**defgroup SoA data */
   /*@{*/
   /** Distances[i][j] , [Nsources][Ntargets] */
-  Matrix<RealType, aligned_allocator<RealType>> Distances;
+  Matrix<RealType, TableAllocator> Distances;
 
   /** Displacements[Nsources]x[3][Ntargets] */
   std::vector<RowContainer> Displacements;
 
   /// actual memory for Displacements
-  aligned_vector<RealType> memoryPool;
+  std::vector<RealType, TableAllocator> memoryPool;
 
   /** temp_r */
   aligned_vector<RealType> Temp_r;
@@ -0,0 +1,290 @@
+//////////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source License.
+// See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+//////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef QMCPLUSPLUS_BLOCKED_INVERSE_H
+#define QMCPLUSPLUS_BLOCKED_INVERSE_H
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include "config.h"
+#include "Utilities/Constants.h"
+
+/**@file BlockedInverse.h
+ * @brief LU factorization and inversion of small row-major matrices
+ *
+ * Replacements of LAPACK getrf and getri for the matrix sizes of the determinants, which
+ * stay in the caches. Every inner loop runs over a contiguous row and vectorizes.
+ */
+
+namespace qmcplusplus
+{
+/// add log|x| to logdet and the sign of x, flipped by a row swap, to the phase 0 or pi
+template<typename T>
+inline void accumulateLogDet(T x, bool swapped, T& logdet, T& phase)
+{
+  logdet += std::log(std::abs(x));
+  if ((x < 0) != swapped)
+    phase = phase > 0 ? T(0) : T(M_PI);
+}
+
+/// add log|x| to logdet and the argument of x, plus pi for a row swap, to the phase in [0,2pi)
+template<typename T>
+inline void accumulateLogDet(const std::complex<T>& x, bool swapped, T& logdet, T& phase)
+{
+  logdet += 0.5 * std::log(x.real() * x.real() + x.imag() * x.imag());
+  phase += std::arg(x) + (swapped ? T(M_PI) : T(0));
+  constexpr T one_over_2pi = T(1) / TWOPI;
+  phase -= std::floor(phase * one_over_2pi) * TWOPI;
+}
+
+/** c -= l * u for an m x w block c, an m x kb block l and a kb x w block u, all row-major
+ *
+ * Four rows of u are applied in one pass over a row of c.
+ */
+template<typename T>
+inline void subtract_product(int m,
+                             int w,
+                             int kb,
+                             const T* restrict l,
+                             int ldl,
+                             const T* restrict u,
+                             int ldu,
+                             T* restrict c,
+                             int ldc)
+{
+  for (int i = 0; i < m; i++)
+  {
+    const T* restrict li = l + i * ldl;
+    T* restrict ci       = c + i * ldc;
+    int k                = 0;
+    for (; k + 4 <= kb; k += 4)
+    {
+      const T* restrict u0 = u + k * ldu;
+      const T* restrict u1 = u0 + ldu;
+      const T* restrict u2 = u1 + ldu;
+      const T* restrict u3 = u2 + ldu;
+      const T l0 = li[k], l1 = li[k + 1], l2 = li[k + 2], l3 = li[k + 3];
+      for (int j = 0; j < w; j++)
+        ci[j] -= l0 * u0[j] + l1 * u1[j] + l2 * u2[j] + l3 * u3[j];
+    }
+    for (; k < kb; k++)
+    {
+      const T* restrict uk = u + k * ldu;
+      const T lk           = li[k];
+      for (int j = 0; j < w; j++)
+        ci[j] -= lk * uk[j];
+    }
+  }
+}
+
+/** LU factorization with partial pivoting of a row-major matrix, in place
+ * @param n size of the matrix
+ * @param a the matrix, with rows of stride lda, replaced by L below the diagonal and U
+ * @param piv row swapped with row k at the step k
+ * @param logdet log|det(a)|
+ * @param phase phase of det(a)
+ * @return false if a pivot is exactly zero, the factorization is then complete as with getrf
+ *
+ * Right-looking, in panels of nb columns. The determinant is accumulated with the pivots.
+ */
+template<typename T, typename TREAL>
+inline bool blocked_getrf(int n, T* restrict a, int lda, int* restrict piv, TREAL& logdet, TREAL& phase)
+{
+  constexpr int nb = 16;
+  bool regular     = true;
+  logdet           = TREAL(0);
+  phase            = TREAL(0);
+  for (int k0 = 0; k0 < n; k0 += nb)
+  {
+    const int k1 = std::min(k0 + nb, n);
+    // factorize the panel, rows k0 to n and columns k0 to k1
+    for (int k = k0; k < k1; k++)
+    {
+      int p       = k;
+      TREAL p_abs = std::abs(a[k * lda + k]);
+      for (int i = k + 1; i < n; i++)
+        if (std::abs(a[i * lda + k]) > p_abs)
+        {
+          p     = i;
+          p_abs = std::abs(a[i * lda + k]);
+        }
+      piv[k] = p;
+      if (p != k)
+        std::swap_ranges(a + k * lda, a + k * lda + n, a + p * lda);
+      T* restrict ak = a + k * lda;
+      accumulateLogDet(ak[k], p != k, logdet, phase);
+      if (p_abs == TREAL(0))
+      {
+        regular = false;
+        continue;
+      }
+      const T inv_pivot = T(1) / ak[k];
+      for (int i = k + 1; i < n; i++)
+      {
+        T* restrict ai = a + i * lda;
+        const T l      = ai[k] * inv_pivot;
+        ai[k]          = l;
+        for (int j = k + 1; j < k1; j++)
+          ai[j] -= l * ak[j];
+      }
+    }
+    // rows of U right of the panel, U12 = L11^-1 A12
+    for (int k = k0; k < k1; k++)
+      for (int i = k + 1; i < k1; i++)
+      {
+        T* restrict ai       = a + i * lda;
+        const T* restrict ak = a + k * lda;
+        const T l            = ai[k];
+        for (int j = k1; j < n; j++)
+          ai[j] -= l * ak[j];
+      }
+    // trailing matrix, A22 -= L21 * U12
+    subtract_product(n - k1, n - k1, k1 - k0, a + k1 * lda + k0, lda, a + k0 * lda + k1, lda, a + k1 * lda + k1, lda);
+  }
+  return regular;
+}
+
+/** y -= sum_k x[k] b(k,:) over the rows k0 <= k < k1 of a triangular matrix b
+ * @param upper if true, the row k of b is used from the column k to n, otherwise from 0 to k+1
+ *
+ * The zeros of b across the diagonal must be stored. Four rows of b are applied in one pass over y.
+ */
+template<typename T>
+inline void subtract_triangular_rows(bool upper,
+                                     int n,
+                                     int k0,
+                                     int k1,
+                                     const T* restrict x,
+                                     const T* restrict b,
+                                     int ldb,
+                                     T* restrict y)
+{
+  int k = k0;
+  for (; k + 4 <= k1; k += 4)
+  {
+    const T* restrict b0 = b + k * ldb;
+    const T* restrict b1 = b0 + ldb;
+    const T* restrict b2 = b1 + ldb;
+    const T* restrict b3 = b2 + ldb;
+    const T x0 = x[k], x1 = x[k + 1], x2 = x[k + 2], x3 = x[k + 3];
+    const int j0 = upper ? k : 0;
+    const int j1 = upper ? n : k + 4;
+    for (int j = j0; j < j1; j++)
+      y[j] -= x0 * b0[j] + x1 * b1[j] + x2 * b2[j] + x3 * b3[j];
+  }
+  for (; k < k1; k++)
+  {
+    const T* restrict bk = b + k * ldb;
+    const T xk           = x[k];
+    const int j0         = upper ? k : 0;
+    const int j1         = upper ? n : k + 1;
+    for (int j = j0; j < j1; j++)
+      y[j] -= xk * bk[j];
+  }
+}
+
+/** inverse of a row-major matrix from its blocked_getrf factors, in place
+ * @param n size of the matrix
+ * @param a the factors, with rows of stride lda, replaced by the inverse
+ * @param piv row swaps of blocked_getrf
+ * @param work scratch space of n*(n+2) elements
+ * @param transpose if true, a is replaced by the transpose of the inverse
+ *
+ * inv(A) = inv(U) inv(L) P: U is inverted in place and L in work, row by row, then each row
+ * of inv(U) inv(L) replaces the row of inv(U) it depends on, and the row swaps become column
+ * swaps. Every step combines contiguous rows of triangular matrices.
+ * With transpose, the row i of the product is written to the column i instead, over the
+ * rows of inv(U) already used and its zeros below the diagonal, and the swaps are row swaps.
+ */
+template<typename T>
+inline void blocked_getri(int n,
+                          T* restrict a,
+                          int lda,
+                          const int* restrict piv,
+                          T* restrict work,
+                          bool transpose = false)
+{
+  T* restrict lmat = work;
+  T* restrict row  = work + n * n;
+  T* restrict prod = row + n;
+
+  // L moved out of the way with its unit diagonal and zeros, U left alone with zeros
+  for (int k = 0; k < n; k++)
+  {
+    T* restrict ak = a + k * lda;
+    T* restrict lk = lmat + k * n;
+    for (int j = 0; j < k; j++)
+    {
+      lk[j] = ak[j];
+      ak[j] = T(0);
+    }
+    lk[k] = T(1);
+    for (int j = k + 1; j < n; j++)
+      lk[j] = T(0);
+  }
+
+  // inv(U) from the bottom, the row i depends on the rows below
+  for (int i = n - 1; i >= 0; i--)
+  {
+    T* restrict ai    = a + i * lda;
+    const T inv_pivot = T(1) / ai[i];
+    for (int k = i + 1; k < n; k++)
+    {
+      row[k] = ai[k];
+      ai[k]  = T(0);
+    }
+    ai[i] = T(1);
+    subtract_triangular_rows(true, n, i + 1, n, row, a, lda, ai);
+    for (int j = i; j < n; j++)
+      ai[j] *= inv_pivot;
+  }
+
+  // inv(L) from the top, the row i depends on the rows above
+  for (int i = 1; i < n; i++)
+  {
+    T* restrict li = lmat + i * n;
+    for (int k = 0; k < i; k++)
+    {
+      row[k] = li[k];
+      li[k]  = T(0);
+    }
+    subtract_triangular_rows(false, n, 0, i, row, lmat, n, li);
+  }
+
+  // inv(U) inv(L), the row i of inv(U) is only used for the row i of the product
+  for (int i = 0; i < n; i++)
+  {
+    T* restrict ai = a + i * lda;
+    for (int k = i; k < n; k++)
+      row[k] = -ai[k];
+    T* restrict pi = transpose ? prod : ai;
+    for (int j = 0; j < n; j++)
+      pi[j] = T(0);
+    subtract_triangular_rows(false, n, i, n, row, lmat, n, pi);
+    if (transpose)
+    {
+      for (int j = 0; j < n; j++)
+        a[j * lda + i] = pi[j];
+      continue;
+    }
+    for (int k = n - 1; k >= 0; k--)
+      if (piv[k] != k)
+        std::swap(ai[k], ai[piv[k]]);
+  }
+  if (transpose)
+    for (int k = n - 1; k >= 0; k--)
+      if (piv[k] != k)
+        std::swap_ranges(a + k * lda, a + k * lda + n, a + piv[k] * lda);
+}
+} // namespace qmcplusplus
+
+#endif // QMCPLUSPLUS_BLOCKED_INVERSE_H
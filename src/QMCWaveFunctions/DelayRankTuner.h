@@ -0,0 +1,179 @@
+//////////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source License.
+// See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+//////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef QMCPLUSPLUS_DELAY_RANK_TUNER_H
+#define QMCPLUSPLUS_DELAY_RANK_TUNER_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace qmcplusplus
+{
+/** chooses the delay rank of a delayed update engine at run time
+ *
+ * The candidate ranks, powers of two up to the maximum, are tried in turn. A trial times
+ * the moves of consecutive rows, from a row request of the engine to the next one, so that
+ * the cost includes the rest of the sweep slowed down by a large U and V as well as the
+ * flushes. Each candidate is timed over several flushes. After a first round of all the
+ * candidates, the two best ones are timed again and the least time per move of all the
+ * rounds is kept. The trials start over when the acceptance ratio, accepted moves per
+ * requested row, drifts away from the one of the trials.
+ * The rank only changes when the delayed updates have been applied.
+ */
+class DelayRankTuner
+{
+public:
+  /// smallest candidate rank
+  static constexpr int min_rank = 4;
+  /// minimum number of accepted moves timed for each candidate
+  static constexpr int min_trial_moves = 32;
+  /// minimum number of flushes timed for each candidate
+  static constexpr int min_trial_flushes = 3;
+  /// rounds of trials, the first of all the candidates and the next ones of the best two
+  static constexpr int trial_rounds = 3;
+  /// number of requested rows between two checks of the acceptance ratio
+  static constexpr int drift_window = 2048;
+  /// relative change of the acceptance ratio starting new trials
+  static constexpr double drift_tolerance = 0.25;
+
+  DelayRankTuner() : rank(1), tuning(false), trial(0), round(0), trial_rows(0), trial_accepts(0), tuned_acceptance(0)
+  {
+    resetCounts();
+  }
+
+  /** start the trials
+   * @param max_rank largest candidate rank
+   */
+  void start(int max_rank)
+  {
+    candidates.clear();
+    for (int c = std::min(int(min_rank), max_rank); c < max_rank; c *= 2)
+      candidates.push_back(c);
+    candidates.push_back(max_rank);
+    costs.assign(candidates.size(), std::numeric_limits<double>::max());
+    order.resize(candidates.size());
+    for (size_t c = 0; c < order.size(); c++)
+      order[c] = c;
+    trial         = 0;
+    round         = 0;
+    rank          = candidates[0];
+    tuning        = true;
+    trial_rows    = 0;
+    trial_accepts = 0;
+    resetCounts();
+  }
+
+  /// current delay rank
+  inline int getRank() const { return rank; }
+  /// true during the trials, when the engine reports the time of the rows
+  inline bool isTuning() const { return tuning; }
+  /// acceptance ratio of the last trials
+  inline double getTunedAcceptance() const { return tuned_acceptance; }
+
+  /** a row of the inverse matrix was requested
+   * @param row the row
+   * @param now time in seconds, only read during the trials
+   *
+   * The time since the request of the previous row is the cost of a move, the gaps
+   * between sweeps or to other rows are left out. A row requested again is ignored.
+   */
+  inline void countRow(int row, double now)
+  {
+    if (row == last_row)
+      return;
+    rows++;
+    if (tuning && row == last_row + 1)
+    {
+      elapsed += now - last_time;
+      timed_moves++;
+    }
+    last_row  = row;
+    last_time = now;
+  }
+  /// a move was accepted
+  inline void countAccept() { accepts++; }
+
+  /// the delayed updates were applied, the rank may change
+  void flushed()
+  {
+    if (tuning)
+    {
+      if (++flushes < min_trial_flushes || accepts < min_trial_moves || timed_moves == 0)
+        return;
+      costs[order[trial]] = std::min(costs[order[trial]], elapsed / timed_moves);
+      trial_rows += rows;
+      trial_accepts += accepts;
+      resetCounts();
+      if (++trial == order.size())
+      {
+        trial = 0;
+        if (++round == trial_rounds)
+        {
+          rank             = candidates[std::min_element(costs.begin(), costs.end()) - costs.begin()];
+          tuning           = false;
+          tuned_acceptance = trial_accepts / std::max(trial_rows, 1.0);
+          return;
+        }
+        if (round == 1)
+        {
+          // the next rounds retime the best two
+          std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return costs[a] < costs[b]; });
+          order.resize(std::min(order.size(), size_t(2)));
+        }
+      }
+      rank = candidates[order[trial]];
+    }
+    else if (rows >= drift_window)
+    {
+      const double acceptance = accepts / rows;
+      if (std::abs(acceptance - tuned_acceptance) > drift_tolerance * tuned_acceptance)
+        start(candidates.back());
+      else
+        resetCounts();
+    }
+  }
+
+private:
+  /// current delay rank
+  int rank;
+  bool tuning;
+  /// index in order of the candidate on trial
+  size_t trial;
+  /// round of the trials
+  int round;
+  std::vector<int> candidates;
+  /// least time per move of the candidates over the rounds
+  std::vector<double> costs;
+  /// candidates of the current round
+  std::vector<size_t> order;
+  /// counts and time since the start of the trial or of the drift window
+  double rows, accepts, elapsed, timed_moves;
+  int flushes;
+  /// last requested row and the time of its request, the timing starts anew with each trial
+  int last_row;
+  double last_time;
+  /// counts of all the trials
+  double trial_rows, trial_accepts;
+  double tuned_acceptance;
+
+  inline void resetCounts()
+  {
+    rows = accepts = elapsed = timed_moves = 0;
+    flushes                                = 0;
+    last_row                               = -2;
+    last_time                              = 0;
+  }
+};
+} // namespace qmcplusplus
+
+#endif // QMCPLUSPLUS_DELAY_RANK_TUNER_H
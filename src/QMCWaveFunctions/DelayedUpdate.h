@@ -18,12 +18,20 @@
 #include "Numerics/OhmmsBlas.h"
 #include "QMCWaveFunctions/DiracMatrix.h"
 #include "Numerics/BlasThreadingEnv.h"
+#include "QMCWaveFunctions/DelayRankTuner.h"
+#include "Utilities/Clock.h"
 
 namespace qmcplusplus
 {
+template<typename DU_TYPE>
+class DelayedUpdateBatched;
+
 /** implements delayed update on CPU using BLAS
  * @tparam T base precision for most computation
  * @tparam T_FP high precision for matrix inversion, T_FP >= T
+ *
+ * With an adaptive delay, the storage holds up to max_adaptive_delay delays and
+ * the delay rank is chosen at run time by a DelayRankTuner.
  */
 template<typename T, typename T_FP>
 class DelayedUpdate
@@ -48,17 +56,41 @@ class DelayedUpdate
   int delay_count;
   /// matrix inversion engine
   DiracMatrix<T_FP, T> detEng;
+  /// true if the delay rank is chosen by tuner
+  bool adaptive;
+  DelayRankTuner tuner;
+
+  /// the crowd engine works on U, V and Binv of its walkers directly
+  template<typename DU_TYPE>
+  friend class DelayedUpdateBatched;
 
 public:
+  using value_type = T;
+
+  /// largest delay rank tried by an adaptive delay
+  static constexpr int max_adaptive_delay = 128;
+
   /// default constructor
-  DelayedUpdate() : delay_count(0) {}
+  DelayedUpdate() : delay_count(0), adaptive(false) {}
+
+  /// maximum delay held by the storage, delay <= 0 for an adaptive delay
+  static int getStorageDelay(int norb, int delay) { return delay > 0 ? delay : std::min(norb, int(max_adaptive_delay)); }
+
+  /// number of values of the memory of U, V, Binv and tempMat, see resize with a pool
+  static size_t getPoolSize(int norb, int delay)
+  {
+    delay = getStorageDelay(norb, delay);
+    return 3 * getAlignedSize<T>(delay * norb) + getAlignedSize<T>(delay * delay);
+  }
 
   /** resize the internal storage
    * @param norb number of electrons/orbitals
-   * @param delay, maximum delay 0<delay<=norb
+   * @param delay, maximum delay 0<delay<=norb, delay <= 0 for an adaptive delay
    */
   inline void resize(int norb, int delay)
   {
+    setAdaptive(norb, delay);
+    delay = getStorageDelay(norb, delay);
     V.resize(delay, norb);
     U.resize(delay, norb);
     p.resize(delay);
@@ -68,6 +100,38 @@ public:
     delay_list.resize(delay);
   }
 
+  /** resize the internal storage with U, V, Binv and tempMat carved out of external memory
+   * @param norb number of electrons/orbitals
+   * @param delay, maximum delay 0<delay<=norb, delay <= 0 for an adaptive delay
+   * @param pool memory of getPoolSize(norb, delay) values owned by the caller
+   *
+   * The pending updates are lost, they must be applied with updateInvMat before.
+   */
+  inline void resize(int norb, int delay, T* pool)
+  {
+    setAdaptive(norb, delay);
+    delay = getStorageDelay(norb, delay);
+    const size_t vsize = getAlignedSize<T>(delay * norb);
+    V.free();
+    U.free();
+    tempMat.free();
+    Binv.free();
+    V.attachReference(pool, delay, norb);
+    U.attachReference(pool + vsize, delay, norb);
+    tempMat.attachReference(pool + 2 * vsize, norb, delay);
+    Binv.attachReference(pool + 3 * vsize, delay, delay);
+    p.resize(delay);
+    temp.resize(norb);
+    delay_list.resize(delay);
+    delay_count = 0;
+  }
+
+  /// number of accepted moves not yet applied to Ainv
+  inline int getDelayCount() const { return delay_count; }
+
+  /// number of accepted moves triggering the update of Ainv
+  inline int getDelayRank() const { return adaptive ? tuner.getRank() : Binv.cols(); }
+
   /** compute the inverse of the transpose of matrix A
    * @param logdetT orbital value matrix
    * @param Ainv inverse matrix
@@ -95,6 +159,8 @@ public:
   template<typename VVT>
   inline void getInvRow(const Matrix<T>& Ainv, int rowchanged, VVT& invRow)
   {
+    if (adaptive)
+      tuner.countRow(rowchanged, tuner.isTuning() ? cpu_clock() : 0);
     if (delay_count == 0)
     {
       // Ainv is fresh, directly access Ainv
@@ -125,30 +191,16 @@ public:
   {
     const T cminusone(-1);
     const T czero(0);
-    const int norb     = Ainv.rows();
-    const int lda_Binv = Binv.cols();
+    const int norb = Ainv.rows();
     std::copy_n(Ainv[rowchanged], norb, V[delay_count]);
     std::copy_n(psiV.data(), norb, U[delay_count]);
     delay_list[delay_count] = rowchanged;
-    // the new Binv is [[X Y] [Z x]]
     BLAS::gemv('T', norb, delay_count + 1, cminusone, V.data(), norb, psiV.data(), 1, czero, p.data(), 1);
-    // x
-    T y = -p[delay_count];
-    for (int i = 0; i < delay_count; i++)
-      y += Binv[delay_count][i] * p[i];
-    Binv[delay_count][delay_count] = y = T(1) / y;
-    // Y
-    BLAS::gemv('T', delay_count, delay_count, y, Binv.data(), lda_Binv, p.data(), 1, czero, Binv.data() + delay_count,
-               lda_Binv);
-    // X
-    BLAS::ger(delay_count, delay_count, cminusone, Binv[delay_count], 1, Binv.data() + delay_count, lda_Binv,
-              Binv.data(), lda_Binv);
-    // Z
-    for (int i = 0; i < delay_count; i++)
-      Binv[delay_count][i] *= -y;
-    delay_count++;
+    growBinv();
+    if (adaptive)
+      tuner.countAccept();
     // update Ainv when maximal delay is reached
-    if (delay_count == lda_Binv)
+    if (delay_count == getDelayRank())
       updateInvMat(Ainv);
   }
 
@@ -228,6 +280,42 @@ public:
       }
     }
     delay_count = 0;
+    if (adaptive)
+      tuner.flushed();
+  }
+
+private:
+  /** add the move stored at delay_count to Binv and count it
+   *
+   * p holds -V psiV of the delayed moves and the new one, Binv[delay_count] the product of Binv
+   * and U invRow left by getInvRow. The new Binv is [[X Y] [Z x]].
+   */
+  inline void growBinv()
+  {
+    const int lda_Binv = Binv.cols();
+    // x
+    T y = -p[delay_count];
+    for (int i = 0; i < delay_count; i++)
+      y += Binv[delay_count][i] * p[i];
+    Binv[delay_count][delay_count] = y = T(1) / y;
+    // Y
+    BLAS::gemv('T', delay_count, delay_count, y, Binv.data(), lda_Binv, p.data(), 1, T(0), Binv.data() + delay_count,
+               lda_Binv);
+    // X
+    BLAS::ger(delay_count, delay_count, T(-1), Binv[delay_count], 1, Binv.data() + delay_count, lda_Binv, Binv.data(),
+              lda_Binv);
+    // Z
+    for (int i = 0; i < delay_count; i++)
+      Binv[delay_count][i] *= -y;
+    delay_count++;
+  }
+
+  /// start tuning the delay rank if delay <= 0
+  inline void setAdaptive(int norb, int delay)
+  {
+    adaptive = delay <= 0;
+    if (adaptive)
+      tuner.start(getStorageDelay(norb, delay));
   }
 };
 } // namespace qmcplusplus
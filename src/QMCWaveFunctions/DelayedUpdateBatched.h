@@ -0,0 +1,200 @@
+//////////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source License.
+// See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+//////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef QMCPLUSPLUS_DELAYED_UPDATE_BATCHED_H
+#define QMCPLUSPLUS_DELAYED_UPDATE_BATCHED_H
+
+#include <vector>
+#include "config.h"
+#include <Numerics/OhmmsPETE/OhmmsVector.h>
+#include <Numerics/OhmmsPETE/OhmmsMatrix.h>
+#include "Numerics/OhmmsBlas.h"
+#include "Numerics/BlasThreadingEnv.h"
+#include "Utilities/SIMD/HugePageAllocator.hpp"
+#include "Utilities/SIMD/algorithm.hpp"
+#include "Utilities/Clock.h"
+
+namespace qmcplusplus
+{
+/** delayed update of the inverse matrices of a crowd of walkers
+ * @tparam DU_TYPE delayed update engine of a walker
+ *
+ * The walkers of a crowd move the same electron at the same time. The Ainv, U, V and Binv
+ * of all the walkers are stored contiguously, one slice per walker. The rows of the inverses
+ * and the accepted moves of all the walkers go through one loop nest over the walkers and
+ * their delayed moves instead of BLAS level 2 calls per walker, which are dominated by
+ * their overhead at small delays. As soon as one walker reaches its delay rank, the pending
+ * updates of all the walkers are applied together in one batched flush, BLAS level 3 per
+ * walker at the threading level of the caller.
+ * The engines of the walkers keep working on their slices for the single walker operations.
+ */
+template<typename DU_TYPE>
+class DelayedUpdateBatched
+{
+  using T = typename DU_TYPE::value_type;
+
+public:
+  /** constructor
+   * @param norb number of electrons/orbitals
+   * @param delay maximum delay of the engines, delay <= 0 for an adaptive delay
+   * @param ainv_list inverse matrices of the walkers, attached to the slices
+   * @param engine_list engines of the walkers, their storage is attached to the slices
+   *
+   * The pending updates of the engines are applied before moving the matrices.
+   */
+  DelayedUpdateBatched(int norb, int delay, const std::vector<Matrix<T>*>& ainv_list, const std::vector<DU_TYPE*>& engine_list)
+      : ainvs(ainv_list), engines(engine_list)
+  {
+    const size_t ainv_size   = getAlignedSize<T>(norb * norb);
+    const size_t engine_size = DU_TYPE::getPoolSize(norb, delay);
+    pool.resize(engines.size() * (ainv_size + engine_size));
+    for (int iw = 0; iw < engines.size(); iw++)
+    {
+      T* ainv_slice = pool.data() + iw * (ainv_size + engine_size);
+      engines[iw]->updateInvMat(*ainvs[iw]);
+      std::copy_n(ainvs[iw]->data(), norb * norb, ainv_slice);
+      ainvs[iw]->free();
+      ainvs[iw]->attachReference(ainv_slice, norb, norb);
+      engines[iw]->resize(norb, delay, ainv_slice + ainv_size);
+    }
+  }
+
+  /// true if the crowd is made of the engines of engine_list in the same order
+  inline bool matches(const std::vector<DU_TYPE*>& engine_list) const { return engines == engine_list; }
+
+  /** compute the rows of the up-to-date inverse matrices of all the walkers
+   * @param rowchanged the row id corresponding to the proposed electron
+   * @param invrow_list rows of the walkers
+   */
+  template<typename VVT>
+  inline void getInvRows(int rowchanged, const std::vector<VVT*>& invrow_list)
+  {
+    const int norb   = ainvs[0]->rows();
+    const double now = engines[0]->adaptive ? cpu_clock() : 0;
+    for (int iw = 0; iw < engines.size(); iw++)
+    {
+      DU_TYPE& eng = *engines[iw];
+      if (eng.adaptive)
+        eng.tuner.countRow(rowchanged, now);
+      T* restrict row = invrow_list[iw]->data();
+      std::copy_n((*ainvs[iw])[rowchanged], norb, row);
+      const int k = eng.delay_count;
+      if (k == 0)
+        continue;
+      // p = U invRow
+      T* restrict p = eng.p.data();
+      for (int i = 0; i < k; i++)
+        p[i] = simd::dot(eng.U[i], row, norb);
+      // Binv[k] = Binv p, kept for the acceptance of the move
+      T* restrict q = eng.Binv[k];
+      std::fill_n(q, k, T(0));
+      for (int j = 0; j < k; j++)
+      {
+        const T* restrict binv = eng.Binv[j];
+        const T pj             = p[j];
+#pragma omp simd
+        for (int i = 0; i < k; i++)
+          q[i] += binv[i] * pj;
+      }
+      // invRow -= V Binv p
+      for (int i = 0; i < k; i++)
+      {
+        const T* restrict v = eng.V[i];
+        const T qi          = q[i];
+#pragma omp simd
+        for (int x = 0; x < norb; x++)
+          row[x] -= v[x] * qi;
+      }
+    }
+  }
+
+  /** accept the moves of the walkers with the updates delayed
+   * @param rowchanged the row id corresponding to the proposed electron
+   * @param isAccepted walkers with an accepted move
+   * @param psiv_list new orbital values of the walkers
+   */
+  template<typename VVT>
+  inline void acceptRows(int rowchanged, const std::vector<bool>& isAccepted, const std::vector<const VVT*>& psiv_list)
+  {
+    const int norb = ainvs[0]->rows();
+    bool full      = false;
+    for (int iw = 0; iw < engines.size(); iw++)
+    {
+      if (!isAccepted[iw])
+        continue;
+      DU_TYPE& eng           = *engines[iw];
+      const int k            = eng.delay_count;
+      const T* restrict psiv = psiv_list[iw]->data();
+      std::copy_n((*ainvs[iw])[rowchanged], norb, eng.V[k]);
+      std::copy_n(psiv, norb, eng.U[k]);
+      eng.delay_list[k] = rowchanged;
+      // p = -V psiV, including the new move
+      T* restrict p = eng.p.data();
+      for (int i = 0; i <= k; i++)
+        p[i] = -simd::dot(eng.V[i], psiv, norb);
+      eng.growBinv();
+      if (eng.adaptive)
+        eng.tuner.countAccept();
+      full = full || eng.delay_count == eng.getDelayRank();
+    }
+    if (full)
+      updateInvMats();
+  }
+
+  /// update the full inverse matrices of all the walkers
+  inline void updateInvMats()
+  {
+    flushing.clear();
+    for (int iw = 0; iw < engines.size(); iw++)
+      if (engines[iw]->getDelayCount() > 0)
+        flushing.push_back(iw);
+    updateInvMats(flushing);
+  }
+
+private:
+  /** update the full inverse matrices of the walkers in the list
+   *
+   * U^T Ainv, V Binv and the rank-k update of Ainv run in one loop over the walkers on the
+   * threads of the caller, the crowds are already spread over the threads.
+   */
+  inline void updateInvMats(const std::vector<int>& walkers)
+  {
+    const T cone(1);
+    const T czero(0);
+    const int norb = ainvs[0]->rows();
+    BlasThreadingEnv knob(1);
+    for (int iw : walkers)
+    {
+      DU_TYPE& eng       = *engines[iw];
+      T* ainv            = ainvs[iw]->data();
+      const int k        = eng.delay_count;
+      const int lda_Binv = eng.Binv.cols();
+      BLAS::gemm('T', 'N', k, norb, norb, cone, eng.U.data(), norb, ainv, norb, czero, eng.tempMat.data(), lda_Binv);
+      for (int i = 0; i < k; i++)
+        eng.tempMat(eng.delay_list[i], i) -= cone;
+      BLAS::gemm('N', 'N', norb, k, k, cone, eng.V.data(), norb, eng.Binv.data(), lda_Binv, czero, eng.U.data(), norb);
+      BLAS::gemm('N', 'N', norb, norb, k, -cone, eng.U.data(), norb, eng.tempMat.data(), lda_Binv, cone, ainv, norb);
+      eng.delay_count = 0;
+      if (eng.adaptive)
+        eng.tuner.flushed();
+    }
+  }
+
+  /// memory of the slices, Ainv followed by the storage of the engine for each walker
+  Vector<T, HugePageAllocator<T, QMC_CLINE, HugePageCategory::DETERMINANT>> pool;
+  std::vector<Matrix<T>*> ainvs;
+  std::vector<DU_TYPE*> engines;
+  /// walkers with updates to apply, reused across calls
+  std::vector<int> flushing;
+};
+} // namespace qmcplusplus
+
+#endif // QMCPLUSPLUS_DELAYED_UPDATE_BATCHED_H
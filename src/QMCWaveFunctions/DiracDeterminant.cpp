@@ -29,12 +29,18 @@ namespace qmcplusplus
 template<typename DU_TYPE>
 DiracDeterminant<DU_TYPE>::DiracDeterminant(SPOSet* const spos, int first, int delay)
     : invRow_id(-1),
+      LazyLaplacians(false),
+      LastResidual(0),
+      NumReinversions(0),
       Phi(spos),
       FirstIndex(first),
       LastIndex(first + spos->size()),
       ndelay(delay),
       NumPtcls(spos->size()),
-      NumOrbitals(spos->size())
+      NumOrbitals(spos->size()),
+      ResidualThreshold(0),
+      ResidualReady(false),
+      ResidualRow(0)
 {
   UpdateTimer  = TimerManager.createTimer("Determinant::update", timer_level_fine);
   RatioTimer   = TimerManager.createTimer("Determinant::ratio", timer_level_fine);
@@ -42,6 +48,8 @@ DiracDeterminant<DU_TYPE>::DiracDeterminant(SPOSet* const spos, int first, int d
   BufferTimer  = TimerManager.createTimer("Determinant::buffer", timer_level_fine);
   SPOVTimer    = TimerManager.createTimer("Determinant::spoval", timer_level_fine);
   SPOVGLTimer  = TimerManager.createTimer("Determinant::spovgl", timer_level_fine);
+  // the inversions anew are counted by Determinant::inverse nested in it
+  ResidualTimer = TimerManager.createTimer("Determinant::residual", timer_level_fine);
   resize(spos->size(), spos->size());
 }
 
@@ -62,18 +70,26 @@ void DiracDeterminant<DU_TYPE>::resize(int nel, int morb)
   if (norb <= 0)
     norb = nel; // for morb == -1 (default)
   updateEng.resize(norb, ndelay);
-  psiM.resize(nel, norb);
-  dpsiM.resize(nel, norb);
-  d2psiM.resize(nel, norb);
+  // the matrices are carved out of a single pool, each starting at an aligned offset
+  const size_t msize = getAlignedSize<ValueType>(nel * norb);
+  psiM_temp.free();
+  psiM.free();
+  dpsiM.free();
+  d2psiM.free();
+  matrixPool.resize(6 * msize);
+  psiM_temp.attachReference(matrixPool.data(), nel, norb);
+  psiM.attachReference(matrixPool.data() + msize, nel, norb);
+  dpsiM.attachReference(reinterpret_cast<GradType*>(matrixPool.data() + 2 * msize), nel, norb);
+  d2psiM.attachReference(matrixPool.data() + 5 * msize, nel, norb);
   psiV.resize(norb);
   invRow.resize(norb);
-  psiM_temp.resize(nel, norb);
   LastIndex   = FirstIndex + nel;
   NumPtcls    = nel;
   NumOrbitals = norb;
 
   dpsiV.resize(NumOrbitals);
   d2psiV.resize(NumOrbitals);
+  LaplacianPending.assign(NumPtcls, 0);
 }
 
 template<typename DU_TYPE>
@@ -93,10 +109,22 @@ typename DiracDeterminant<DU_TYPE>::ValueType DiracDeterminant<DU_TYPE>::ratioGr
                                                                                    int iat,
                                                                                    GradType& grad_iat)
 {
+  UpdateMode             = ORB_PBYP_FUSED;
+  const int WorkingIndex = iat - FirstIndex;
+  if (invRow_id != WorkingIndex)
+  {
+    RatioTimer->start();
+    invRow_id = WorkingIndex;
+    updateEng.getInvRow(psiM, WorkingIndex, invRow);
+    RatioTimer->stop();
+  }
+  // the orbitals stay in the SPOSet until the move is accepted
+  GradType rv;
   SPOVGLTimer->start();
-  Phi->evaluate(P, iat, psiV, dpsiV, d2psiV);
+  Phi->evaluateRatioGrad(P, iat, invRow, curRatio, rv);
   SPOVGLTimer->stop();
-  return ratioGrad_compute(iat, grad_iat);
+  grad_iat += ((RealType)1.0 / curRatio) * rv;
+  return curRatio;
 }
 
 template<typename DU_TYPE>
@@ -127,20 +155,40 @@ typename DiracDeterminant<DU_TYPE>::ValueType DiracDeterminant<DU_TYPE>::ratioGr
 */
 template<typename DU_TYPE>
 void DiracDeterminant<DU_TYPE>::acceptMove(ParticleSet& P, int iat)
+{
+  UpdateTimer->start();
+  acceptMove_compute(iat);
+  updateEng.acceptRow(psiM, iat - FirstIndex, psiV);
+  UpdateTimer->stop();
+}
+
+template<typename DU_TYPE>
+void DiracDeterminant<DU_TYPE>::acceptMove_compute(int iat)
 {
   const int WorkingIndex = iat - FirstIndex;
   PhaseValue += evaluatePhase(curRatio);
   LogValue += std::log(std::abs(curRatio));
-  UpdateTimer->start();
-  updateEng.acceptRow(psiM, WorkingIndex, psiV);
+  if (UpdateMode == ORB_PBYP_FUSED)
+  {
+    // fetch the orbitals of the move, gradients and laplacians go directly to their rows
+    GradVector_t dpsi_row(dpsiM[WorkingIndex], NumOrbitals);
+    ValueVector_t d2psi_row(d2psiM[WorkingIndex], NumOrbitals);
+    if (LazyLaplacians)
+      LaplacianPending[WorkingIndex] = !Phi->copyLastVG(psiV, dpsi_row, d2psi_row);
+    else
+      Phi->copyLastVGL(psiV, dpsi_row, d2psi_row);
+  }
+  // keep the orbitals at the current positions for the residual check
+  if (ResidualThreshold > 0)
+    simd::copy(psiM_temp[WorkingIndex], psiV.data(), NumOrbitals);
   // invRow becomes invalid after accepting a move
   invRow_id = -1;
   if (UpdateMode == ORB_PBYP_PARTIAL)
   {
     simd::copy(dpsiM[WorkingIndex], dpsiV.data(), NumOrbitals);
     simd::copy(d2psiM[WorkingIndex], d2psiV.data(), NumOrbitals);
+    LaplacianPending[WorkingIndex] = 0;
   }
-  UpdateTimer->stop();
   curRatio = 1.0;
 }
 
@@ -152,6 +200,44 @@ void DiracDeterminant<DU_TYPE>::completeUpdates()
   invRow_id = -1;
   updateEng.updateInvMat(psiM);
   UpdateTimer->stop();
+  checkResidual();
+}
+
+template<typename DU_TYPE>
+void DiracDeterminant<DU_TYPE>::setResidualThreshold(RealType threshold)
+{
+  // the rows accepted so far were not kept in psiM_temp
+  if (!(ResidualThreshold > 0))
+    ResidualReady = false;
+  ResidualThreshold = threshold;
+}
+
+template<typename DU_TYPE>
+void DiracDeterminant<DU_TYPE>::checkResidual()
+{
+  if (ResidualThreshold <= 0 || !ResidualReady || NumPtcls == 1)
+    return;
+  ResidualTimer->start();
+  const ValueType* restrict a = psiM_temp[ResidualRow];
+  RealType residual           = 0;
+  for (int j = 0; j < NumPtcls; j++)
+  {
+    const ValueType* restrict b = psiM[j];
+    mValueType r                = j == ResidualRow ? -1 : 0;
+    for (int k = 0; k < NumOrbitals; k++)
+      r += static_cast<mValueType>(a[k]) * static_cast<mValueType>(b[k]);
+    // NaN propagates
+    if (!(std::abs(r) <= residual))
+      residual = std::abs(r);
+  }
+  LastResidual = residual;
+  ResidualRow  = (ResidualRow + 1) % NumPtcls;
+  if (!(residual <= ResidualThreshold))
+  {
+    NumReinversions++;
+    invertPsiM(psiM_temp, psiM);
+  }
+  ResidualTimer->stop();
 }
 
 template<typename DU_TYPE>
@@ -165,8 +251,17 @@ void DiracDeterminant<DU_TYPE>::evaluateGL(ParticleSet& P,
     SPOVGLTimer->start();
     Phi->evaluate_notranspose(P, FirstIndex, LastIndex, psiM_temp, dpsiM, d2psiM);
     SPOVGLTimer->stop();
+    std::fill(LaplacianPending.begin(), LaplacianPending.end(), 0);
   }
+  else
+    evaluatePendingLaplacians(P);
+  accumulateGL(G, L);
+}
 
+template<typename DU_TYPE>
+void DiracDeterminant<DU_TYPE>::accumulateGL(ParticleSet::ParticleGradient_t& G,
+                                             ParticleSet::ParticleLaplacian_t& L) const
+{
   if (NumPtcls == 1)
   {
     ValueType y = psiM(0, 0);
@@ -186,6 +281,20 @@ void DiracDeterminant<DU_TYPE>::evaluateGL(ParticleSet& P,
   }
 }
 
+template<typename DU_TYPE>
+void DiracDeterminant<DU_TYPE>::evaluatePendingLaplacians(ParticleSet& P)
+{
+  SPOVGLTimer->start();
+  for (int i = 0; i < NumPtcls; ++i)
+    if (LaplacianPending[i])
+    {
+      ValueVector_t d2psi_row(d2psiM[i], NumOrbitals);
+      Phi->evaluateLaplacian(P, FirstIndex + i, d2psi_row);
+      LaplacianPending[i] = 0;
+    }
+  SPOVGLTimer->stop();
+}
+
 /** return the ratio only for the  iat-th partcle move
  * @param P current configuration
  * @param iat the particle thas is being moved
@@ -239,24 +348,7 @@ typename DiracDeterminant<DU_TYPE>::RealType DiracDeterminant<DU_TYPE>::evaluate
                                                                                     ParticleSet::ParticleLaplacian_t& L)
 {
   recompute(P);
-
-  if (NumPtcls == 1)
-  {
-    ValueType y = psiM(0, 0);
-    GradType rv = y * dpsiM(0, 0);
-    G[FirstIndex] += rv;
-    L[FirstIndex] += y * d2psiM(0, 0) - dot(rv, rv);
-  }
-  else
-  {
-    for (int i = 0, iat = FirstIndex; i < NumPtcls; i++, iat++)
-    {
-      mGradType rv   = simd::dot(psiM[i], dpsiM[i], NumOrbitals);
-      mValueType lap = simd::dot(psiM[i], d2psiM[i], NumOrbitals);
-      G[iat] += rv;
-      L[iat] += lap - dot(rv, rv);
-    }
-  }
+  accumulateGL(G, L);
   return LogValue;
 }
 
@@ -266,6 +358,16 @@ void DiracDeterminant<DU_TYPE>::recompute(ParticleSet& P)
   SPOVGLTimer->start();
   Phi->evaluate_notranspose(P, FirstIndex, LastIndex, psiM_temp, dpsiM, d2psiM);
   SPOVGLTimer->stop();
+  InverseTimer->start();
+  recomputeInverse();
+  InverseTimer->stop();
+}
+
+template<typename DU_TYPE>
+void DiracDeterminant<DU_TYPE>::recomputeInverse()
+{
+  std::fill(LaplacianPending.begin(), LaplacianPending.end(), 0);
+  ResidualReady = true;
   if (NumPtcls == 1)
   {
     //CurrentDet=psiM(0,0);
@@ -274,9 +376,45 @@ void DiracDeterminant<DU_TYPE>::recompute(ParticleSet& P)
     LogValue      = evaluateLogAndPhase(det, PhaseValue);
   }
   else
+    updateEng.invert_transpose(psiM_temp, psiM, LogValue, PhaseValue);
+}
+
+template<typename DU_TYPE>
+DelayedUpdateBatched<DU_TYPE>& DiracDeterminant<DU_TYPE>::getCrowdEngine(
+    const std::vector<WaveFunctionComponent*>& WFC_list)
+{
+  std::vector<DU_TYPE*> engine_list;
+  engine_list.reserve(WFC_list.size());
+  for (auto wfc : WFC_list)
+    engine_list.push_back(&static_cast<DiracDeterminant<DU_TYPE>*>(wfc)->updateEng);
+  if (!crowdEng || !crowdEng->matches(engine_list))
   {
-    invertPsiM(psiM_temp, psiM);
+    std::vector<ValueMatrix_t*> ainv_list;
+    ainv_list.reserve(WFC_list.size());
+    for (auto wfc : WFC_list)
+      ainv_list.push_back(&static_cast<DiracDeterminant<DU_TYPE>*>(wfc)->psiM);
+    std::shared_ptr<DelayedUpdateBatched<DU_TYPE>> crowd =
+        std::make_shared<DelayedUpdateBatched<DU_TYPE>>(NumOrbitals, ndelay, ainv_list, engine_list);
+    for (auto wfc : WFC_list)
+      static_cast<DiracDeterminant<DU_TYPE>*>(wfc)->crowdEng = crowd;
+    crowdEng = crowd;
   }
+  return *crowdEng;
+}
+
+template<typename DU_TYPE>
+void DiracDeterminant<DU_TYPE>::getCrowdInvRows(const std::vector<WaveFunctionComponent*>& WFC_list, int iat)
+{
+  const int WorkingIndex = iat - FirstIndex;
+  std::vector<ValueVector_t*> invrow_list;
+  invrow_list.reserve(WFC_list.size());
+  for (auto wfc : WFC_list)
+  {
+    auto det       = static_cast<DiracDeterminant<DU_TYPE>*>(wfc);
+    det->invRow_id = WorkingIndex;
+    invrow_list.push_back(&det->invRow);
+  }
+  getCrowdEngine(WFC_list).getInvRows(WorkingIndex, invrow_list);
 }
 
 template<typename DU_TYPE>
@@ -286,10 +424,55 @@ void DiracDeterminant<DU_TYPE>::multi_evaluateLog(const std::vector<WaveFunction
                                  const std::vector<ParticleSet::ParticleLaplacian_t*>& L_list,
                                  ParticleSet::ParticleValue_t& values)
 {
-  for (int iw = 0; iw < P_list.size(); iw++)
-    values[iw] = WFC_list[iw]->evaluateLog(*P_list[iw], *G_list[iw], *L_list[iw]);
+  // the inverse matrices are computed in the storage of the crowd
+  getCrowdEngine(WFC_list);
+  const int nw = WFC_list.size();
+  std::vector<SPOSet*> phi_list(nw);
+  std::vector<ValueMatrix_t*> psiM_temp_list(nw), d2psiM_list(nw);
+  std::vector<GradMatrix_t*> dpsiM_list(nw);
+  for (int iw = 0; iw < nw; iw++)
+  {
+    auto det           = static_cast<DiracDeterminant<DU_TYPE>*>(WFC_list[iw]);
+    phi_list[iw]       = det->Phi;
+    psiM_temp_list[iw] = &det->psiM_temp;
+    dpsiM_list[iw]     = &det->dpsiM;
+    d2psiM_list[iw]    = &det->d2psiM;
+  }
+
+  // one sweep of the orbitals for all the walkers, then their inverses in parallel
+  SPOVGLTimer->start();
+  Phi->multi_evaluate_notranspose(phi_list, P_list, FirstIndex, LastIndex, psiM_temp_list, dpsiM_list, d2psiM_list);
+  SPOVGLTimer->stop();
+
+  InverseTimer->start();
+#pragma omp parallel for
+  for (int iw = 0; iw < nw; iw++)
+  {
+    auto det = static_cast<DiracDeterminant<DU_TYPE>*>(WFC_list[iw]);
+    det->recomputeInverse();
+    det->accumulateGL(*G_list[iw], *L_list[iw]);
+    values[iw] = det->LogValue;
+  }
+  InverseTimer->stop();
 };
 
+template<typename DU_TYPE>
+void DiracDeterminant<DU_TYPE>::multi_evalGrad(const std::vector<WaveFunctionComponent*>& WFC_list,
+                                               const std::vector<ParticleSet*>& P_list,
+                                               int iat,
+                                               std::vector<PosType>& grad_now)
+{
+  const int WorkingIndex = iat - FirstIndex;
+  RatioTimer->start();
+  getCrowdInvRows(WFC_list, iat);
+  for (int iw = 0; iw < WFC_list.size(); iw++)
+  {
+    auto det     = static_cast<DiracDeterminant<DU_TYPE>*>(WFC_list[iw]);
+    grad_now[iw] = simd::dot(det->invRow.data(), det->dpsiM[WorkingIndex], det->invRow.size());
+  }
+  RatioTimer->stop();
+}
+
 template<typename DU_TYPE>
 void DiracDeterminant<DU_TYPE>::multi_ratioGrad(const std::vector<WaveFunctionComponent*>& WFC_list,
                        const std::vector<ParticleSet*>& P_list,
@@ -303,6 +486,7 @@ void DiracDeterminant<DU_TYPE>::multi_ratioGrad(const std::vector<WaveFunctionCo
   std::vector<GradVector_t*> dpsi_v_list; dpsi_v_list.reserve(WFC_list.size());
   std::vector<ValueVector_t*> d2psi_v_list; d2psi_v_list.reserve(WFC_list.size());
 
+  bool fresh_rows = true;
   for(auto wfc : WFC_list)
   {
     auto det = static_cast<DiracDeterminant<DU_TYPE>*>(wfc);
@@ -310,11 +494,19 @@ void DiracDeterminant<DU_TYPE>::multi_ratioGrad(const std::vector<WaveFunctionCo
     psi_v_list.push_back(&(det->psiV));
     dpsi_v_list.push_back(&(det->dpsiV));
     d2psi_v_list.push_back(&(det->d2psiV));
+    fresh_rows = fresh_rows && det->invRow_id == iat - FirstIndex;
   }
 
   Phi->multi_evaluate(phi_list, P_list, iat, psi_v_list, dpsi_v_list, d2psi_v_list);
   SPOVGLTimer->stop();
 
+  if (!fresh_rows)
+  {
+    RatioTimer->start();
+    getCrowdInvRows(WFC_list, iat);
+    RatioTimer->stop();
+  }
+
   //#pragma omp parallel for
   for (int iw = 0; iw < P_list.size(); iw++)
     ratios[iw] = static_cast<DiracDeterminant<DU_TYPE>*>(WFC_list[iw])->ratioGrad_compute(iat, grad_new[iw]);
@@ -326,11 +518,31 @@ void DiracDeterminant<DU_TYPE>::multi_acceptrestoreMove(const std::vector<WaveFu
                                        const std::vector<bool>& isAccepted,
                                        int iat)
 {
-  for (int iw = 0; iw < P_list.size(); iw++)
+  UpdateTimer->start();
+  std::vector<const ValueVector_t*> psiv_list;
+  psiv_list.reserve(WFC_list.size());
+  for (int iw = 0; iw < WFC_list.size(); iw++)
+  {
+    auto det = static_cast<DiracDeterminant<DU_TYPE>*>(WFC_list[iw]);
     if (isAccepted[iw])
-      WFC_list[iw]->acceptMove(*P_list[iw], iat);
+      det->acceptMove_compute(iat);
+    psiv_list.push_back(&det->psiV);
+  }
+  getCrowdEngine(WFC_list).acceptRows(iat - FirstIndex, isAccepted, psiv_list);
+  UpdateTimer->stop();
 };
 
+template<typename DU_TYPE>
+void DiracDeterminant<DU_TYPE>::multi_completeUpdates(const std::vector<WaveFunctionComponent*>& WFC_list)
+{
+  UpdateTimer->start();
+  for (auto wfc : WFC_list)
+    static_cast<DiracDeterminant<DU_TYPE>*>(wfc)->invRow_id = -1;
+  getCrowdEngine(WFC_list).updateInvMats();
+  UpdateTimer->stop();
+  for (auto wfc : WFC_list)
+    static_cast<DiracDeterminant<DU_TYPE>*>(wfc)->checkResidual();
+}
 
 typedef QMCTraits::ValueType ValueType;
 typedef QMCTraits::QTFull::ValueType mValueType;
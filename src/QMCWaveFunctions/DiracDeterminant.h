@@ -22,10 +22,13 @@
 #ifndef QMCPLUSPLUS_DIRACDETERMINANT_H
 #define QMCPLUSPLUS_DIRACDETERMINANT_H
 
+#include <memory>
 #include "QMCWaveFunctions/WaveFunctionComponent.h"
 #include "QMCWaveFunctions/SPOSet.h"
 #include "Utilities/NewTimer.h"
+#include "Utilities/SIMD/HugePageAllocator.hpp"
 #include "QMCWaveFunctions/DelayedUpdate.h"
+#include "QMCWaveFunctions/DelayedUpdateBatched.h"
 #if defined(ENABLE_CUDA)
 #include "QMCWaveFunctions/DelayedUpdateCUDA.h"
 #endif
@@ -82,8 +85,13 @@ public:
   /** move was accepted, update the real container
    */
   void acceptMove(ParticleSet& P, int iat) override;
+  //helper function, called by acceptMove and multi_acceptrestoreMove, updates all but the inverse matrix
+  void acceptMove_compute(int iat);
   void completeUpdates() override;
 
+  /// prefetch the orbitals at the proposed position
+  void prefetch(const ParticleSet& P, int iat, const PosType& r) override { Phi->prefetch(r); }
+
   ///evaluate log of a determinant for a particle set
   RealType evaluateLog(ParticleSet& P, ParticleSet::ParticleGradient_t& G, ParticleSet::ParticleLaplacian_t& L) override;
 
@@ -95,6 +103,11 @@ public:
                          const std::vector<ParticleSet::ParticleLaplacian_t*>& L_list,
                          ParticleSet::ParticleValue_t& values) override;
 
+  void multi_evalGrad(const std::vector<WaveFunctionComponent*>& WFC_list,
+                      const std::vector<ParticleSet*>& P_list,
+                      int iat,
+                      std::vector<PosType>& grad_now) override;
+
   void multi_ratioGrad(const std::vector<WaveFunctionComponent*>& WFC_list,
                        const std::vector<ParticleSet*>& P_list,
                        int iat,
@@ -106,6 +119,11 @@ public:
                                const std::vector<bool>& isAccepted,
                                int iat) override;
 
+  void multi_completeUpdates(const std::vector<WaveFunctionComponent*>& WFC_list) override;
+
+  /// memory of psiM_temp, psiM, dpsiM and d2psiM, backed by huge pages if enabled for HugePageCategory::DETERMINANT
+  Vector<ValueType, HugePageAllocator<ValueType, QMC_CLINE, HugePageCategory::DETERMINANT>> matrixPool;
+
   /// psiM(j,i) \f$= \psi_j({\bf r}_i)\f$
   ValueMatrix_t psiM_temp;
 
@@ -126,6 +144,12 @@ public:
   /// delayed update engine
   DU_TYPE updateEng;
 
+  /// number of accepted moves triggering the update of the inverse, tuned at run time with an adaptive delay
+  int getDelayRank() const { return updateEng.getDelayRank(); }
+
+  /// delayed updates of the crowd of walkers of the last multi_* call, shared by their determinants
+  std::shared_ptr<DelayedUpdateBatched<DU_TYPE>> crowdEng;
+
   /// the row of up-to-date inverse matrix
   ValueVector_t invRow;
 
@@ -138,6 +162,27 @@ public:
 
   ValueType curRatio;
 
+  /** if true, the laplacians of the accepted moves are left to evaluateGL when the SPOSet allows it
+   *
+   * An electron moved several times between two evaluateGL gets its laplacians once, which pays
+   * off at low acceptance or with several substeps. Off by default.
+   */
+  bool LazyLaplacians;
+  /// 1 for the rows of d2psiM of the moves accepted without their laplacians, evaluated by evaluateGL
+  std::vector<char> LaplacianPending;
+
+  /** set the largest element of a sampled row of psiM_temp*psiM^T-I accepted by completeUpdates, 0 for no check
+   *
+   * psiM_temp only follows the accepted moves with a positive threshold. A threshold turned on
+   * after recompute takes effect at the next recompute, which refreshes psiM_temp.
+   */
+  void setResidualThreshold(RealType threshold);
+  RealType getResidualThreshold() const { return ResidualThreshold; }
+  /// residual of the last check
+  RealType LastResidual;
+  /// number of inverses recomputed from scratch by completeUpdates
+  int NumReinversions;
+
 private:
 
   /// Timers
@@ -147,6 +192,7 @@ private:
   NewTimer* BufferTimer;
   NewTimer* SPOVTimer;
   NewTimer* SPOVGLTimer;
+  NewTimer* ResidualTimer;
   /// a set of single-particle orbitals used to fill in the  values of the matrix
   SPOSet* const Phi;
   ///index of the first particle with respect to the particle set
@@ -159,9 +205,32 @@ private:
   int NumPtcls;
   /// delayed update rank
   int ndelay;
+  /// see setResidualThreshold
+  RealType ResidualThreshold;
+  /// true if psiM_temp follows the accepted moves since the last recompute, required by the residual check
+  bool ResidualReady;
+  /// row of psiM_temp sampled by the next residual check
+  int ResidualRow;
 
   ///reset the size: with the number of particles and number of orbtials
   void resize(int nel, int morb);
+  /// evaluate the rows of d2psiM marked in LaplacianPending at the current positions
+  void evaluatePendingLaplacians(ParticleSet& P);
+  /// psiM, LogValue and PhaseValue from psiM_temp, without timers for the walkers of a crowd
+  void recomputeInverse();
+  /// add the gradients and laplacians of the determinant from psiM, dpsiM and d2psiM to G and L
+  void accumulateGL(ParticleSet::ParticleGradient_t& G, ParticleSet::ParticleLaplacian_t& L) const;
+  /** check a row of psiM_temp*psiM^T against the identity once the updates are applied
+   *
+   * psiM_temp holds the orbitals at the current positions, psiM is inverted anew from it
+   * if the residual exceeds ResidualThreshold. The rows are sampled in turn, at O(N^2) a check
+   * costs a fraction of an update of the inverse.
+   */
+  void checkResidual();
+  /// the delayed updates of the crowd of WFC_list, its inverse matrices are moved to the crowd if needed
+  DelayedUpdateBatched<DU_TYPE>& getCrowdEngine(const std::vector<WaveFunctionComponent*>& WFC_list);
+  /// compute the rows iat of the up-to-date inverse matrices of the crowd of WFC_list
+  void getCrowdInvRows(const std::vector<WaveFunctionComponent*>& WFC_list, int iat);
 };
 
 
@@ -108,6 +108,9 @@ public:
   /// delayed update engine
   DU_TYPE updateEng;
 
+  /// number of accepted moves triggering the update of the inverse, tuned at run time with an adaptive delay
+  int getDelayRank() const { return updateEng.getDelayRank(); }
+
   /// the row of up-to-date inverse matrix
   ValueVector_t invRow;
 
@@ -0,0 +1,47 @@
+//////////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source License.
+// See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+//////////////////////////////////////////////////////////////////////////////////////
+
+#include "QMCWaveFunctions/DiracMatrix.h"
+
+namespace qmcplusplus
+{
+std::string getInverseKernelName(InverseKernel kernel)
+{
+  if (kernel == InverseKernel::LAPACK)
+    return "lapack";
+  else if (kernel == InverseKernel::BLOCKED)
+    return "blocked";
+  return "auto";
+}
+
+bool parseInverseKernel(const std::string& name, InverseKernel& kernel)
+{
+  if (name == "lapack")
+    kernel = InverseKernel::LAPACK;
+  else if (name == "blocked")
+    kernel = InverseKernel::BLOCKED;
+  else if (name == "auto")
+    kernel = InverseKernel::AUTO;
+  else
+    return false;
+  return true;
+}
+
+static InverseKernel& activeInverseKernel()
+{
+  static InverseKernel kernel = InverseKernel::AUTO;
+  return kernel;
+}
+
+InverseKernel getInverseKernel() { return activeInverseKernel(); }
+
+void setInverseKernel(InverseKernel kernel) { activeInverseKernel() = kernel; }
+} // namespace qmcplusplus
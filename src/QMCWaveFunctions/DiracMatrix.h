@@ -12,16 +12,43 @@
 #ifndef QMCPLUSPLUS_DIRAC_MATRIX_H
 #define QMCPLUSPLUS_DIRAC_MATRIX_H
 
+#include <limits>
+#include <map>
+#include <string>
 #include "Numerics/Blasf.h"
 #include "Numerics/OhmmsBlas.h"
 #include "Numerics/OhmmsPETE/OhmmsMatrix.h"
 #include "Numerics/BlasThreadingEnv.h"
 #include "Utilities/scalar_traits.h"
+#include "Utilities/SIMD/allocator.hpp"
 #include "Utilities/SIMD/algorithm.hpp"
 #include "QMCWaveFunctions/DeterminantHelper.h"
+#include "QMCWaveFunctions/BlockedInverse.h"
+#include "Utilities/Clock.h"
+#include "Utilities/OutputManager.h"
 
 namespace qmcplusplus
 {
+/// kernels of the LU factorization and inversion of DiracMatrix
+enum class InverseKernel
+{
+  LAPACK,
+  BLOCKED,
+  /// the faster of the two, timed once for each matrix size
+  AUTO
+};
+
+std::string getInverseKernelName(InverseKernel kernel);
+
+/** parse the name of a kernel: lapack, blocked or auto
+ * @return false if the name is unknown
+ */
+bool parseInverseKernel(const std::string& name, InverseKernel& kernel);
+
+/// kernel of all the DiracMatrix, AUTO by default
+InverseKernel getInverseKernel();
+void setInverseKernel(InverseKernel kernel);
+
 template<typename T>
 inline T computeLogDet(const T* restrict diag, int n, const int* restrict pivot, T& phase)
 {
@@ -68,6 +95,8 @@ class DiracMatrix
   Matrix<T_FP> psiM_fp;
   /// LU diagonal elements
   aligned_vector<T_FP> LU_diag;
+  /// scratch space of the blocked kernel
+  aligned_vector<T_FP> blocked_work;
 
   /// reset internal work space
   inline void reset(T_FP* invMat_ptr, const int lda)
@@ -84,36 +113,119 @@ class DiracMatrix
     LU_diag.resize(lda);
   }
 
+  /// invert in place with LAPACK getrf and getri
+  inline void invertLAPACK(T_FP* invMat_ptr, int n, int lda, real_type_fp& LogDet, real_type_fp& Phase)
+  {
+    if (Lwork < lda || LU_diag.size() < lda)
+      reset(invMat_ptr, lda);
+    int status;
+    LAPACK::getrf(n, n, invMat_ptr, lda, m_pivot.data(), status);
+    for (int i = 0; i < n; i++)
+      LU_diag[i] = invMat_ptr[i * lda + i];
+    LogDet = computeLogDet(LU_diag.data(), n, m_pivot.data(), Phase);
+    LAPACK::getri(n, invMat_ptr, lda, m_pivot.data(), m_work.data(), Lwork, status);
+  }
+
+  /** invert in place with blocked_getrf and blocked_getri, a singular matrix is left factorized as with LAPACK
+   * @param transpose if true, the matrix is replaced by the transpose of its inverse
+   */
+  inline void invertBlocked(T_FP* invMat_ptr,
+                            int n,
+                            int lda,
+                            real_type_fp& LogDet,
+                            real_type_fp& Phase,
+                            bool transpose = false)
+  {
+    if (m_pivot.size() < n)
+      m_pivot.resize(n);
+    blocked_work.resize(n * (n + 2));
+    if (blocked_getrf(n, invMat_ptr, lda, m_pivot.data(), LogDet, Phase))
+      blocked_getri(n, invMat_ptr, lda, m_pivot.data(), blocked_work.data(), transpose);
+  }
+
+  /// time both kernels on a well conditioned matrix of size n, the best of a few calls each
+  static InverseKernel timeKernels(int n)
+  {
+    constexpr int num_calls = 2;
+    Matrix<T_FP> a(n, n), ainv(n, n);
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < n; j++)
+        a(i, j) = (i == j ? n : 0) + ((i * 7 + j * 13) % 17) / 17.0 - 0.5;
+    DiracMatrix dm;
+    real_type_fp logdet, phase;
+    double best[2] = {std::numeric_limits<double>::max(), std::numeric_limits<double>::max()};
+    for (int c = 0; c < num_calls; c++)
+      for (int k = 0; k < 2; k++)
+      {
+        ainv            = a;
+        const double t0 = cpu_clock();
+        if (k == 0)
+          dm.invertLAPACK(ainv.data(), n, n, logdet, phase);
+        else
+          dm.invertBlocked(ainv.data(), n, n, logdet, phase, true);
+        best[k] = std::min(best[k], cpu_clock() - t0);
+      }
+    const InverseKernel faster = best[1] < best[0] ? InverseKernel::BLOCKED : InverseKernel::LAPACK;
+    app_log() << "DiracMatrix inversion of size " << n << ": lapack " << best[0] * 1e6 << " us, blocked "
+              << best[1] * 1e6 << " us, using " << getInverseKernelName(faster) << std::endl;
+    return faster;
+  }
+
 public:
   DiracMatrix() : Lwork(0) {}
 
+  /** kernel inverting the matrices of size n
+   *
+   * With InverseKernel::AUTO, the kernels are timed at the first call for a size
+   * and the faster one is used by all the DiracMatrix of this type.
+   */
+  static InverseKernel getKernel(int n)
+  {
+    if (getInverseKernel() != InverseKernel::AUTO)
+      return getInverseKernel();
+    static std::map<int, InverseKernel> tuned;
+    InverseKernel kernel;
+#pragma omp critical(DiracMatrix_tuning)
+    {
+      auto it = tuned.find(n);
+      if (it == tuned.end())
+        it = tuned.insert(std::make_pair(n, timeKernels(n))).first;
+      kernel = it->second;
+    }
+    return kernel;
+  }
+
   /** compute the inverse of the transpose of matrix A
    * assume precision T_FP >= T, do the inversion always with T_FP
+   *
+   * LAPACK inverts the transposed copy of A in place. The blocked kernel inverts a plain copy
+   * of A and writes the rows of the inverse as columns in its last pass, see blocked_getri.
    */
   inline void invert_transpose(const Matrix<T>& amat, Matrix<T>& invMat, real_type& LogDet, real_type& Phase)
   {
     BlasThreadingEnv knob(getNextLevelNumThreads());
-    const int n   = invMat.rows();
-    const int lda = invMat.cols();
+    const int n        = invMat.rows();
+    const int lda      = invMat.cols();
+    const bool blocked = getKernel(n) == InverseKernel::BLOCKED;
     T_FP* invMat_ptr(nullptr);
 #if !defined(MIXED_PRECISION)
-    simd::transpose(amat.data(), n, amat.cols(), invMat.data(), n, invMat.cols());
     invMat_ptr = invMat.data();
 #else
     psiM_fp.resize(n, lda);
-    simd::transpose(amat.data(), n, amat.cols(), psiM_fp.data(), n, psiM_fp.cols());
     invMat_ptr = psiM_fp.data();
 #endif
-    if (Lwork < lda)
-      reset(invMat_ptr, lda);
-    int status;
-    LAPACK::getrf(n, n, invMat_ptr, lda, m_pivot.data(), status);
-    for (int i = 0; i < n; i++)
-      LU_diag[i] = invMat_ptr[i * lda + i];
-    real_type_fp Phase_tmp;
-    LogDet = computeLogDet(LU_diag.data(), n, m_pivot.data(), Phase_tmp);
+    if (blocked)
+      for (int i = 0; i < n; i++)
+        std::copy_n(amat[i], n, invMat_ptr + i * lda);
+    else
+      simd::transpose(amat.data(), n, amat.cols(), invMat_ptr, n, lda);
+    real_type_fp LogDet_tmp, Phase_tmp;
+    if (blocked)
+      invertBlocked(invMat_ptr, n, lda, LogDet_tmp, Phase_tmp, true);
+    else
+      invertLAPACK(invMat_ptr, n, lda, LogDet_tmp, Phase_tmp);
+    LogDet = LogDet_tmp;
     Phase  = Phase_tmp;
-    LAPACK::getri(n, invMat_ptr, lda, m_pivot.data(), m_work.data(), Lwork, status);
 #if defined(MIXED_PRECISION)
     invMat = psiM_fp;
 #endif
@@ -63,6 +63,76 @@ public:
    */
   virtual void evaluate(const ParticleSet& P, int iat, ValueVector_t& psi_v, GradVector_t& dpsi_v, ValueVector_t& d2psi_v) = 0;
 
+  /** evaluate the determinant ratio and gradient of a move without returning the orbitals
+   * @param P current ParticleSet
+   * @param iat active particle
+   * @param invRow the row of inverse slater matrix corresponding to the particle moved
+   * @param ratio return invRow dot psi
+   * @param grad_dot return invRow dot dpsi
+   *
+   * The values, gradients and laplacians of the move are kept by the SPOSet until
+   * its next evaluation and can be retrieved with copyLastVGL once the move is accepted.
+   */
+  virtual void evaluateRatioGrad(const ParticleSet& P,
+                                 int iat,
+                                 const ValueVector_t& invRow,
+                                 ValueType& ratio,
+                                 GradType& grad_dot)
+  {
+    lastPsi.resize(OrbitalSetSize);
+    lastdPsi.resize(OrbitalSetSize);
+    lastd2Psi.resize(OrbitalSetSize);
+    evaluate(P, iat, lastPsi, lastdPsi, lastd2Psi);
+    ratio    = simd::dot(invRow.data(), lastPsi.data(), OrbitalSetSize);
+    grad_dot = simd::dot(invRow.data(), lastdPsi.data(), OrbitalSetSize);
+  }
+
+  /** copy the values, gradients and laplacians of the last evaluateRatioGrad
+   * @param psi values of the SPO
+   * @param dpsi gradients of the SPO
+   * @param d2psi laplacians of the SPO
+   */
+  virtual void copyLastVGL(ValueVector_t& psi_v, GradVector_t& dpsi_v, ValueVector_t& d2psi_v)
+  {
+    std::copy_n(lastPsi.data(), OrbitalSetSize, psi_v.data());
+    std::copy_n(lastdPsi.data(), OrbitalSetSize, dpsi_v.data());
+    std::copy_n(lastd2Psi.data(), OrbitalSetSize, d2psi_v.data());
+  }
+
+  /** copy the values and gradients of the last evaluateRatioGrad, and the laplacians if they are at hand
+   * @param psi values of the SPO
+   * @param dpsi gradients of the SPO
+   * @param d2psi laplacians of the SPO
+   * @return false if d2psi_v is not written, the laplacians have to be evaluated at the position later
+   *
+   * An SPOSet which evaluates only the values and gradients for the ratio leaves the laplacians out,
+   * so that they are evaluated for the moves they are needed for. The default copies all of them.
+   */
+  virtual bool copyLastVG(ValueVector_t& psi_v, GradVector_t& dpsi_v, ValueVector_t& d2psi_v)
+  {
+    copyLastVGL(psi_v, dpsi_v, d2psi_v);
+    return true;
+  }
+
+  /** evaluate the laplacians only, for the moves accepted without them, see copyLastVG
+   * @param P current ParticleSet
+   * @param iat active particle
+   * @param d2psi laplacians of the SPO
+   *
+   * The default evaluates the values and the gradients as well.
+   */
+  virtual void evaluateLaplacian(const ParticleSet& P, int iat, ValueVector_t& d2psi_v)
+  {
+    ValueVector_t psi_v(OrbitalSetSize);
+    GradVector_t dpsi_v(OrbitalSetSize);
+    evaluate(P, iat, psi_v, dpsi_v, d2psi_v);
+  }
+
+  /** issue prefetches for the data of an evaluation at r, nothing by default
+   * @param r position of a future evaluation
+   */
+  virtual void prefetch(const PosType& r) {}
+
   /** evaluate determinant ratios for virtual moves, e.g., sphere move for nonlocalPP
    * @param VP virtual particle set
    * @param psi values of the SPO, used as a scratch space if needed
@@ -126,6 +196,26 @@ public:
       spo_list[iw]->evaluate(*P_list[iw], iat, *psi_v_list[iw], *dpsi_v_list[iw], *d2psi_v_list[iw]);
   }
 
+  /// evaluate_notranspose of multiple walkers
+  virtual void multi_evaluate_notranspose(const std::vector<SPOSet*>& spo_list,
+                                          const std::vector<ParticleSet*>& P_list,
+                                          int first,
+                                          int last,
+                                          const std::vector<ValueMatrix_t*>& logdet_list,
+                                          const std::vector<GradMatrix_t*>& dlogdet_list,
+                                          const std::vector<ValueMatrix_t*>& d2logdet_list)
+  {
+#pragma omp parallel for
+    for (int iw = 0; iw < spo_list.size(); iw++)
+      spo_list[iw]->evaluate_notranspose(*P_list[iw], first, last, *logdet_list[iw], *dlogdet_list[iw],
+                                         *d2logdet_list[iw]);
+  }
+
+protected:
+  /// orbitals of the last evaluateRatioGrad, unused if it is overridden
+  ValueVector_t lastPsi;
+  GradVector_t lastdPsi;
+  ValueVector_t lastd2Psi;
 };
 
 } // namespace qmcplusplus
@@ -23,20 +23,64 @@ SPOSet* build_SPOSet(bool useRef,
                      int num_splines,
                      int nblocks,
                      const Tensor<OHMMS_PRECISION, 3>& lattice_b,
-                     bool init_random)
+                     bool init_random,
+                     spline2::SplineStorage storage,
+                     const std::string& coef_file,
+                     NumaPolicy numa_policy,
+                     int brick_shift,
+                     OHMMS_PRECISION support,
+                     bool inversion,
+                     size_t cache_bytes,
+                     OHMMS_PRECISION coarse_fraction)
 {
   if (useRef)
   {
     auto* spo_main = new miniqmcreference::einspline_spo_ref<OHMMS_PRECISION>;
-    spo_main->set(nx, ny, nz, num_splines, nblocks);
+    spo_main->set(nx, ny, nz, num_splines, nblocks, true, inversion);
     spo_main->Lattice.set(lattice_b);
     return dynamic_cast<SPOSet*>(spo_main);
   }
   else
   {
     auto* spo_main = new einspline_spo<OHMMS_PRECISION>;
-    spo_main->set(nx, ny, nz, num_splines, nblocks);
+    if (coef_file.empty())
+    {
+      spo_main->set(nx, ny, nz, num_splines, nblocks, init_random, storage, brick_shift, inversion);
+      spo_main->localize(support);
+    }
+    else if (cache_bytes > 0)
+    {
+      if (!spo_main->page(coef_file, nx, ny, nz, num_splines, nblocks, brick_shift, inversion, cache_bytes))
+      {
+        einspline_spo<OHMMS_PRECISION> spo_file;
+        spo_file.set(nx, ny, nz, num_splines, nblocks, init_random, storage, brick_shift, inversion);
+        spo_file.localize(support);
+        spo_file.save(coef_file);
+        app_summary() << "SPO coefficients written to " << coef_file << std::endl;
+        spo_main->page(coef_file, nx, ny, nz, num_splines, nblocks, brick_shift, inversion, cache_bytes);
+      }
+      spo_main->localize(support);
+      app_summary() << "SPO coefficients paged from " << coef_file << " through a cache of " << (cache_bytes >> 20)
+                    << " MB" << std::endl;
+    }
+    else if (spo_main->load(coef_file, nx, ny, nz, num_splines, nblocks, storage, brick_shift, inversion))
+    {
+      spo_main->localize(support);
+      app_summary() << "SPO coefficients mapped from " << coef_file << std::endl;
+    }
+    else
+    {
+      spo_main->set(nx, ny, nz, num_splines, nblocks, init_random, storage, brick_shift, inversion);
+      spo_main->localize(support);
+      spo_main->save(coef_file);
+      app_summary() << "SPO coefficients written to " << coef_file << std::endl;
+    }
     spo_main->Lattice.set(lattice_b);
+    spo_main->setCoarse(coarse_fraction);
+    const int num_domains = spo_main->applyNumaPolicy(numa_policy);
+    if (numa_policy != NumaPolicy::NONE)
+      app_summary() << "SPO coefficients NUMA policy = " << getNumaPolicyName(numa_policy) << " over " << num_domains
+                    << " domain(s)" << std::endl;
     return dynamic_cast<SPOSet*>(spo_main);
   }
 }
@@ -59,4 +103,14 @@ SPOSet* build_SPOSet_view(bool useRef, const SPOSet* SPOSet_main, int team_size,
   }
 }
 
+SPOSet* build_SPOSet_team_view(bool useRef, const SPOSet* SPOSet_main, int team_size)
+{
+  if (useRef || team_size < 2)
+    return build_SPOSet_view(useRef, SPOSet_main, 1, 0);
+  auto* temp_ptr = dynamic_cast<const einspline_spo<OHMMS_PRECISION>*>(SPOSet_main);
+  auto* spo_view = new einspline_spo<OHMMS_PRECISION>(*temp_ptr, 1, 0);
+  spo_view->createTeam(team_size);
+  return dynamic_cast<SPOSet*>(spo_view);
+}
+
 } // namespace qmcplusplus
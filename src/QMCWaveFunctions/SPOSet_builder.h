@@ -13,10 +13,19 @@
 #define QMCPLUSPLUS_SINGLEPARTICLEORBITALSET_BUILDER_H
 
 #include "QMCWaveFunctions/SPOSet.h"
+#include "Numerics/Spline2/bspline_half.hpp"
+#include "Utilities/NumaTools.h"
 
 namespace qmcplusplus
 {
-/// build the einspline SPOSet.
+/** build the einspline SPOSet.
+ * @param support edge of the boxes localizing the orbitals of each block relative to the cell,
+ *        0 for delocalized orbitals, ignored with useRef
+ * @param inversion if true, only half of the grid is stored using the inversion symmetry of the orbitals
+ * @param cache_bytes if positive, the bricks of coef_file are read on demand through a cache of this size
+ * @param coarse_fraction if in (0,1), the ratios of the virtual moves use a grid coarser by this fraction,
+ *        ignored with useRef
+ */
 SPOSet* build_SPOSet(bool useRef,
                      int nx,
                      int ny,
@@ -24,10 +33,21 @@ SPOSet* build_SPOSet(bool useRef,
                      int num_splines,
                      int nblocks,
                      const Tensor<OHMMS_PRECISION, 3>& lattice_b,
-                     bool init_random = true);
+                     bool init_random                = true,
+                     spline2::SplineStorage storage  = spline2::SplineStorage::FULL,
+                     const std::string& coef_file    = "",
+                     NumaPolicy numa_policy          = NumaPolicy::NONE,
+                     int brick_shift                 = 0,
+                     OHMMS_PRECISION support         = 0,
+                     bool inversion                  = false,
+                     size_t cache_bytes              = 0,
+                     OHMMS_PRECISION coarse_fraction = 0);
 
 /// build the einspline SPOSet as a view of the main one.
 SPOSet* build_SPOSet_view(bool useRef, const SPOSet* SPOSet_main, int team_size, int member_id);
 
+/// build a view of all the orbitals of the main SPOSet evaluated by a team of threads, a plain view with useRef.
+SPOSet* build_SPOSet_team_view(bool useRef, const SPOSet* SPOSet_main, int team_size);
+
 } // namespace qmcplusplus
 #endif
@@ -0,0 +1,95 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file SplineTileProfile.cpp
+ * @brief Implements the per-host profile of the tuned spline tile sizes
+ */
+#include "QMCWaveFunctions/SplineTileProfile.h"
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+namespace qmcplusplus
+{
+/// the entry of a setup in the profile
+static std::string getTileKeyString(const SplineTileKey& key)
+{
+  std::ostringstream os;
+  os << key.nx << ' ' << key.ny << ' ' << key.nz << ' ' << key.norb << ' ' << spline2::getSplineStorageName(key.storage)
+     << ' ' << key.brick_shift << ' ' << key.kernels << ' ' << key.precision;
+  return os.str();
+}
+
+/// split a profile line into the key and the tuned tile size
+static bool parseTileEntry(const std::string& line, std::string& key, int& tile_size)
+{
+  std::istringstream is(line);
+  std::string field;
+  std::vector<std::string> fields;
+  while (is >> field)
+    fields.push_back(field);
+  if (fields.size() < 9 || fields[0][0] == '#')
+    return false;
+  key = fields[0];
+  for (int i = 1; i < 8; i++)
+    key += ' ' + fields[i];
+  tile_size = std::atoi(fields[8].c_str());
+  return tile_size > 0;
+}
+
+std::string getTileProfileName()
+{
+  const char* env = std::getenv("MINIQMC_TILE_PROFILE");
+  if (env != nullptr && env[0] != '\0')
+    return env;
+  char host[256] = "localhost";
+  gethostname(host, sizeof(host) - 1);
+  return std::string("spline_tiles.") + host + ".txt";
+}
+
+int loadTileSize(const std::string& fname, const SplineTileKey& key)
+{
+  std::ifstream fin(fname);
+  const std::string key_str = getTileKeyString(key);
+  std::string line, entry_key;
+  int tile_size = 0, entry_size;
+  // the last entry wins
+  while (std::getline(fin, line))
+    if (parseTileEntry(line, entry_key, entry_size) && entry_key == key_str && key.norb % entry_size == 0)
+      tile_size = entry_size;
+  return tile_size;
+}
+
+bool saveTileSize(const std::string& fname, const SplineTileKey& key, int tile_size, double time_us)
+{
+  const std::string key_str = getTileKeyString(key);
+  std::vector<std::string> lines;
+  {
+    std::ifstream fin(fname);
+    std::string line, entry_key;
+    int entry_size;
+    while (std::getline(fin, line))
+      if (parseTileEntry(line, entry_key, entry_size) && entry_key != key_str)
+        lines.push_back(line);
+  }
+
+  std::ofstream fout(fname, std::ios::trunc);
+  if (!fout)
+    return false;
+  fout << "# nx ny nz norb storage brick_shift kernels precision tile_size time_us" << std::endl;
+  for (const auto& line : lines)
+    fout << line << std::endl;
+  fout << key_str << ' ' << tile_size << ' ' << time_us << std::endl;
+  return static_cast<bool>(fout);
+}
+
+} // namespace qmcplusplus
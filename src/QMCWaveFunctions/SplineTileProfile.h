@@ -0,0 +1,94 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file SplineTileProfile.h
+ * @brief Per-host profile of the tuned spline tile sizes
+ *
+ * The profile is a text file with one line per spline setup:
+ *   nx ny nz norb storage brick_shift kernels precision tile_size time_us
+ * written by tune_spo and read by the miniqmc drivers when no tile size is given.
+ */
+#ifndef QMCPLUSPLUS_SPLINE_TILE_PROFILE_H
+#define QMCPLUSPLUS_SPLINE_TILE_PROFILE_H
+
+#include <string>
+#include <vector>
+#include <Utilities/SIMD/allocator.hpp>
+#include <Numerics/Spline2/bspline_half.hpp>
+#include <Numerics/Spline2/MultiBsplineSIMD.h>
+
+namespace qmcplusplus
+{
+/// the spline setup a tile size is tuned for
+struct SplineTileKey
+{
+  int nx          = 0;
+  int ny          = 0;
+  int nz          = 0;
+  int norb        = 0;
+  int brick_shift = 0;
+  /// bytes of the full precision type
+  int precision                  = 0;
+  spline2::SplineStorage storage = spline2::SplineStorage::FULL;
+  /// name of the spline kernels
+  std::string kernels;
+};
+
+/// the setup of num_splines in T on a nx x ny x nz grid with the current spline kernels
+template<typename T>
+SplineTileKey getSplineTileKey(int nx, int ny, int nz, int num_splines, spline2::SplineStorage storage, int brick_shift)
+{
+  SplineTileKey key;
+  key.nx          = nx;
+  key.ny          = ny;
+  key.nz          = nz;
+  key.norb        = num_splines;
+  key.brick_shift = brick_shift;
+  key.precision   = sizeof(T);
+  key.storage     = storage;
+  key.kernels     = spline2::getSplineISAName(spline2::getSplineISA());
+  return key;
+}
+
+/** name of the profile of this host
+ *
+ * $MINIQMC_TILE_PROFILE if set, otherwise spline_tiles.<hostname>.txt in the current directory.
+ */
+std::string getTileProfileName();
+
+/** read the tuned tile size of key
+ * @return 0 if the profile or the entry doesn't exist
+ */
+int loadTileSize(const std::string& fname, const SplineTileKey& key);
+
+/** add or replace the entry of key, the other entries are kept
+ * @param time_us time per evaluation of the tuned tile size, kept for reference
+ * @return false if the profile cannot be written
+ */
+bool saveTileSize(const std::string& fname, const SplineTileKey& key, int tile_size, double time_us);
+
+/** tile sizes which divide norb and are multiples of the SIMD alignment of T
+ *
+ * norb itself, a single tile, is always the last candidate.
+ */
+template<typename T>
+std::vector<int> getTileSizeCandidates(int norb)
+{
+  std::vector<int> sizes;
+  for (int ts = 1; ts < norb; ts++)
+    if (norb % ts == 0 && getAlignedSize<T>(ts) == static_cast<size_t>(ts))
+      sizes.push_back(ts);
+  sizes.push_back(norb);
+  return sizes;
+}
+
+} // namespace qmcplusplus
+#endif
@@ -0,0 +1,236 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file SyntheticOrbitals.h
+ * @brief Analytic orbitals with sharp features at the ions
+ */
+#ifndef QMCPLUSPLUS_SYNTHETIC_ORBITALS_H
+#define QMCPLUSPLUS_SYNTHETIC_ORBITALS_H
+
+#include <cmath>
+#include <vector>
+#include <Utilities/Configuration.h>
+#include <Utilities/RandomGenerator.h>
+#include <Particle/ParticleSet.h>
+#include <Numerics/SolidHarmonics.h>
+
+namespace qmcplusplus
+{
+/** analytic orbitals to build and check the spline representations
+ *
+ * \f[ \phi_n({\bf r}) = c_n + \sum_{\bf K} a_{n{\bf K}} \cos({\bf K}\cdot{\bf r}) + b_{n{\bf K}} \sin({\bf K}\cdot{\bf r})
+ *     + \sum_{I,l\le 2,m} d_{nIlm} S_{lm}({\bf d}_I/\sigma) e^{-d_I^2/2\sigma^2} \f]
+ * K are half of the reciprocal lattice vectors with integer components up to kmax, d_I is the
+ * minimum image displacement from the ion I and S_lm the real solid harmonics. The smooth part
+ * is resolved by a coarse grid while the atomic terms need a grid spacing well below sigma.
+ */
+template<typename T>
+class SyntheticOrbitals
+{
+public:
+  using PosType      = TinyVector<T, 3>;
+  using lattice_type = CrystalLattice<T, 3>;
+
+  /** constructor
+   * @param ions the atomic terms are centered at the ions, the orbitals are periodic in their lattice
+   * @param num_orbitals number of orbitals
+   * @param sigma width of the atomic terms
+   * @param kmax largest component of the reciprocal lattice vectors of the smooth part
+   */
+  SyntheticOrbitals(const ParticleSet& ions, int num_orbitals, T sigma = T(0.2), int kmax = 2, int seed = 17)
+      : NumOrbitals(num_orbitals), Sigma(sigma), Ylm(2)
+  {
+    Lattice = ions.Lattice;
+    for (int i = 0; i < ions.getTotalNum(); i++)
+      Centers.push_back(ions.R.InUnit == PosUnit::LatticeUnit ? Lattice.toCart(ions.R[i]) : PosType(ions.R[i]));
+
+    // n and -n give the same terms
+    for (int n0 = 0; n0 <= kmax; n0++)
+      for (int n1 = -kmax; n1 <= kmax; n1++)
+        for (int n2 = -kmax; n2 <= kmax; n2++)
+          if (n0 > 0 || n1 > 0 || (n1 == 0 && n2 > 0))
+          {
+            KPoints.push_back(PosType(n0, n1, n2));
+            Kcart.push_back(Lattice.k_cart(KPoints.back()));
+          }
+
+    RandomGenerator<T> rng(seed);
+    const int num_k = KPoints.size();
+    Constant.resize(NumOrbitals);
+    CosCoefs.resize(num_k * NumOrbitals);
+    SinCoefs.resize(num_k * NumOrbitals);
+    AtomicCoefs.resize(Centers.size() * Ylm.size() * NumOrbitals);
+    rng.generate_uniform(Constant.data(), Constant.size());
+    rng.generate_uniform(CosCoefs.data(), CosCoefs.size());
+    rng.generate_uniform(SinCoefs.data(), SinCoefs.size());
+    rng.generate_uniform(AtomicCoefs.data(), AtomicCoefs.size());
+    for (int j = 0; j < NumOrbitals; j++)
+      Constant[j] = T(2) * Constant[j] - T(1);
+    // the amplitudes decay with |n|^2
+    for (int k = 0; k < num_k; k++)
+    {
+      const T scale = T(2) / dot(KPoints[k], KPoints[k]);
+      for (int j = 0; j < NumOrbitals; j++)
+      {
+        CosCoefs[k * NumOrbitals + j] = scale * (CosCoefs[k * NumOrbitals + j] - T(0.5));
+        SinCoefs[k * NumOrbitals + j] = scale * (SinCoefs[k * NumOrbitals + j] - T(0.5));
+      }
+    }
+    for (T& c : AtomicCoefs)
+      c = T(4) * c - T(2);
+  }
+
+  inline int size() const { return NumOrbitals; }
+  inline const lattice_type& getLattice() const { return Lattice; }
+  inline const std::vector<PosType>& getCenters() const { return Centers; }
+  /// distance from an ion beyond which its atomic terms are below 1e-6 and ignored
+  inline T getAtomicRadius() const { return T(6) * Sigma; }
+
+  /// minimum image displacement of r from the center c
+  inline PosType getDisplacement(const PosType& r, const PosType& c) const
+  {
+    PosType u = Lattice.toUnit(r - c);
+    for (int d = 0; d < 3; d++)
+      u[d] -= std::round(u[d]);
+    return Lattice.toCart(u);
+  }
+
+  /** evaluate the values of all the orbitals at r
+   * @param atomic if false, the atomic terms are left out
+   */
+  inline void evaluate_v(const PosType& r, T* restrict vals, bool atomic = true) const
+  {
+    const int n     = NumOrbitals;
+    const PosType u = Lattice.toUnit(r);
+    std::copy_n(Constant.data(), n, vals);
+    for (int k = 0; k < KPoints.size(); k++)
+    {
+      const T phase       = TWOPI * dot(KPoints[k], u);
+      const T c           = std::cos(phase);
+      const T s           = std::sin(phase);
+      const T* restrict a = CosCoefs.data() + k * n;
+      const T* restrict b = SinCoefs.data() + k * n;
+#pragma omp simd
+      for (int j = 0; j < n; j++)
+        vals[j] += a[j] * c + b[j] * s;
+    }
+    if (!atomic)
+      return;
+
+    const T radius2 = getAtomicRadius() * getAtomicRadius();
+    T ylm[9];
+    for (int ic = 0; ic < Centers.size(); ic++)
+    {
+      const PosType d = getDisplacement(r, Centers[ic]);
+      const T d2      = dot(d, d);
+      if (d2 >= radius2)
+        continue;
+      const T e = std::exp(-d2 / (2 * Sigma * Sigma));
+      Ylm.evaluate(d[0] / Sigma, d[1] / Sigma, d[2] / Sigma, ylm);
+      for (int lm = 0; lm < Ylm.size(); lm++)
+      {
+        const T w           = e * ylm[lm];
+        const T* restrict c = AtomicCoefs.data() + (ic * Ylm.size() + lm) * n;
+#pragma omp simd
+        for (int j = 0; j < n; j++)
+          vals[j] += w * c[j];
+      }
+    }
+  }
+
+  /** evaluate the values, gradients and Hessians of all the orbitals at r
+   * @param grads x, y and z components, each of size()
+   * @param hess xx, xy, xz, yy, yz and zz components, each of size()
+   */
+  inline void evaluate_vgh(const PosType& r, T* restrict vals, T* restrict grads, T* restrict hess) const
+  {
+    const int n     = NumOrbitals;
+    const PosType u = Lattice.toUnit(r);
+    std::copy_n(Constant.data(), n, vals);
+    std::fill(grads, grads + 3 * n, T(0));
+    std::fill(hess, hess + 6 * n, T(0));
+    for (int k = 0; k < KPoints.size(); k++)
+    {
+      const T phase       = TWOPI * dot(KPoints[k], u);
+      const T c           = std::cos(phase);
+      const T s           = std::sin(phase);
+      const PosType& K    = Kcart[k];
+      const T kk[6]       = {K[0] * K[0], K[0] * K[1], K[0] * K[2], K[1] * K[1], K[1] * K[2], K[2] * K[2]};
+      const T* restrict a = CosCoefs.data() + k * n;
+      const T* restrict b = SinCoefs.data() + k * n;
+      for (int j = 0; j < n; j++)
+      {
+        const T v  = a[j] * c + b[j] * s;
+        const T dv = b[j] * c - a[j] * s;
+        vals[j] += v;
+        for (int d = 0; d < 3; d++)
+          grads[d * n + j] += K[d] * dv;
+        for (int h = 0; h < 6; h++)
+          hess[h * n + j] -= kk[h] * v;
+      }
+    }
+
+    const T radius2 = getAtomicRadius() * getAtomicRadius();
+    T ylm[9], ylm_g[27], ylm_h[54];
+    for (int ic = 0; ic < Centers.size(); ic++)
+    {
+      const PosType d = getDisplacement(r, Centers[ic]);
+      const T d2      = dot(d, d);
+      if (d2 >= radius2)
+        continue;
+      // S(y) exp(-y^2/2) with y = d / sigma
+      const T e       = std::exp(-d2 / (2 * Sigma * Sigma));
+      const PosType y = d / Sigma;
+      const int nlm   = Ylm.size();
+      Ylm.evaluateVGH(y[0], y[1], y[2], ylm, ylm_g, ylm_h);
+      for (int lm = 0; lm < nlm; lm++)
+      {
+        const T s    = ylm[lm];
+        const T g[3] = {ylm_g[lm], ylm_g[nlm + lm], ylm_g[2 * nlm + lm]};
+        T wg[3], wh[6];
+        for (int a = 0; a < 3; a++)
+          wg[a] = (g[a] - s * y[a]) * e / Sigma;
+        for (int a = 0, h = 0; a < 3; a++)
+          for (int b = a; b < 3; b++, h++)
+            wh[h] = (ylm_h[h * nlm + lm] - g[a] * y[b] - y[a] * g[b] + s * (y[a] * y[b] - (a == b ? T(1) : T(0)))) *
+                e / (Sigma * Sigma);
+        const T wv          = s * e;
+        const T* restrict c = AtomicCoefs.data() + (ic * nlm + lm) * n;
+        for (int j = 0; j < n; j++)
+        {
+          vals[j] += wv * c[j];
+          for (int a = 0; a < 3; a++)
+            grads[a * n + j] += wg[a] * c[j];
+          for (int h = 0; h < 6; h++)
+            hess[h * n + j] += wh[h] * c[j];
+        }
+      }
+    }
+  }
+
+private:
+  int NumOrbitals;
+  T Sigma;
+  /// harmonics of the atomic terms
+  SolidHarmonics<T> Ylm;
+  lattice_type Lattice;
+  std::vector<PosType> Centers;
+  /// reciprocal lattice vectors in the reduced and Cartesian units
+  std::vector<PosType> KPoints;
+  std::vector<PosType> Kcart;
+  std::vector<T> Constant;
+  std::vector<T> CosCoefs;
+  std::vector<T> SinCoefs;
+  std::vector<T> AtomicCoefs;
+};
+
+} // namespace qmcplusplus
+#endif
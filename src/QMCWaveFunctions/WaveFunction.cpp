@@ -48,7 +48,10 @@ void build_WaveFunction(bool useRef,
                         ParticleSet& els,
                         const RandomGenerator<QMCTraits::RealType>& RNG,
                         int delay_rank,
-                        bool enableJ3)
+                        QMCTraits::RealType residual_threshold,
+                        bool lazy_laplacians,
+                        bool enableJ3,
+                        int team_size)
 {
   using valT = WaveFunction::valT;
   using posT = WaveFunction::posT;
@@ -59,8 +62,8 @@ void build_WaveFunction(bool useRef,
     return;
   }
 
-  // create a spo view
-  auto spo = build_SPOSet_view(useRef, spo_main, 1, 0);
+  // create a spo view, evaluated by a team of threads if team_size > 1
+  auto spo = build_SPOSet_team_view(useRef, spo_main, team_size);
 
   const int nelup = els.getTotalNum() / 2;
 
@@ -116,9 +119,15 @@ void build_WaveFunction(bool useRef,
     WF.ei_TableID = els.addTable(ions, DT_SOA);
 
     // determinant component
-    WF.nelup  = nelup;
-    WF.Det_up = new DetType(spo, 0, delay_rank);
-    WF.Det_dn = new DetType(spo, nelup, delay_rank);
+    WF.nelup                  = nelup;
+    DetType* det_up           = new DetType(spo, 0, delay_rank);
+    DetType* det_dn           = new DetType(spo, nelup, delay_rank);
+    det_up->setResidualThreshold(residual_threshold);
+    det_dn->setResidualThreshold(residual_threshold);
+    det_up->LazyLaplacians    = lazy_laplacians;
+    det_dn->LazyLaplacians    = lazy_laplacians;
+    WF.Det_up                 = det_up;
+    WF.Det_dn                 = det_dn;
 
     // J1 component
     J1OrbType* J1 = new J1OrbType(ions, els);
@@ -165,6 +174,26 @@ WaveFunction::~WaveFunction()
   }
 }
 
+std::vector<int> WaveFunction::getDelayRanks() const
+{
+  std::vector<int> ranks;
+  for (auto det : {Det_up, Det_dn})
+    if (auto ref_det = dynamic_cast<miniqmcreference::DiracDeterminantRef<>*>(det))
+      ranks.push_back(ref_det->getDelayRank());
+    else if (auto opt_det = dynamic_cast<DiracDeterminant<>*>(det))
+      ranks.push_back(opt_det->getDelayRank());
+  return ranks;
+}
+
+int WaveFunction::getNumReinversions() const
+{
+  int count = 0;
+  for (auto det : {Det_up, Det_dn})
+    if (auto opt_det = dynamic_cast<DiracDeterminant<>*>(det))
+      count += opt_det->NumReinversions;
+  return count;
+}
+
 void WaveFunction::setupTimers()
 {
   setup_timers(timers, WaveFunctionTimerNames);
@@ -258,6 +287,14 @@ void WaveFunction::completeUpdates()
 
 void WaveFunction::restore(int iat) {}
 
+void WaveFunction::prefetch(const ParticleSet& P, int iat, const posT& r)
+{
+  if (iat < nelup)
+    Det_up->prefetch(P, iat, r);
+  else
+    Det_dn->prefetch(P, iat, r);
+}
+
 void WaveFunction::evaluateGL(ParticleSet& P)
 {
   ScopedTimer local_timer(timers[Timer_GL]);
@@ -68,6 +68,8 @@ public:
   void restore(int iat);
   void completeUpdates();
   void evaluateGL(ParticleSet& P);
+  /// hint that iat-th particle will be moved to r, see WaveFunctionComponent::prefetch
+  void prefetch(const ParticleSet& P, int iat, const posT& r);
 
   /** compulte multiple ratios to handle non-local moves and other virtual moves
    */
@@ -98,6 +100,10 @@ public:
   // others
   int get_ei_TableID() const { return ei_TableID; }
   valT getLogValue() const { return LogValue; }
+  /// delay ranks of the determinants in use, see DelayedUpdate::getDelayRank
+  std::vector<int> getDelayRanks() const;
+  /// inversions anew of the determinants after a failed residual check, see DiracDeterminant::checkResidual
+  int getNumReinversions() const;
   void setupTimers();
 
   // friends
@@ -108,7 +114,10 @@ public:
                                  ParticleSet& els,
                                  const RandomGenerator<QMCTraits::RealType>& RNG,
                                  int delay_rank,
-                                 bool enableJ3);
+                                 QMCTraits::RealType residual_threshold,
+                                 bool lazy_laplacians,
+                                 bool enableJ3,
+                                 int team_size);
   const std::vector<WaveFunctionComponent*>
       extract_up_list(const std::vector<WaveFunction*>& WF_list) const;
   const std::vector<WaveFunctionComponent*>
@@ -124,7 +133,10 @@ void build_WaveFunction(bool useRef,
                         ParticleSet& els,
                         const RandomGenerator<QMCTraits::RealType>& RNG,
                         int delay_rank,
-                        bool enableJ3);
+                        QMCTraits::RealType residual_threshold,
+                        bool lazy_laplacians,
+                        bool enableJ3,
+                        int team_size);
 } // namespace qmcplusplus
 
 #endif
@@ -70,7 +70,8 @@ struct WaveFunctionComponent : public QMCTraits
     ORB_PBYP_ALL,     /*!< particle-by-particle, update Value-Gradient-Laplacian */
     ORB_PBYP_PARTIAL, /*!< particle-by-particle, update Value and Grdient */
     ORB_WALKER,       /*!< walker update */
-    ORB_ALLWALKER     /*!< all walkers update */
+    ORB_ALLWALKER,    /*!< all walkers update */
+    ORB_PBYP_FUSED    /*!< particle-by-particle, Value-Gradient-Laplacian held by the SPOSet */
   };
 
   typedef ParticleAttrib<ValueType> ValueVectorType;
@@ -174,6 +175,13 @@ struct WaveFunctionComponent : public QMCTraits
    */
   virtual void completeUpdates(){};
 
+  /** hint that iat-th particle will be moved to r, to fetch the data of the move ahead of time
+   * @param P target ParticleSet
+   * @param iat index of the particle to be moved
+   * @param r the proposed position
+   */
+  virtual void prefetch(const ParticleSet& P, int iat, const PosType& r) {}
+
   /** evaluate ratios to evaluate the non-local PP
    * @param VP VirtualParticleSet
    * @param ratios ratios with new positions VP.R[k] the VP.refPtcl
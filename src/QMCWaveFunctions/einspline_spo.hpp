@@ -24,10 +24,20 @@
 #include <Particle/ParticleSet.h>
 #include <Numerics/Spline2/BsplineAllocator.hpp>
 #include <Numerics/Spline2/MultiBspline.hpp>
+#include <Numerics/Spline2/MultiBsplineSIMD.h>
+#include <Numerics/Spline2/bspline_half.hpp>
+#include <Numerics/Spline2/BsplineInterpolation.hpp>
+#include <Numerics/Spline2/MultiBsplineFile.hpp>
+#include <Numerics/Spline2/PagedMultiBsplines.hpp>
 #include <Utilities/SIMD/allocator.hpp>
+#include <Utilities/SIMD/HugePageAllocator.hpp>
+#include <Utilities/NumaTools.h>
+#include <Utilities/MemberPool.h>
 #include "Numerics/OhmmsPETE/OhmmsArray.h"
 #include "QMCWaveFunctions/SPOSet.h"
+#include <cstring>
 #include <iostream>
+#include <memory>
 
 namespace qmcplusplus
 {
@@ -36,10 +46,15 @@ struct einspline_spo : public SPOSet
 {
   /// define the einsplie data object type
   using spline_type     = typename bspline_traits<T, 3>::SplineType;
+  using fp16_spline_type = typename bspline_traits<spline2::fp16, 3>::SplineType;
+  using bf16_spline_type = typename bspline_traits<spline2::bf16, 3>::SplineType;
   using vContainer_type = aligned_vector<T>;
   using gContainer_type = VectorSoAContainer<T, 3>;
   using hContainer_type = VectorSoAContainer<T, 6>;
   using lattice_type    = CrystalLattice<T, 3>;
+  /// allocator of the coefficients, backed by huge pages if enabled for HugePageCategory::SPLINE
+  template<typename ST>
+  using coef_allocator = BsplineAllocator<ST, QMC_CLINE, HugePageAllocator<ST, QMC_CLINE, HugePageCategory::SPLINE>>;
 
   /// number of blocks
   int nBlocks;
@@ -54,20 +69,76 @@ struct einspline_spo : public SPOSet
   /// if true, responsible for cleaning up einsplines
   bool Owner;
   lattice_type Lattice;
+  /// storage type of the coefficients
+  spline2::SplineStorage Storage;
+  /// if true, only half of the grid is stored using the inversion symmetry of the orbitals
+  bool Inversion;
   /// use allocator
-  BsplineAllocator<T> myAllocator;
+  coef_allocator<T> myAllocator;
+  coef_allocator<spline2::fp16> myAllocatorFP16;
+  coef_allocator<spline2::bf16> myAllocatorBF16;
 
   aligned_vector<spline_type*> einsplines;
+  /// einsplines with 16-bit coefficients, only the one matching Storage is used
+  aligned_vector<fp16_spline_type*> einsplines_fp16;
+  aligned_vector<bf16_spline_type*> einsplines_bf16;
+  /// mapped coefficient file, the einsplines point into it if not null
+  std::unique_ptr<spline2::MappedMultiBsplines> Mapped;
+  /// paged coefficient file shared with the views, the einsplines have no coefficients if not null
+  std::shared_ptr<spline2::PagedMultiBsplines<spline_type>> Paged;
+  /// coefficient rows of the last paged evaluation of this object
+  spline2::MultiBsplineWindow<spline_type> Window;
+  /// copies of the coefficients indexed by NUMA domain, the views use the local one if any
+  std::vector<std::unique_ptr<einspline_spo>> Replicas;
   aligned_vector<vContainer_type> psi;
   aligned_vector<gContainer_type> grad;
   aligned_vector<hContainer_type> hess;
+  /// laplacians of the blocks evaluated alone by evaluate_l_blocks
+  aligned_vector<vContainer_type> lapl;
+  /// views of the blocks evaluated by each member of a team, empty without a team
+  std::vector<std::unique_ptr<einspline_spo>> TeamMembers;
+  /// threads running the members, created with the team
+  std::unique_ptr<MemberPool> Team;
+  /// partial ratio and gradient contractions of each member
+  std::vector<TinyVector<T, 4>> MemberSums;
+  /// partial ratios of the virtual moves of each member, num_pos per member
+  std::vector<T> MemberRatios;
+  /// unit coordinates of the prefetch posted to the members
+  TinyVector<T, 3> PrefetchU;
+  /// the same blocks on a coarser grid for the ratios of the virtual moves, see setCoarse
+  std::unique_ptr<einspline_spo> Coarse;
 
+  /// grid cells [lo, hi) of a block, its orbitals vanish outside
+  struct BlockSupport
+  {
+    TinyVector<int, 3> lo;
+    TinyVector<int, 3> hi;
+  };
+  /// supports of the blocks, empty if the orbitals are not localized
+  std::vector<BlockSupport> Supports;
+  /// number of grid cells in each direction, to locate a position in the supports
+  TinyVector<int, 3> SupportGrid;
+  /// 1 if the block was evaluated at the last position, 0 if skipped and its outputs are zero
+  std::vector<char> Active;
+  /// unit coordinates of the last evaluateRatioGrad, its hessians are only evaluated by copyLastVGL
+  TinyVector<T, 3> LastU;
+  /// scratch of the batched evaluations of multi_evaluate and ratios_blocks
+  MultiBsplineEval::MultiBsplineScratch<T> BatchScratch;
+  /// walkers and output blocks of a multi_evaluate, reused across calls
+  std::vector<einspline_spo*> BatchSPOs;
+  std::vector<T*> BatchVals, BatchGrads, BatchHess;
+  /// unit coordinates of a multi_evaluate or of the positions of ratios_blocks
+  std::vector<T> BatchX, BatchY, BatchZ;
+  /// unit coordinates of the virtual moves of evaluateDetRatios, reused across calls
+  std::vector<TinyVector<T, 3>> RatioU;
 
   /// Timer
   NewTimer* timer;
 
   /// default constructor
-  einspline_spo() : nBlocks(0), nSplines(0), firstBlock(0), lastBlock(0), Owner(false)
+  einspline_spo()
+      : nBlocks(0), nSplines(0), firstBlock(0), lastBlock(0), Owner(false), Storage(spline2::SplineStorage::FULL),
+        Inversion(false)
   {
     timer = TimerManager.createTimer("Single-Particle Orbitals", timer_level_fine);
   }
@@ -82,19 +153,36 @@ struct einspline_spo : public SPOSet
    * @param member_id id of this member in a team
    *
    * Create a view of the big object. A simple blocking & padding  method.
+   * When \p in is replicated, the view uses the replica of the NUMA domain of the calling thread.
    */
-  einspline_spo(const einspline_spo& in, int team_size, int member_id) : Owner(false), Lattice(in.Lattice)
+  einspline_spo(const einspline_spo& in_main, int team_size, int member_id)
+      : Owner(false), Lattice(in_main.Lattice), Storage(in_main.Storage), Inversion(in_main.Inversion),
+        SupportGrid(in_main.SupportGrid), Paged(in_main.Paged)
   {
+    const einspline_spo& in = in_main.getLocalReplica();
     OrbitalSetSize   = in.OrbitalSetSize;
     nSplines         = in.nSplines;
     nSplinesPerBlock = in.nSplinesPerBlock;
     nBlocks          = (in.nBlocks + team_size - 1) / team_size;
-    firstBlock       = nBlocks * member_id;
-    lastBlock        = std::min(in.nBlocks, nBlocks * (member_id + 1));
-    nBlocks          = lastBlock - firstBlock;
+    // the blocks of the view relative to in
+    const int first  = nBlocks * member_id;
+    const int last   = std::min(in.nBlocks, nBlocks * (member_id + 1));
+    nBlocks          = last - first;
+    firstBlock       = in.firstBlock + first;
+    lastBlock        = in.firstBlock + last;
     einsplines.resize(nBlocks);
-    for (int i = 0, t = firstBlock; i < nBlocks; ++i, ++t)
-      einsplines[i] = in.einsplines[t];
+    einsplines_fp16.resize(nBlocks);
+    einsplines_bf16.resize(nBlocks);
+    for (int i = 0, t = first; i < nBlocks; ++i, ++t)
+    {
+      einsplines[i]      = in.einsplines[t];
+      einsplines_fp16[i] = in.einsplines_fp16[t];
+      einsplines_bf16[i] = in.einsplines_bf16[t];
+    }
+    if (!in.Supports.empty())
+      Supports.assign(in.Supports.begin() + first, in.Supports.begin() + last);
+    if (in_main.Coarse)
+      Coarse.reset(new einspline_spo(*in_main.Coarse, team_size, member_id));
     resize();
     timer = TimerManager.createTimer("Single-Particle Orbitals", timer_level_fine);
   }
@@ -102,9 +190,23 @@ struct einspline_spo : public SPOSet
   /// destructors
   ~einspline_spo()
   {
-    if (Owner)
+    if (Owner && Mapped)
+      for (int i = 0; i < nBlocks; ++i)
+      {
+        Mapped->destroy(einsplines[i]);
+        Mapped->destroy(einsplines_fp16[i]);
+        Mapped->destroy(einsplines_bf16[i]);
+      }
+    else if (Owner && !Paged) // the paged einsplines belong to Paged
       for (int i = 0; i < nBlocks; ++i)
-        myAllocator.destroy(einsplines[i]);
+      {
+        if (einsplines[i])
+          myAllocator.destroy(einsplines[i]);
+        if (einsplines_fp16[i])
+          myAllocatorFP16.destroy(einsplines_fp16[i]);
+        if (einsplines_bf16[i])
+          myAllocatorBF16.destroy(einsplines_bf16[i]);
+      }
   }
 
   /// resize the containers
@@ -113,71 +215,622 @@ struct einspline_spo : public SPOSet
     psi.resize(nBlocks);
     grad.resize(nBlocks);
     hess.resize(nBlocks);
+    lapl.resize(nBlocks);
     for (int i = 0; i < nBlocks; ++i)
     {
       psi[i].resize(nSplinesPerBlock);
       grad[i].resize(nSplinesPerBlock);
       hess[i].resize(nSplinesPerBlock);
+      lapl[i].resize(nSplinesPerBlock);
     }
+    Active.assign(nBlocks, 1);
   }
 
   /// If not initialized previously, generate splines coeficients of \p num_splines
   /// divided into \p nblocks chunks each with a grid \p nx x \p ny x \p nz.
   /// If \p init_random is true, in each chunk, one orbital is fully randomized
   /// and others are tweaked based on it.
-  void set(int nx, int ny, int nz, int num_splines, int nblocks, bool init_random = true)
+  /// With a 16-bit \p storage, each chunk is converted once generated.
+  /// With a positive \p brick_shift, the coefficients are stored in bricks of 2^brick_shift grid points.
+  /// With \p inversion, the orbitals of a chunk are even or odd under inversion, see getInversionParity,
+  /// and only half of the grid is stored.
+  /// Only the chunks [\p first_block, \p last_block) are stored, all of them if \p last_block is negative.
+  /// They are the same as those of an object storing all the chunks.
+  void set(int nx,
+           int ny,
+           int nz,
+           int num_splines,
+           int nblocks,
+           bool init_random               = true,
+           spline2::SplineStorage storage = spline2::SplineStorage::FULL,
+           int brick_shift                = 0,
+           bool inversion                 = false,
+           int first_block                = 0,
+           int last_block                 = -1)
   {
     // setting OrbitalSetSize to num_splines made artificial only in miniQMC
     OrbitalSetSize = num_splines;
 
     nSplines         = num_splines;
-    nBlocks          = nblocks;
     nSplinesPerBlock = num_splines / nblocks;
-    firstBlock       = 0;
-    lastBlock        = nBlocks;
+    firstBlock       = first_block;
+    lastBlock        = last_block < 0 ? nblocks : last_block;
+    nBlocks          = lastBlock - firstBlock;
     if (einsplines.empty())
     {
-      Owner = true;
+      Owner     = true;
+      Storage   = storage;
+      Inversion = inversion;
       TinyVector<int, 3> ng(nx, ny, nz);
       PosType start(0);
       PosType end(1);
-      einsplines.resize(nBlocks);
+      einsplines.resize(nBlocks, nullptr);
+      einsplines_fp16.resize(nBlocks, nullptr);
+      einsplines_bf16.resize(nBlocks, nullptr);
       RandomGenerator<T> myrandom(11);
       Array<T, 3> coef_data(nx + 3, ny + 3, nz + 3);
-      for (int i = 0; i < nBlocks; ++i)
+      for (int t = 0; t < nblocks; ++t)
       {
-        einsplines[i] = myAllocator.createMultiBspline(T(0), start, end, ng, PERIODIC, nSplinesPerBlock);
+        // the random coefficients of the chunks not stored are drawn all the same
+        if (t < firstBlock || t >= lastBlock)
+        {
+          if (init_random)
+            myrandom.generate_uniform(coef_data.data(), coef_data.size());
+          continue;
+        }
+        const int i      = t - firstBlock;
+        const int parity = Inversion ? getInversionParity(t) : 0;
+        einsplines[i] =
+            myAllocator.createMultiBspline(T(0), start, end, ng, PERIODIC, nSplinesPerBlock, brick_shift, parity);
         if (init_random)
         {
           // Generate a orbital fully with fully randomized coefficients
           myrandom.generate_uniform(coef_data.data(), coef_data.size());
+          if (parity)
+            spline2::makeInversionSymmetric(coef_data, parity);
           // Generate different coefficients for each orbital by tweaking coef_data
           myAllocator.setCoefficientsForOrbitals(0, nSplinesPerBlock, coef_data, einsplines[i]);
         }
+        if (Storage != spline2::SplineStorage::FULL)
+        {
+          if (Storage == spline2::SplineStorage::FP16)
+            einsplines_fp16[i] = myAllocatorFP16.createConvertedMultiBspline(einsplines[i]);
+          else
+            einsplines_bf16[i] = myAllocatorBF16.createConvertedMultiBspline(einsplines[i]);
+          myAllocator.destroy(einsplines[i]);
+          einsplines[i] = nullptr;
+        }
       }
     }
     resize();
   }
 
+  /// parity under inversion of the orbitals of the i-th block, even and odd blocks alternate
+  static int getInversionParity(int i) { return i % 2 ? -1 : 1; }
+
+  /** localize the orbitals of each block in a box
+   * @param support edge of the boxes relative to the cell, the orbitals are not localized if not in (0,1)
+   *
+   * The boxes are spread randomly over the cell. The coefficients outside a box are cleared so that
+   * skipping a block at the positions outside its box is exact, except for mapped coefficients which
+   * are expected to be saved after localization.
+   */
+  void localize(T support)
+  {
+    Supports.clear();
+    Active.assign(nBlocks, 1);
+    if (support <= T(0) || support >= T(1) || nBlocks == 0)
+      return;
+    if (Inversion)
+      throw std::runtime_error("Localized orbitals are not symmetric under inversion");
+
+    SupportGrid = getGridNum();
+    RandomGenerator<T> myrandom(13);
+    Supports.resize(nBlocks);
+    for (int i = 0; i < nBlocks; ++i)
+    {
+      BlockSupport& box = Supports[i];
+      for (int d = 0; d < 3; d++)
+      {
+        // at least one cell with nonzero coefficients
+        const int n     = SupportGrid[d];
+        const int width = std::min(n, std::max(4, static_cast<int>(support * n + T(0.5))));
+        T center;
+        myrandom.generate_uniform(&center, 1);
+        box.lo[d] = std::min(std::max(static_cast<int>(center * n) - width / 2, 0), n - width);
+        box.hi[d] = box.lo[d] + width;
+      }
+      if (!Mapped && !Paged)
+      {
+        if (einsplines[i])
+          clearOutsideSupport(einsplines[i], box);
+        if (einsplines_fp16[i])
+          clearOutsideSupport(einsplines_fp16[i], box);
+        if (einsplines_bf16[i])
+          clearOutsideSupport(einsplines_bf16[i], box);
+      }
+    }
+  }
+
+  template<typename SplineType>
+  static TinyVector<int, 3> getGridNum(const SplineType* spline)
+  {
+    return TinyVector<int, 3>(spline->x_grid.num, spline->y_grid.num, spline->z_grid.num);
+  }
+
+  /// number of grid points in each direction of the blocks
+  TinyVector<int, 3> getGridNum() const
+  {
+    switch (Storage)
+    {
+    case spline2::SplineStorage::FP16:
+      return getGridNum(einsplines_fp16[0]);
+    case spline2::SplineStorage::BF16:
+      return getGridNum(einsplines_bf16[0]);
+    default:
+      return getGridNum(einsplines[0]);
+    }
+  }
+
+  /** replace the coefficients by those of the splines interpolating values at the grid points
+   * @param values the nBlocks*nSplinesPerBlock orbitals of the grid point (ix,iy,iz) start at
+   *        ((ix*ny+iy)*nz+iz)*nBlocks*nSplinesPerBlock, overwritten
+   *
+   * Only for the full precision coefficients in memory, without inversion symmetry.
+   */
+  void interpolate(std::vector<T>& values)
+  {
+    const TinyVector<int, 3> ng = getGridNum(einsplines[0]);
+    const int width             = nBlocks * nSplinesPerBlock;
+    spline2::solveCubicBsplineGrid(values.data(), ng[0], ng[1], ng[2], width);
+
+    // the periodic coefficient i is the one of the grid point i-1
+    for (int i = 0; i < nBlocks; i++)
+    {
+      spline_type* spline = einsplines[i];
+#pragma omp parallel for
+      for (int jx = 0; jx < ng[0] + 3; jx++)
+        for (int jy = 0; jy < ng[1] + 3; jy++)
+          for (int jz = 0; jz < ng[2] + 3; jz++)
+          {
+            const int ix    = (jx + ng[0] - 1) % ng[0];
+            const int iy    = (jy + ng[1] - 1) % ng[1];
+            const int iz    = (jz + ng[2] - 1) % ng[2];
+            T* restrict row = spline->coefs + spline2::getRowOffset(spline, jx, jy, jz);
+            std::fill(row, row + spline->z_stride, T(0));
+            std::copy_n(values.data() + ((ix * ng[1] + iy) * ng[2] + iz) * width + i * nSplinesPerBlock,
+                        nSplinesPerBlock, row);
+          }
+    }
+  }
+
+  /** build the companion of the ratios of the virtual moves on a coarser grid
+   * @param fraction grid points of the companion relative to the blocks in each direction,
+   *        no companion if not in (0,1)
+   *
+   * The quadratures of the nonlocal pseudopotentials tolerate a larger interpolation error
+   * than the drift moves. The orbitals of this object are sampled at the points of the coarse
+   * grid and interpolated there by full precision splines, which are not localized. The views
+   * created afterwards evaluate evaluateDetRatios with their blocks of the companion.
+   */
+  void setCoarse(T fraction)
+  {
+    Coarse.reset();
+    if (fraction <= T(0) || fraction >= T(1) || nBlocks == 0)
+      return;
+    const TinyVector<int, 3> fine = getGridNum();
+    TinyVector<int, 3> ng;
+    for (int d = 0; d < 3; d++)
+      ng[d] = std::max(4, static_cast<int>(fine[d] * fraction + T(0.5)));
+
+    std::unique_ptr<einspline_spo> coarse(new einspline_spo);
+    coarse->set(ng[0], ng[1], ng[2], nSplines, nSplines / nSplinesPerBlock, false, spline2::SplineStorage::FULL, 0,
+                false, firstBlock, lastBlock);
+    coarse->Lattice = Lattice;
+
+    const int width = nBlocks * nSplinesPerBlock;
+    std::vector<T> values(static_cast<size_t>(ng[0]) * ng[1] * ng[2] * width);
+#pragma omp parallel
+    {
+      einspline_spo view(*this, 1, 0);
+#pragma omp for
+      for (int ix = 0; ix < ng[0]; ix++)
+        for (int iy = 0; iy < ng[1]; iy++)
+          for (int iz = 0; iz < ng[2]; iz++)
+          {
+            view.evaluate_v_blocks(TinyVector<T, 3>(T(ix) / ng[0], T(iy) / ng[1], T(iz) / ng[2]));
+            T* restrict point = values.data() + ((ix * ng[1] + iy) * ng[2] + iz) * width;
+            for (int i = 0; i < nBlocks; ++i)
+              std::copy_n(view.psi[i].data(), nSplinesPerBlock, point + i * nSplinesPerBlock);
+          }
+    }
+    coarse->interpolate(values);
+    Coarse = std::move(coarse);
+  }
+
+  /** clear the coefficients of a spline which contribute to the cells outside box
+   *
+   * A cell ix is evaluated with the coefficients ix..ix+3, keeping only the coefficients
+   * [lo+3, hi) leaves the orbitals nonzero only in the cells [lo, hi).
+   */
+  template<typename SplineType>
+  static void clearOutsideSupport(SplineType* spline, const BlockSupport& box)
+  {
+    using coef_type = typename bspline_type<SplineType>::value_type;
+    const TinyVector<int, 3> n = getGridNum(spline);
+    for (int ix = 0; ix < n[0] + 3; ix++)
+      for (int iy = 0; iy < n[1] + 3; iy++)
+        for (int iz = 0; iz < n[2] + 3; iz++)
+          if (ix < box.lo[0] + 3 || ix >= box.hi[0] || iy < box.lo[1] + 3 || iy >= box.hi[1] ||
+              iz < box.lo[2] + 3 || iz >= box.hi[2])
+            std::memset(spline->coefs + spline2::getRowOffset(spline, ix, iy, iz), 0,
+                        spline->z_stride * sizeof(coef_type));
+  }
+
+  /// true if the unit coordinates u are in the support of the block i
+  inline bool inSupport(int i, const TinyVector<T, 3>& u) const
+  {
+    const BlockSupport& box = Supports[i];
+    bool inside             = true;
+    for (int d = 0; d < 3; d++)
+    {
+      const int cell = static_cast<int>(u[d] * SupportGrid[d]);
+      inside         = inside && cell >= box.lo[d] && cell < box.hi[d];
+    }
+    return inside;
+  }
+
+  /** true if the block i has to be evaluated at the unit coordinates u
+   *
+   * The outputs of a block skipped outside its support are cleared once.
+   */
+  inline bool activateBlock(int i, const TinyVector<T, 3>& u)
+  {
+    if (Supports.empty())
+      return true;
+    const bool inside = inSupport(i, u);
+    if (!inside && Active[i])
+    {
+      std::fill(psi[i].begin(), psi[i].end(), T(0));
+      grad[i] = T(0);
+      hess[i] = T(0);
+      std::fill(lapl[i].begin(), lapl[i].end(), T(0));
+    }
+    Active[i] = inside;
+    return inside;
+  }
+
+  /** split the blocks of this view over a team of threads sharing a walker
+   * @param team_size maximum number of members
+   *
+   * Each member evaluates its own blocks and writes its range of the SPO vectors. The members
+   * run on a MemberPool created here, the calling thread of an evaluation is the first member.
+   */
+  void createTeam(int team_size)
+  {
+    Team.reset();
+    TeamMembers.clear();
+    const int blocks_per_member = (nBlocks + team_size - 1) / team_size;
+    const int num_members       = blocks_per_member > 0 ? (nBlocks + blocks_per_member - 1) / blocks_per_member : 0;
+    if (num_members < 2)
+      return;
+    for (int m = 0; m < num_members; m++)
+      TeamMembers.emplace_back(new einspline_spo(*this, num_members, m));
+    MemberSums.resize(num_members);
+    Team.reset(new MemberPool(num_members));
+  }
+
+  /// run f(member) for all the members of the team
+  template<typename F>
+  inline void runTeam(const F& f)
+  {
+    Team->run([&](int m) { f(*TeamMembers[m], m); });
+  }
+
+  /// the replica on the NUMA domain of the calling thread, this object if not replicated
+  const einspline_spo& getLocalReplica() const
+  {
+    const int node = getCurrentNumaDomain();
+    if (node < static_cast<int>(Replicas.size()) && Replicas[node])
+      return *Replicas[node];
+    return *this;
+  }
+
+  /** place the coefficients according to a NUMA policy
+   * @param policy INTERLEAVE spreads the pages over all the domains,
+   *        REPLICATE makes a copy bound to each domain
+   * @return number of NUMA domains
+   *
+   * With REPLICATE, the coefficients of this object serve the first domain unless mapped from a file.
+   */
+  int applyNumaPolicy(NumaPolicy policy)
+  {
+    const std::vector<int> nodes = getNumaDomains();
+    // the cached bricks are allocated on use
+    if (Paged)
+      return nodes.size();
+    if (policy == NumaPolicy::INTERLEAVE)
+    {
+      placeSplines(einsplines, -1);
+      placeSplines(einsplines_fp16, -1);
+      placeSplines(einsplines_bf16, -1);
+    }
+    else if (policy == NumaPolicy::REPLICATE && nodes.size() > 1)
+    {
+      Replicas.resize(nodes.back() + 1);
+      for (int node : nodes)
+      {
+        if (node == nodes[0] && !Mapped)
+        {
+          placeSplines(einsplines, node);
+          placeSplines(einsplines_fp16, node);
+          placeSplines(einsplines_bf16, node);
+          continue;
+        }
+        einspline_spo* replica    = new einspline_spo;
+        replica->Owner            = true;
+        replica->Storage          = Storage;
+        replica->Inversion        = Inversion;
+        replica->Lattice          = Lattice;
+        replica->OrbitalSetSize   = OrbitalSetSize;
+        replica->nSplines         = nSplines;
+        replica->nBlocks          = nBlocks;
+        replica->nSplinesPerBlock = nSplinesPerBlock;
+        replica->firstBlock       = firstBlock;
+        replica->lastBlock        = lastBlock;
+        replica->Supports         = Supports;
+        replica->SupportGrid      = SupportGrid;
+        replica->einsplines.assign(nBlocks, nullptr);
+        replica->einsplines_fp16.assign(nBlocks, nullptr);
+        replica->einsplines_bf16.assign(nBlocks, nullptr);
+        for (int i = 0; i < nBlocks; ++i)
+          if (Storage == spline2::SplineStorage::FP16)
+            replica->einsplines_fp16[i] = myAllocatorFP16.createConvertedMultiBspline(einsplines_fp16[i], node);
+          else if (Storage == spline2::SplineStorage::BF16)
+            replica->einsplines_bf16[i] = myAllocatorBF16.createConvertedMultiBspline(einsplines_bf16[i], node);
+          else
+            replica->einsplines[i] = myAllocator.createConvertedMultiBspline(einsplines[i], node);
+        replica->resize();
+        Replicas[node].reset(replica);
+      }
+    }
+    return nodes.size();
+  }
+
+  /// migrate the coefficients to a NUMA domain, interleave them if \p node is negative
+  template<typename SplineType>
+  static void placeSplines(const aligned_vector<SplineType*>& splines, int node)
+  {
+    using coef_type = typename bspline_type<SplineType>::value_type;
+    for (SplineType* spline : splines)
+      if (spline)
+      {
+        const size_t bytes = spline->coefs_size * sizeof(coef_type);
+        if (node < 0)
+          interleaveMemory(spline->coefs, bytes, true);
+        else
+          bindMemoryToNumaDomain(spline->coefs, bytes, node, true);
+      }
+  }
+
+  /** map the coefficients from a file written by save
+   * @return false if the file does not exist
+   *
+   * Throws if the file does not hold the splines requested by the arguments of set.
+   */
+  bool load(const std::string& fname,
+            int nx,
+            int ny,
+            int nz,
+            int num_splines,
+            int nblocks,
+            spline2::SplineStorage storage = spline2::SplineStorage::FULL,
+            int brick_shift                = 0,
+            bool inversion                 = false)
+  {
+    std::unique_ptr<spline2::MappedMultiBsplines> mapped(new spline2::MappedMultiBsplines);
+    if (!mapped->open(fname))
+      return false;
+    const spline2::MultiBsplineFileHeader& header = mapped->header;
+    if (mapped->getStorage() != storage || header.num_blocks != nblocks ||
+        header.num_splines != num_splines / nblocks || header.grid_num[0] != nx || header.grid_num[1] != ny ||
+        header.grid_num[2] != nz || header.brick_shift != brick_shift ||
+        header.inversion != inversion)
+      throw std::runtime_error("The spline coefficient file " + fname + " does not match the requested splines");
+
+    Owner     = true;
+    Storage   = storage;
+    Inversion = inversion;
+    einsplines.assign(nblocks, nullptr);
+    einsplines_fp16.assign(nblocks, nullptr);
+    einsplines_bf16.assign(nblocks, nullptr);
+    for (int i = 0; i < nblocks; ++i)
+      if (Storage == spline2::SplineStorage::FP16)
+        einsplines_fp16[i] = mapped->createMultiBspline<fp16_spline_type>(i);
+      else if (Storage == spline2::SplineStorage::BF16)
+        einsplines_bf16[i] = mapped->createMultiBspline<bf16_spline_type>(i);
+      else
+        einsplines[i] = mapped->createMultiBspline<spline_type>(i);
+    Mapped = std::move(mapped);
+    set(nx, ny, nz, num_splines, nblocks, false, storage, brick_shift, inversion);
+    return true;
+  }
+
+  /** read the full precision coefficients from a file written by save on demand
+   * @param cache_bytes bound of the memory of the bricks cached by all the views
+   * @return false if the file does not exist
+   *
+   * The file must hold the splines requested by the other arguments, in the brick layout.
+   * Each evaluation gathers the rows of its stencil from the cache, see PagedMultiBsplines.
+   */
+  bool page(const std::string& fname,
+            int nx,
+            int ny,
+            int nz,
+            int num_splines,
+            int nblocks,
+            int brick_shift,
+            bool inversion,
+            size_t cache_bytes)
+  {
+    std::shared_ptr<spline2::PagedMultiBsplines<spline_type>> paged(new spline2::PagedMultiBsplines<spline_type>);
+    if (!paged->open(fname, cache_bytes))
+      return false;
+    const spline2::MultiBsplineFileHeader& header = paged->header;
+    if (header.storage != static_cast<uint32_t>(spline2::SplineStorage::FULL) || header.num_blocks != nblocks ||
+        header.num_splines != num_splines / nblocks || header.grid_num[0] != nx || header.grid_num[1] != ny ||
+        header.grid_num[2] != nz || header.brick_shift != brick_shift || header.inversion != inversion)
+      throw std::runtime_error("The spline coefficient file " + fname + " does not match the requested splines");
+
+    Owner     = true;
+    Storage   = spline2::SplineStorage::FULL;
+    Inversion = inversion;
+    einsplines.assign(nblocks, nullptr);
+    einsplines_fp16.assign(nblocks, nullptr);
+    einsplines_bf16.assign(nblocks, nullptr);
+    for (int i = 0; i < nblocks; ++i)
+      einsplines[i] = paged->getMultiBspline(i);
+    Paged = paged;
+    set(nx, ny, nz, num_splines, nblocks, false, Storage, brick_shift, inversion);
+    return true;
+  }
+
+  /// full precision spline of the i-th block to evaluate at (x,y,z), gathered from the cache if paged
+  inline const spline_type* getBlockSpline(int i, T x, T y, T z)
+  {
+    if (!Paged)
+      return einsplines[i];
+    Paged->gather(firstBlock + i, x, y, z, Window);
+    return &Window.spline;
+  }
+
+  /// write the coefficients to a file to be mapped by load
+  void save(const std::string& fname) const
+  {
+    if (Storage == spline2::SplineStorage::FP16)
+      spline2::writeMultiBsplines(fname, einsplines_fp16.data(), nBlocks, Storage);
+    else if (Storage == spline2::SplineStorage::BF16)
+      spline2::writeMultiBsplines(fname, einsplines_bf16.data(), nBlocks, Storage);
+    else
+      spline2::writeMultiBsplines(fname, einsplines.data(), nBlocks, Storage);
+  }
+
+  /** prefetch the coefficients of all the blocks for an evaluation at r
+   *
+   * With a team, each member brings its blocks to its own cache right away, the caller
+   * does not wait for the other members.
+   */
+  void prefetch(const PosType& r) override
+  {
+    if (!TeamMembers.empty())
+    {
+      Team->wait();
+      PrefetchU = Lattice.toUnit_floor(r);
+      Team->post([this](int m) { TeamMembers[m]->prefetch_blocks(PrefetchU); });
+      TeamMembers[0]->prefetch_blocks(PrefetchU);
+      return;
+    }
+    prefetch_blocks(Lattice.toUnit_floor(r));
+  }
+
+  /// prefetch the coefficients of the blocks owned by this object at the unit coordinates u
+  inline void prefetch_blocks(const TinyVector<T, 3>& u)
+  {
+    // the paged coefficients are not resident
+    if (Paged)
+      return;
+    for (int i = 0; i < nBlocks; ++i)
+    {
+      if (!Supports.empty() && !inSupport(i, u))
+        continue;
+      switch (Storage)
+      {
+      case spline2::SplineStorage::FP16:
+        MultiBsplineEval::prefetch(einsplines_fp16[i], u[0], u[1], u[2], nSplinesPerBlock);
+        break;
+      case spline2::SplineStorage::BF16:
+        MultiBsplineEval::prefetch(einsplines_bf16[i], u[0], u[1], u[2], nSplinesPerBlock);
+        break;
+      default:
+        MultiBsplineEval::prefetch(einsplines[i], u[0], u[1], u[2], nSplinesPerBlock);
+      }
+    }
+  }
+
   /** evaluate psi */
   inline void evaluate_v(const ParticleSet& P, int iat)
   {
     ScopedTimer local_timer(timer);
 
     auto u = Lattice.toUnit_floor(P.activeR(iat));
+    evaluate_v_blocks(u);
+  }
+
+  /// evaluate psi at the unit coordinates u
+  inline void evaluate_v_blocks(const TinyVector<T, 3>& u)
+  {
+    switch (Storage)
+    {
+    case spline2::SplineStorage::FP16:
+      evaluate_v_impl(einsplines_fp16, u);
+      break;
+    case spline2::SplineStorage::BF16:
+      evaluate_v_impl(einsplines_bf16, u);
+      break;
+    default:
+      evaluate_v_impl(einsplines, u);
+    }
+  }
+
+  /// kernels of the full precision blocks of the selected instruction set
+  inline const spline2::MultiBsplineKernels<T>& getBlockKernels() const
+  {
+    return spline2::getMultiBsplineKernels<T>();
+  }
+
+  template<typename SplineType>
+  inline void evaluate_v_impl(const aligned_vector<SplineType*>& splines, const TinyVector<T, 3>& u)
+  {
     for (int i = 0; i < nBlocks; ++i)
-      MultiBsplineEval::evaluate_v(einsplines[i], u[0], u[1], u[2], psi[i].data(), nSplinesPerBlock);
+      if (activateBlock(i, u))
+        MultiBsplineEval::evaluate_v(splines[i], u[0], u[1], u[2], psi[i].data(), nSplinesPerBlock);
+  }
+
+  /// full precision coefficients go through the kernels of the selected instruction set
+  inline void evaluate_v_impl(const aligned_vector<spline_type*>& splines, const TinyVector<T, 3>& u)
+  {
+    const auto& kernels = getBlockKernels();
+    for (int i = 0; i < nBlocks; ++i)
+      if (activateBlock(i, u))
+        kernels.evaluate_v(getBlockSpline(i, u[0], u[1], u[2]), u[0], u[1], u[2], psi[i].data(), nSplinesPerBlock);
   }
 
   inline void evaluate(const ParticleSet& P, int iat, ValueVector_t& psi_v)
   {
+    if (!TeamMembers.empty())
+    {
+      ScopedTimer local_timer(timer);
+
+      auto u = Lattice.toUnit_floor(P.activeR(iat));
+      runTeam([&](einspline_spo& member, int m) {
+        member.evaluate_v_blocks(u);
+        member.copy_v(psi_v);
+      });
+      return;
+    }
+
     evaluate_v(P, iat);
+    copy_v(psi_v);
+  }
 
+  /// copy psi of the blocks owned by this object to the SPO vector
+  inline void copy_v(ValueVector_t& psi_v)
+  {
     for (int i = 0; i < nBlocks; ++i)
     {
       // in real simulation, phase needs to be applied. Here just fake computation
-      const int first = i * nBlocks;
-      std::copy_n(psi[i].data(), std::min((i + 1) * nSplinesPerBlock, OrbitalSetSize) - first, psi_v.data() + first);
+      const int first = (firstBlock + i) * nSplinesPerBlock;
+      std::copy_n(psi[i].data(), std::min(first + nSplinesPerBlock, OrbitalSetSize) - first, psi_v.data() + first);
     }
   }
 
@@ -185,9 +838,36 @@ struct einspline_spo : public SPOSet
   inline void evaluate_vgl(const ParticleSet& P, int iat)
   {
     auto u = Lattice.toUnit_floor(P.activeR(iat));
+    switch (Storage)
+    {
+    case spline2::SplineStorage::FP16:
+      evaluate_vgl_impl(einsplines_fp16, u);
+      break;
+    case spline2::SplineStorage::BF16:
+      evaluate_vgl_impl(einsplines_bf16, u);
+      break;
+    default:
+      evaluate_vgl_impl(einsplines, u);
+    }
+  }
+
+  template<typename SplineType>
+  inline void evaluate_vgl_impl(const aligned_vector<SplineType*>& splines, const TinyVector<T, 3>& u)
+  {
     for (int i = 0; i < nBlocks; ++i)
-      MultiBsplineEval::evaluate_vgl(einsplines[i], u[0], u[1], u[2], psi[i].data(), grad[i].data(), hess[i].data(),
-                                     nSplinesPerBlock);
+      if (activateBlock(i, u))
+        MultiBsplineEval::evaluate_vgl(splines[i], u[0], u[1], u[2], psi[i].data(), grad[i].data(), hess[i].data(),
+                                       nSplinesPerBlock);
+  }
+
+  /// full precision coefficients go through the kernels of the selected instruction set
+  inline void evaluate_vgl_impl(const aligned_vector<spline_type*>& splines, const TinyVector<T, 3>& u)
+  {
+    const auto& kernels = getBlockKernels();
+    for (int i = 0; i < nBlocks; ++i)
+      if (activateBlock(i, u))
+        kernels.evaluate_vgl(getBlockSpline(i, u[0], u[1], u[2]), u[0], u[1], u[2], psi[i].data(), grad[i].data(),
+                             hess[i].data(), nSplinesPerBlock);
   }
 
   /** evaluate psi, grad and hess */
@@ -196,9 +876,52 @@ struct einspline_spo : public SPOSet
     ScopedTimer local_timer(timer);
 
     auto u = Lattice.toUnit_floor(P.activeR(iat));
+    evaluate_vgh_blocks(u);
+  }
+
+  /// evaluate psi, grad and hess at the unit coordinates u
+  inline void evaluate_vgh_blocks(const TinyVector<T, 3>& u)
+  {
     for (int i = 0; i < nBlocks; ++i)
-      MultiBsplineEval::evaluate_vgh(einsplines[i], u[0], u[1], u[2], psi[i].data(), grad[i].data(), hess[i].data(),
+      if (activateBlock(i, u))
+        evaluate_vgh_block(i, u[0], u[1], u[2]);
+  }
+
+  /// evaluate psi, grad and hess of the i-th block
+  inline void evaluate_vgh_block(int i, T x, T y, T z)
+  {
+    switch (Storage)
+    {
+    case spline2::SplineStorage::FP16:
+      MultiBsplineEval::evaluate_vgh(einsplines_fp16[i], x, y, z, psi[i].data(), grad[i].data(), hess[i].data(),
                                      nSplinesPerBlock);
+      break;
+    case spline2::SplineStorage::BF16:
+      MultiBsplineEval::evaluate_vgh(einsplines_bf16[i], x, y, z, psi[i].data(), grad[i].data(), hess[i].data(),
+                                     nSplinesPerBlock);
+      break;
+    default:
+      // full precision coefficients go through the kernels of the selected instruction set
+      getBlockKernels().evaluate_vgh(getBlockSpline(i, x, y, z), x, y, z, psi[i].data(), grad[i].data(),
+                                     hess[i].data(), nSplinesPerBlock);
+    }
+  }
+
+  /// evaluate psi and grad of the i-th block, hess is left as is
+  inline void evaluate_vg_block(int i, T x, T y, T z)
+  {
+    switch (Storage)
+    {
+    case spline2::SplineStorage::FP16:
+      MultiBsplineEval::evaluate_vg(einsplines_fp16[i], x, y, z, psi[i].data(), grad[i].data(), nSplinesPerBlock);
+      break;
+    case spline2::SplineStorage::BF16:
+      MultiBsplineEval::evaluate_vg(einsplines_bf16[i], x, y, z, psi[i].data(), grad[i].data(), nSplinesPerBlock);
+      break;
+    default:
+      getBlockKernels().evaluate_vg(getBlockSpline(i, x, y, z), x, y, z, psi[i].data(), grad[i].data(),
+                                    nSplinesPerBlock);
+    }
   }
 
   inline void evaluate(const ParticleSet& P,
@@ -207,25 +930,453 @@ struct einspline_spo : public SPOSet
                        GradVector_t& dpsi_v,
                        ValueVector_t& d2psi_v)
   {
+    if (!TeamMembers.empty())
+    {
+      ScopedTimer local_timer(timer);
+
+      auto u = Lattice.toUnit_floor(P.activeR(iat));
+      runTeam([&](einspline_spo& member, int m) {
+        member.evaluate_vgh_blocks(u);
+        member.copy_vgh(psi_v, dpsi_v, d2psi_v);
+      });
+      return;
+    }
+
     evaluate_vgh(P, iat);
+    copy_vgh(psi_v, dpsi_v, d2psi_v);
+  }
 
+  /// copy psi, grad and hess of the blocks owned by this object to the SPO vectors
+  inline void copy_vgh(ValueVector_t& psi_v, GradVector_t& dpsi_v, ValueVector_t& d2psi_v)
+  {
     for (int i = 0; i < nBlocks; ++i)
     {
       // in real simulation, phase needs to be applied. Here just fake computation
-      const int first = i * nBlocks;
-      for (int j = first; j < std::min((i + 1) * nSplinesPerBlock, OrbitalSetSize); j++)
+      const int first = (firstBlock + i) * nSplinesPerBlock;
+      for (int j = first; j < std::min(first + nSplinesPerBlock, OrbitalSetSize); j++)
       {
         psi_v[j]   = psi[i][j - first];
         dpsi_v[j]  = grad[i][j - first];
-        d2psi_v[j] = hess[i].data(0)[j - first];
+        d2psi_v[j] = hess[i].data(0)[j - first] + hess[i].data(3)[j - first] + hess[i].data(5)[j - first];
+      }
+    }
+  }
+
+  /// evaluate the laplacians of the i-th block into lapl
+  inline void evaluate_l_block(int i, T x, T y, T z)
+  {
+    switch (Storage)
+    {
+    case spline2::SplineStorage::FP16:
+      MultiBsplineEval::evaluate_l(einsplines_fp16[i], x, y, z, lapl[i].data(), nSplinesPerBlock);
+      break;
+    case spline2::SplineStorage::BF16:
+      MultiBsplineEval::evaluate_l(einsplines_bf16[i], x, y, z, lapl[i].data(), nSplinesPerBlock);
+      break;
+    default:
+      getBlockKernels().evaluate_l(getBlockSpline(i, x, y, z), x, y, z, lapl[i].data(), nSplinesPerBlock);
+    }
+  }
+
+  /// evaluate the laplacians at the unit coordinates u
+  inline void evaluate_l_blocks(const TinyVector<T, 3>& u)
+  {
+    for (int i = 0; i < nBlocks; ++i)
+      if (activateBlock(i, u))
+        evaluate_l_block(i, u[0], u[1], u[2]);
+  }
+
+  /// copy the laplacians of the blocks owned by this object to the SPO vector
+  inline void copy_l(ValueVector_t& d2psi_v)
+  {
+    for (int i = 0; i < nBlocks; ++i)
+    {
+      const int first = (firstBlock + i) * nSplinesPerBlock;
+      std::copy_n(lapl[i].data(), std::min(first + nSplinesPerBlock, OrbitalSetSize) - first, d2psi_v.data() + first);
+    }
+  }
+
+  /// the laplacians only, with evaluate_l
+  void evaluateLaplacian(const ParticleSet& P, int iat, ValueVector_t& d2psi_v) override
+  {
+    ScopedTimer local_timer(timer);
+
+    auto u = Lattice.toUnit_floor(P.activeR(iat));
+    if (TeamMembers.empty())
+    {
+      evaluate_l_blocks(u);
+      copy_l(d2psi_v);
+    }
+    else
+      runTeam([&](einspline_spo& member, int m) {
+        member.evaluate_l_blocks(u);
+        member.copy_l(d2psi_v);
+      });
+  }
+
+  /** evaluate psi and grad and contract them with invRow block by block
+   *
+   * Each block is contracted right after its evaluation while it is in cache, and the
+   * SPO vectors are only filled by copyLastVG or copyLastVGL. The hessians are not needed
+   * for the ratio and the drift, they are evaluated only if copyLastVGL is called.
+   * Only the blocks owned by this object contribute to ratio and grad_dot. With a team,
+   * each member contracts its own blocks.
+   */
+  void evaluateRatioGrad(const ParticleSet& P,
+                         int iat,
+                         const ValueVector_t& invRow,
+                         ValueType& ratio,
+                         GradType& grad_dot) override
+  {
+    ScopedTimer local_timer(timer);
+
+    auto u = Lattice.toUnit_floor(P.activeR(iat));
+    T r(0), gx(0), gy(0), gz(0);
+    if (TeamMembers.empty())
+      ratio_grad_blocks(u, invRow, r, gx, gy, gz);
+    else
+    {
+      runTeam([&](einspline_spo& member, int m) {
+        TinyVector<T, 4>& sums = MemberSums[m];
+        sums                   = T(0);
+        member.ratio_grad_blocks(u, invRow, sums[0], sums[1], sums[2], sums[3]);
+      });
+      for (int m = 0; m < MemberSums.size(); m++)
+      {
+        r += MemberSums[m][0];
+        gx += MemberSums[m][1];
+        gy += MemberSums[m][2];
+        gz += MemberSums[m][3];
+      }
+    }
+    ratio    = r;
+    grad_dot = GradType(gx, gy, gz);
+  }
+
+  /// accumulate the contractions of psi and grad of the blocks at the unit coordinates u with invRow
+  inline void ratio_grad_blocks(const TinyVector<T, 3>& u,
+                                const ValueVector_t& invRow,
+                                T& ratio_sum,
+                                T& gx_sum,
+                                T& gy_sum,
+                                T& gz_sum)
+  {
+    LastU = u;
+    T r(0), gx(0), gy(0), gz(0);
+    for (int i = 0; i < nBlocks; ++i)
+    {
+      // the zero rows of the blocks outside their support don't contribute
+      if (!activateBlock(i, u))
+        continue;
+      evaluate_vg_block(i, u[0], u[1], u[2]);
+      const int first       = (firstBlock + i) * nSplinesPerBlock;
+      const int n           = std::min(first + nSplinesPerBlock, OrbitalSetSize) - first;
+      const T* restrict inv = invRow.data() + first;
+      const T* restrict val = psi[i].data();
+      const T* restrict dx  = grad[i].data(0);
+      const T* restrict dy  = grad[i].data(1);
+      const T* restrict dz  = grad[i].data(2);
+#pragma omp simd reduction(+ : r, gx, gy, gz)
+      for (int j = 0; j < n; j++)
+      {
+        r += inv[j] * val[j];
+        gx += inv[j] * dx[j];
+        gy += inv[j] * dy[j];
+        gz += inv[j] * dz[j];
+      }
+    }
+    ratio_sum += r;
+    gx_sum += gx;
+    gy_sum += gy;
+    gz_sum += gz;
+  }
+
+  /// psi and grad of the last evaluateRatioGrad are still in the block outputs, only the laplacians are evaluated
+  void copyLastVGL(ValueVector_t& psi_v, GradVector_t& dpsi_v, ValueVector_t& d2psi_v) override
+  {
+    ScopedTimer local_timer(timer);
+
+    if (TeamMembers.empty())
+    {
+      evaluate_l_blocks(LastU);
+      copy_vg(psi_v, dpsi_v);
+      copy_l(d2psi_v);
+    }
+    else
+      runTeam([&](einspline_spo& member, int m) {
+        member.evaluate_l_blocks(member.LastU);
+        member.copy_vg(psi_v, dpsi_v);
+        member.copy_l(d2psi_v);
+      });
+  }
+
+  /// psi and grad of the last evaluateRatioGrad are still in the block outputs, the laplacians are not computed
+  bool copyLastVG(ValueVector_t& psi_v, GradVector_t& dpsi_v, ValueVector_t& d2psi_v) override
+  {
+    if (TeamMembers.empty())
+      copy_vg(psi_v, dpsi_v);
+    else
+      runTeam([&](einspline_spo& member, int m) { member.copy_vg(psi_v, dpsi_v); });
+    return false;
+  }
+
+  /// copy psi and grad of the blocks owned by this object to the SPO vectors
+  inline void copy_vg(ValueVector_t& psi_v, GradVector_t& dpsi_v)
+  {
+    for (int i = 0; i < nBlocks; ++i)
+    {
+      const int first = (firstBlock + i) * nSplinesPerBlock;
+      for (int j = first; j < std::min(first + nSplinesPerBlock, OrbitalSetSize); j++)
+      {
+        psi_v[j]  = psi[i][j - first];
+        dpsi_v[j] = grad[i][j - first];
+      }
+    }
+  }
+
+  /** ratios of the virtual moves of a particle, psi is not filled
+   *
+   * The coarse companion is used if any, see setCoarse. The positions are evaluated together block by block when their stencils overlap, see
+   * MultiBsplineEval::evaluate_ratios_multi, and one by one otherwise.
+   * With a team, each member accumulates the ratios of its own blocks.
+   */
+  void evaluateDetRatios(const VirtualParticleSet& VP,
+                         ValueVector_t& psi,
+                         const ValueVector_t& psiinv,
+                         std::vector<ValueType>& ratios) override
+  {
+    ScopedTimer local_timer(timer);
+
+    const int num_pos = VP.getTotalNum();
+    RatioU.resize(num_pos);
+    for (int ip = 0; ip < num_pos; ip++)
+      RatioU[ip] = Lattice.toUnit_floor(VP.R[ip]);
+
+    std::fill(ratios.begin(), ratios.begin() + num_pos, ValueType(0));
+    if (TeamMembers.empty())
+      ratios_blocks(RatioU, psiinv, ratios.data());
+    else
+    {
+      const int num_members = TeamMembers.size();
+      MemberRatios.resize(num_members * num_pos);
+      std::fill(MemberRatios.begin(), MemberRatios.end(), T(0));
+      runTeam([&](einspline_spo& member, int m) {
+        member.ratios_blocks(RatioU, psiinv, MemberRatios.data() + m * num_pos);
+      });
+      for (int m = 0; m < num_members; m++)
+        for (int ip = 0; ip < num_pos; ip++)
+          ratios[ip] += MemberRatios[m * num_pos + ip];
+    }
+  }
+
+  /// rows per virtual position of the largest stencil bounding box gathered by ratios_blocks
+  static constexpr int RatioGatherRows = 32;
+
+  /// accumulate the contractions with invRow of the blocks at the unit coordinates u
+  inline void ratios_blocks(const std::vector<TinyVector<T, 3>>& u, const ValueVector_t& invRow, T* ratios)
+  {
+    if (Coarse)
+    {
+      Coarse->ratios_blocks(u, invRow, ratios);
+      return;
+    }
+
+    const int num_pos = u.size();
+    BatchX.resize(num_pos);
+    BatchY.resize(num_pos);
+    BatchZ.resize(num_pos);
+    T* ux = BatchX.data();
+    T* uy = BatchY.data();
+    T* uz = BatchZ.data();
+    for (int ip = 0; ip < num_pos; ip++)
+    {
+      ux[ip] = u[ip][0];
+      uy[ip] = u[ip][1];
+      uz[ip] = u[ip][2];
+    }
+    for (int i = 0; i < nBlocks; ++i)
+    {
+      // the coefficients of a localized block vanish outside its support
+      if (!Supports.empty())
+      {
+        bool inside = false;
+        for (int ip = 0; ip < num_pos && !inside; ip++)
+          inside = inSupport(i, u[ip]);
+        if (!inside)
+          continue;
+      }
+      const int first    = (firstBlock + i) * nSplinesPerBlock;
+      const int n        = std::min(first + nSplinesPerBlock, OrbitalSetSize) - first;
+      const T* inv       = invRow.data() + first;
+      const int max_rows = RatioGatherRows * num_pos;
+      bool gathered;
+      switch (Storage)
+      {
+      case spline2::SplineStorage::FP16:
+        gathered = MultiBsplineEval::evaluate_ratios_multi(einsplines_fp16[i], ux, uy, uz, num_pos, inv, ratios, n,
+                                                           max_rows, BatchScratch);
+        break;
+      case spline2::SplineStorage::BF16:
+        gathered = MultiBsplineEval::evaluate_ratios_multi(einsplines_bf16[i], ux, uy, uz, num_pos, inv, ratios, n,
+                                                           max_rows, BatchScratch);
+        break;
+      default:
+        // the paged stencils are gathered one by one
+        gathered = !Paged &&
+            MultiBsplineEval::evaluate_ratios_multi(einsplines[i], ux, uy, uz, num_pos, inv, ratios, n, max_rows,
+                                                    BatchScratch);
+      }
+      if (gathered)
+        continue;
+
+      // the stencils are too far apart, evaluate the positions one by one
+      const auto& kernels = getBlockKernels();
+      for (int ip = 0; ip < num_pos; ip++)
+      {
+        if (!activateBlock(i, u[ip]))
+          continue;
+        switch (Storage)
+        {
+        case spline2::SplineStorage::FP16:
+          MultiBsplineEval::evaluate_v(einsplines_fp16[i], ux[ip], uy[ip], uz[ip], psi[i].data(), nSplinesPerBlock);
+          break;
+        case spline2::SplineStorage::BF16:
+          MultiBsplineEval::evaluate_v(einsplines_bf16[i], ux[ip], uy[ip], uz[ip], psi[i].data(), nSplinesPerBlock);
+          break;
+        default:
+          kernels.evaluate_v(getBlockSpline(i, ux[ip], uy[ip], uz[ip]), ux[ip], uy[ip], uz[ip], psi[i].data(),
+                             nSplinesPerBlock);
+        }
+        ratios[ip] += simd::dot(psi[i].data(), inv, n);
+      }
+    }
+  }
+
+  using SPOSet::multi_evaluate;
+
+  /** evaluate psi, grad and hess of multiple walkers
+   *
+   * When all the walkers are views of the same splines, each coefficient block is
+   * streamed once for the whole batch by MultiBsplineEval::evaluate_vgh_multi.
+   */
+  void multi_evaluate(const std::vector<SPOSet*>& spo_list, const std::vector<ParticleSet*>& P_list, int iat,
+                      std::vector<ValueVector_t*>& psi_v_list,
+                      std::vector<GradVector_t*>& dpsi_v_list,
+                      std::vector<ValueVector_t*>& d2psi_v_list)
+  {
+    const int nw = spo_list.size();
+    std::vector<einspline_spo*>& walker_spos = BatchSPOs;
+    walker_spos.resize(nw);
+    for (int iw = 0; iw < nw; iw++)
+    {
+      walker_spos[iw] = dynamic_cast<einspline_spo*>(spo_list[iw]);
+      // localized blocks are skipped walker by walker, paged stencils are gathered walker by walker
+      if (walker_spos[iw] == nullptr || !Supports.empty() || Paged || walker_spos[iw]->firstBlock != firstBlock ||
+          walker_spos[iw]->nBlocks != nBlocks || walker_spos[iw]->Storage != Storage ||
+          walker_spos[iw]->einsplines[0] != einsplines[0] || walker_spos[iw]->einsplines_fp16[0] != einsplines_fp16[0] ||
+          walker_spos[iw]->einsplines_bf16[0] != einsplines_bf16[0])
+      {
+        SPOSet::multi_evaluate(spo_list, P_list, iat, psi_v_list, dpsi_v_list, d2psi_v_list);
+        return;
+      }
+    }
+
+    {
+      ScopedTimer local_timer(timer);
+
+      BatchX.resize(nw);
+      BatchY.resize(nw);
+      BatchZ.resize(nw);
+      for (int iw = 0; iw < nw; iw++)
+      {
+        auto u = Lattice.toUnit_floor(P_list[iw]->activeR(iat));
+        BatchX[iw] = u[0];
+        BatchY[iw] = u[1];
+        BatchZ[iw] = u[2];
+      }
+
+      switch (Storage)
+      {
+      case spline2::SplineStorage::FP16:
+        multi_evaluate_vgh_impl(einsplines_fp16, walker_spos);
+        break;
+      case spline2::SplineStorage::BF16:
+        multi_evaluate_vgh_impl(einsplines_bf16, walker_spos);
+        break;
+      default:
+        multi_evaluate_vgh_impl(einsplines, walker_spos);
+      }
+    }
+
+    for (int iw = 0; iw < nw; iw++)
+      walker_spos[iw]->copy_vgh(*psi_v_list[iw], *dpsi_v_list[iw], *d2psi_v_list[iw]);
+  }
+
+  /** evaluate_notranspose of multiple walkers
+   *
+   * The walkers are evaluated together one particle at a time with multi_evaluate, so that
+   * the coefficients are streamed once per particle for the whole batch.
+   */
+  void multi_evaluate_notranspose(const std::vector<SPOSet*>& spo_list,
+                                  const std::vector<ParticleSet*>& P_list,
+                                  int first,
+                                  int last,
+                                  const std::vector<ValueMatrix_t*>& logdet_list,
+                                  const std::vector<GradMatrix_t*>& dlogdet_list,
+                                  const std::vector<ValueMatrix_t*>& d2logdet_list) override
+  {
+    const int nw = spo_list.size();
+    std::vector<ValueVector_t> v(nw), l(nw);
+    std::vector<GradVector_t> g(nw);
+    std::vector<ValueVector_t*> v_list(nw), l_list(nw);
+    std::vector<GradVector_t*> g_list(nw);
+    for (int iw = 0; iw < nw; iw++)
+    {
+      v_list[iw] = &v[iw];
+      g_list[iw] = &g[iw];
+      l_list[iw] = &l[iw];
+    }
+    for (int iat = first, i = 0; iat < last; ++iat, ++i)
+    {
+      for (int iw = 0; iw < nw; iw++)
+      {
+        v[iw].attachReference((*logdet_list[iw])[i], OrbitalSetSize);
+        g[iw].attachReference((*dlogdet_list[iw])[i], OrbitalSetSize);
+        l[iw].attachReference((*d2logdet_list[iw])[i], OrbitalSetSize);
+      }
+      multi_evaluate(spo_list, P_list, iat, v_list, g_list, l_list);
+    }
+  }
+
+  template<typename SplineType>
+  inline void multi_evaluate_vgh_impl(const aligned_vector<SplineType*>& splines,
+                                      const std::vector<einspline_spo*>& walker_spos)
+  {
+    const int nw = walker_spos.size();
+    BatchVals.resize(nw);
+    BatchGrads.resize(nw);
+    BatchHess.resize(nw);
+    for (int i = 0; i < nBlocks; ++i)
+    {
+      for (int iw = 0; iw < nw; iw++)
+      {
+        BatchVals[iw]  = walker_spos[iw]->psi[i].data();
+        BatchGrads[iw] = walker_spos[iw]->grad[i].data();
+        BatchHess[iw]  = walker_spos[iw]->hess[i].data();
       }
+      MultiBsplineEval::evaluate_vgh_multi(splines[i], BatchX.data(), BatchY.data(), BatchZ.data(), nw,
+                                           BatchVals.data(), BatchGrads.data(), BatchHess.data(), nSplinesPerBlock,
+                                           BatchScratch);
     }
   }
 
   void print(std::ostream& os)
   {
     os << "SPO nBlocks=" << nBlocks << " firstBlock=" << firstBlock << " lastBlock=" << lastBlock
-       << " nSplines=" << nSplines << " nSplinesPerBlock=" << nSplinesPerBlock << std::endl;
+       << " nSplines=" << nSplines << " nSplinesPerBlock=" << nSplinesPerBlock
+       << " storage=" << spline2::getSplineStorageName(Storage) << " inversion=" << Inversion << std::endl;
+    if (Coarse)
+      os << "  ratios of the virtual moves on the grid " << Coarse->getGridNum() << std::endl;
   }
 };
 } // namespace qmcplusplus
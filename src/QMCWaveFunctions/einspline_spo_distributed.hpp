@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file einspline_spo_distributed.hpp
+ * @brief einspline_spo with the blocks distributed over the ranks of a node
+ */
+#ifndef QMCPLUSPLUS_EINSPLINE_SPO_DISTRIBUTED_HPP
+#define QMCPLUSPLUS_EINSPLINE_SPO_DISTRIBUTED_HPP
+
+#include <stdexcept>
+#include <Utilities/Communicate.h>
+#include <QMCWaveFunctions/einspline_spo.hpp>
+
+namespace qmcplusplus
+{
+/** orbitals stored in slices of blocks, one slice per rank of a communicator
+ *
+ * Every evaluation is a collective over the communicator: the positions of all the ranks
+ * are gathered, each rank evaluates its slice at all of them and sends the results back
+ * to the ranks which requested them. The ranks must evaluate together, from one thread
+ * each, with any number of positions per rank. The orbitals are the same as those of
+ * an einspline_spo holding all the blocks.
+ */
+template<typename T>
+class einspline_spo_distributed : public SPOSet
+{
+public:
+  using spo_type = einspline_spo<T>;
+
+  /// blocks stored on this rank, its firstBlock and lastBlock count the blocks of all the ranks
+  spo_type Slice;
+
+  /** constructor
+   * @param comm ranks sharing the blocks, the ranks of a node to keep the traffic local
+   */
+  explicit einspline_spo_distributed(Communicate& comm) : Comm(comm)
+  {
+    timer = TimerManager.createTimer("Distributed SPO exchange", timer_level_fine);
+  }
+
+  /** generate the coefficients of the slice of this rank
+   *
+   * The arguments are those of einspline_spo::set. The \p nblocks blocks are divided
+   * evenly among the ranks, which requires at least one block per rank.
+   */
+  void set(int nx,
+           int ny,
+           int nz,
+           int num_splines,
+           int nblocks,
+           bool init_random               = true,
+           spline2::SplineStorage storage = spline2::SplineStorage::FULL,
+           int brick_shift                = 0,
+           bool inversion                 = false)
+  {
+    const int num_ranks = Comm.size();
+    if (num_ranks > nblocks)
+      throw std::runtime_error("Distributing the orbitals requires at least one block per rank");
+
+    OrbitalSetSize              = num_splines;
+    const int splines_per_block = num_splines / nblocks;
+    std::vector<int> first_blocks(num_ranks + 1);
+    FirstOrbital.resize(num_ranks + 1);
+    for (int r = 0; r <= num_ranks; r++)
+    {
+      first_blocks[r] = nblocks * r / num_ranks;
+      FirstOrbital[r] = std::min(first_blocks[r] * splines_per_block, num_splines);
+    }
+    FirstOrbital[num_ranks] = num_splines;
+    Slice.set(nx, ny, nz, num_splines, nblocks, init_random, storage, brick_shift, inversion,
+              first_blocks[Comm.rank()], first_blocks[Comm.rank() + 1]);
+  }
+
+  /// number of orbitals stored on the rank r
+  inline int getSliceSize(int r) const { return FirstOrbital[r + 1] - FirstOrbital[r]; }
+
+  /** evaluate the orbitals at the positions of this rank with the slices of all the ranks
+   * @param positions positions of this rank
+   * @param vgl if true, the values, gradients and laplacians, otherwise the values only
+   *
+   * Collective over the communicator. Once done, Results holds for each position the
+   * components of all the orbitals, see getResult.
+   */
+  void exchange(const std::vector<PosType>& positions, bool vgl)
+  {
+    ScopedTimer local_timer(timer);
+
+    const int num_ranks  = Comm.size();
+    const int rank       = Comm.rank();
+    const int num_comps  = vgl ? 5 : 1;
+    const int slice_size = getSliceSize(rank);
+    NumComponents        = num_comps;
+
+    // positions out
+    int num_pos = positions.size();
+    std::vector<int> pos_counts(num_ranks), coord_counts(num_ranks);
+    Comm.allgather(&num_pos, pos_counts.data(), 1);
+    int total_pos = 0;
+    for (int r = 0; r < num_ranks; r++)
+    {
+      coord_counts[r] = 3 * pos_counts[r];
+      total_pos += pos_counts[r];
+    }
+    std::vector<T> coords(3 * num_pos);
+    for (int ip = 0; ip < num_pos; ip++)
+      for (int d = 0; d < 3; d++)
+        coords[3 * ip + d] = positions[ip][d];
+    Requests.resize(3 * total_pos);
+    Comm.allgatherv(coords.data(), Requests.data(), coord_counts);
+
+    // the slice of this rank at all the requested positions, the components of a position are contiguous
+    Replies.resize(total_pos * num_comps * slice_size);
+    for (int ip = 0; ip < total_pos; ip++)
+    {
+      const TinyVector<T, 3> u =
+          Slice.Lattice.toUnit_floor(TinyVector<T, 3>(Requests[3 * ip], Requests[3 * ip + 1], Requests[3 * ip + 2]));
+      T* restrict reply = Replies.data() + ip * num_comps * slice_size;
+      if (vgl)
+        Slice.evaluate_vgh_blocks(u);
+      else
+        Slice.evaluate_v_blocks(u);
+      for (int i = 0; i < Slice.nBlocks; ++i)
+      {
+        const int first = (Slice.firstBlock + i) * Slice.nSplinesPerBlock - FirstOrbital[rank];
+        const int n     = std::min(Slice.nSplinesPerBlock, slice_size - first);
+        std::copy_n(Slice.psi[i].data(), n, reply + first);
+        if (!vgl)
+          continue;
+        for (int d = 0; d < 3; d++)
+          std::copy_n(Slice.grad[i].data(d), n, reply + (d + 1) * slice_size + first);
+        // the laplacian of einspline_spo::evaluate
+        std::copy_n(Slice.hess[i].data(0), n, reply + 4 * slice_size + first);
+      }
+    }
+
+    // slices back
+    std::vector<int> send_counts(num_ranks), recv_counts(num_ranks);
+    for (int r = 0; r < num_ranks; r++)
+    {
+      send_counts[r] = pos_counts[r] * num_comps * slice_size;
+      recv_counts[r] = num_pos * num_comps * getSliceSize(r);
+    }
+    Received.resize(num_pos * num_comps * OrbitalSetSize);
+    Comm.alltoallv(Replies.data(), send_counts, Received.data(), recv_counts);
+
+    Results.resize(num_pos * num_comps * OrbitalSetSize);
+    const T* src = Received.data();
+    for (int r = 0; r < num_ranks; r++)
+      for (int ic = 0; ic < num_pos * num_comps; ic++, src += getSliceSize(r))
+        std::copy_n(src, getSliceSize(r), Results.data() + ic * OrbitalSetSize + FirstOrbital[r]);
+  }
+
+  /// component c (value, x, y and z gradients, laplacian) of the orbitals at the position ip of the last exchange
+  inline const T* getResult(int ip, int c) const { return Results.data() + (ip * NumComponents + c) * OrbitalSetSize; }
+
+  /// collective over the communicator, see exchange
+  void evaluate(const ParticleSet& P, int iat, ValueVector_t& psi_v) override
+  {
+    Positions.assign(1, P.activeR(iat));
+    exchange(Positions, false);
+    std::copy_n(getResult(0, 0), OrbitalSetSize, psi_v.data());
+  }
+
+  /// collective over the communicator, see exchange
+  void evaluate(const ParticleSet& P, int iat, ValueVector_t& psi_v, GradVector_t& dpsi_v, ValueVector_t& d2psi_v)
+      override
+  {
+    Positions.assign(1, P.activeR(iat));
+    exchange(Positions, true);
+    const T* restrict v  = getResult(0, 0);
+    const T* restrict gx = getResult(0, 1);
+    const T* restrict gy = getResult(0, 2);
+    const T* restrict gz = getResult(0, 3);
+    const T* restrict l  = getResult(0, 4);
+    for (int j = 0; j < OrbitalSetSize; j++)
+    {
+      psi_v[j]   = v[j];
+      dpsi_v[j]  = GradType(gx[j], gy[j], gz[j]);
+      d2psi_v[j] = l[j];
+    }
+  }
+
+  /// all the virtual positions in one exchange, collective over the communicator
+  void evaluateDetRatios(const VirtualParticleSet& VP,
+                         ValueVector_t& psi,
+                         const ValueVector_t& psiinv,
+                         std::vector<ValueType>& ratios) override
+  {
+    const int num_pos = VP.getTotalNum();
+    Positions.resize(num_pos);
+    for (int ip = 0; ip < num_pos; ip++)
+      Positions[ip] = VP.R[ip];
+    exchange(Positions, false);
+    for (int ip = 0; ip < num_pos; ip++)
+      ratios[ip] = simd::dot(getResult(ip, 0), psiinv.data(), OrbitalSetSize);
+  }
+
+private:
+  Communicate& Comm;
+  /// first orbital of the slice of each rank and the number of orbitals
+  std::vector<int> FirstOrbital;
+  /// number of components per orbital of the last exchange
+  int NumComponents;
+  std::vector<PosType> Positions;
+  /// positions of all the ranks
+  std::vector<T> Requests;
+  /// the slice of this rank at the positions of all the ranks
+  std::vector<T> Replies;
+  /// the slices of all the ranks at the positions of this rank, ordered by rank
+  std::vector<T> Received;
+  /// Received ordered by orbital
+  std::vector<T> Results;
+  NewTimer* timer;
+};
+
+} // namespace qmcplusplus
+#endif
@@ -126,7 +126,8 @@ struct einspline_spo_ref : public SPOSet
   /// divided into \p nblocks chunks each with a grid \p nx x \p ny x \p nz.
   /// If \p init_random is true, in each chunk, one orbital is fully randomized
   /// and others are tweaked based on it.
-  void set(int nx, int ny, int nz, int num_splines, int nblocks, bool init_random = true)
+  /// With \p inversion, the orbitals are symmetrized like einspline_spo with inversion.
+  void set(int nx, int ny, int nz, int num_splines, int nblocks, bool init_random = true, bool inversion = false)
   {
     // setting OrbitalSetSize to num_splines made artificial only in miniQMC
     OrbitalSetSize = num_splines;
@@ -152,6 +153,9 @@ struct einspline_spo_ref : public SPOSet
         {
           // Generate a orbital fully with fully randomized coefficients
           myrandom.generate_uniform(coef_data.data(), coef_data.size());
+          // the same parities as einspline_spo but the whole grid is stored
+          if (inversion)
+            spline2::makeInversionSymmetric(coef_data, i % 2 ? -1 : 1);
           // Generate different coefficients for each orbital by tweaking coef_data
           myAllocator.setCoefficientsForOrbitals(0, nSplinesPerBlock, coef_data, einsplines[i]);
         }
@@ -177,8 +181,8 @@ struct einspline_spo_ref : public SPOSet
     for (int i = 0; i < nBlocks; ++i)
     {
       // in real simulation, phase needs to be applied. Here just fake computation
-      const int first = i * nBlocks;
-      std::copy_n(psi[i].data(), std::min((i + 1) * nSplinesPerBlock, OrbitalSetSize) - first, psi_v.data() + first);
+      const int first = (firstBlock + i) * nSplinesPerBlock;
+      std::copy_n(psi[i].data(), std::min(first + nSplinesPerBlock, OrbitalSetSize) - first, psi_v.data() + first);
     }
   }
 
@@ -213,12 +217,12 @@ struct einspline_spo_ref : public SPOSet
     for (int i = 0; i < nBlocks; ++i)
     {
       // in real simulation, phase needs to be applied. Here just fake computation
-      const int first = i * nBlocks;
-      for (int j = first; j < std::min((i + 1) * nSplinesPerBlock, OrbitalSetSize); j++)
+      const int first = (firstBlock + i) * nSplinesPerBlock;
+      for (int j = first; j < std::min(first + nSplinesPerBlock, OrbitalSetSize); j++)
       {
         psi_v[j]   = psi[i][j - first];
         dpsi_v[j]  = grad[i][j - first];
-        d2psi_v[j] = hess[i].data(0)[j - first];
+        d2psi_v[j] = hess[i].data(0)[j - first] + hess[i].data(3)[j - first] + hess[i].data(5)[j - first];
       }
     }
   }
@@ -0,0 +1,640 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file hybrid_spo.hpp
+ * @brief Orbitals in atomic spheres with a coarse B-spline grid in between
+ */
+#ifndef QMCPLUSPLUS_HYBRID_SPO_HPP
+#define QMCPLUSPLUS_HYBRID_SPO_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+#include <QMCWaveFunctions/einspline_spo.hpp>
+#include <QMCWaveFunctions/SyntheticOrbitals.h>
+#include <Numerics/SolidHarmonics.h>
+#include <Numerics/Spline2/BsplineInterpolation.hpp>
+
+namespace qmcplusplus
+{
+/** orbitals in the hybrid representation
+ *
+ * Inside a sphere of radius Cutoff around each ion, the orbitals are expanded in the real
+ * spherical harmonics up to Lmax times radial cubic B-splines. Between the spheres, they are
+ * interpolated by the 3D B-splines of Grid which only has to resolve their smooth part and
+ * can be much coarser than a grid resolving the orbitals near the ions. Between InnerCutoff
+ * and Cutoff, both are evaluated and blended smoothly.
+ *
+ * Unlike einspline_spo, the gradients and Hessians are Cartesian since the atomic and the grid
+ * parts have to agree. The outputs cover the orbitals [First, Last) of the blocks of Grid.
+ */
+template<typename T>
+struct hybrid_spo : public SPOSet
+{
+  using grid_spo_type   = einspline_spo<T>;
+  using pos_type        = TinyVector<T, 3>;
+  using vContainer_type = aligned_vector<T>;
+  using gContainer_type = VectorSoAContainer<T, 3>;
+  using hContainer_type = VectorSoAContainer<T, 6>;
+
+  /// radial splines of the orbitals in the sphere of an ion
+  struct AtomicCenter
+  {
+    pos_type Pos;
+    /// number of radial grid intervals up to the cutoff
+    int NumGrid;
+    T DeltaInv;
+    /// coefficients of the radial grid points -1 to NumGrid+1, each with a row of Stride orbitals per lm
+    const T* Coefs;
+  };
+
+  /// maximum angular momentum in the spheres
+  int Lmax;
+  /// number of harmonics, (Lmax+1)^2
+  int NumLM;
+  /// radius of the spheres, no spheres if not positive
+  T Cutoff;
+  /// the atomic and the grid parts are blended between InnerCutoff and Cutoff
+  T InnerCutoff;
+  /// distance between the orbital rows of the radial splines
+  size_t Stride;
+  /// orbitals evaluated by this object
+  int First;
+  int Last;
+  /// orbitals between the spheres
+  grid_spo_type Grid;
+  std::vector<AtomicCenter> Centers;
+  /// radial coefficients of the centers, owned by the main object
+  std::vector<aligned_vector<T>> CenterCoefs;
+  SolidHarmonics<T> Ylm;
+  /// outputs of the orbitals [First, Last)
+  vContainer_type psi;
+  gContainer_type grad;
+  hContainer_type hess;
+  /// harmonics at the last position
+  aligned_vector<T> ylm_v;
+  aligned_vector<T> ylm_g;
+  aligned_vector<T> ylm_h;
+  /// radial sums of the atomic part, 15 arrays of getAlignedSize(Last - First)
+  aligned_vector<T> Work;
+
+  /// Timer
+  NewTimer* timer;
+
+  /// default constructor
+  hybrid_spo() : Lmax(0), NumLM(1), Cutoff(0), InnerCutoff(0), Stride(0), First(0), Last(0), Ylm(0)
+  {
+    timer = TimerManager.createTimer("Hybrid Orbitals", timer_level_fine);
+  }
+  /// disable copy constructor
+  hybrid_spo(const hybrid_spo& in) = delete;
+  /// disable copy operator
+  hybrid_spo& operator=(const hybrid_spo& in) = delete;
+
+  /** copy constructor
+   * @param in_main hybrid_spo
+   * @param team_size number of members in a team
+   * @param member_id id of this member in a team
+   *
+   * Create a view of the big object, the blocks of Grid are split as in einspline_spo.
+   */
+  hybrid_spo(const hybrid_spo& in_main, int team_size, int member_id)
+      : Lmax(in_main.Lmax),
+        NumLM(in_main.NumLM),
+        Cutoff(in_main.Cutoff),
+        InnerCutoff(in_main.InnerCutoff),
+        Stride(in_main.Stride),
+        Grid(in_main.Grid, team_size, member_id),
+        Centers(in_main.Centers),
+        Ylm(in_main.Ylm)
+  {
+    resize();
+    timer = TimerManager.createTimer("Hybrid Orbitals", timer_level_fine);
+  }
+
+  /// resize the containers to the orbitals of the blocks of Grid
+  void resize()
+  {
+    OrbitalSetSize = Grid.size();
+    First          = std::min(Grid.firstBlock * Grid.nSplinesPerBlock, OrbitalSetSize);
+    Last           = std::min(Grid.lastBlock * Grid.nSplinesPerBlock, OrbitalSetSize);
+    psi.resize(Last - First);
+    grad.resize(Last - First);
+    hess.resize(Last - First);
+    ylm_v.resize(NumLM);
+    ylm_g.resize(3 * NumLM);
+    ylm_h.resize(6 * NumLM);
+    Work.resize(15 * getAlignedSize<T>(Last - First));
+  }
+
+  /** build the hybrid representation of orbitals
+   * @param orbitals analytic orbitals and the ions of the spheres
+   * @param nx,ny,nz grid between the spheres
+   * @param nblocks number of blocks of the grid
+   * @param lmax maximum angular momentum in the spheres
+   * @param cutoff radius of the spheres, without spheres if not positive and the grid interpolates the full orbitals
+   * @param delta spacing of the radial grids
+   *
+   * The grid interpolates the orbitals without their atomic terms, which vanish before the blending
+   * region. In the spheres, the orbitals are projected on the harmonics with a product quadrature
+   * on spherical shells and the radial functions are interpolated by cubic B-splines.
+   */
+  void set(const SyntheticOrbitals<T>& orbitals, int nx, int ny, int nz, int nblocks, int lmax, T cutoff, T delta)
+  {
+    const int norb = orbitals.size();
+    if (norb % nblocks != 0)
+      throw std::runtime_error("hybrid_spo needs the orbitals to be divided evenly into the blocks");
+    Lmax        = lmax;
+    Ylm         = SolidHarmonics<T>(lmax);
+    NumLM       = Ylm.size();
+    Cutoff      = cutoff > T(0) ? cutoff : T(0);
+    InnerCutoff = T(0.8) * Cutoff;
+    Stride      = getAlignedSize<T>(norb);
+    Centers.clear();
+    CenterCoefs.clear();
+    if (Cutoff > T(0))
+    {
+      if (InnerCutoff < orbitals.getAtomicRadius())
+        throw std::runtime_error("hybrid_spo cutoff is too small, the atomic terms reach the grid");
+      const std::vector<pos_type>& ions = orbitals.getCenters();
+      for (int i = 0; i < ions.size(); i++)
+        for (int j = 0; j < i; j++)
+        {
+          const pos_type d = orbitals.getDisplacement(ions[i], ions[j]);
+          if (dot(d, d) < T(4) * Cutoff * Cutoff)
+            throw std::runtime_error("hybrid_spo cutoff is too large, the spheres overlap");
+        }
+    }
+
+    Grid.set(nx, ny, nz, norb, nblocks, false);
+    Grid.Lattice = orbitals.getLattice();
+    interpolateGrid(orbitals, Cutoff <= T(0));
+    if (Cutoff > T(0))
+      projectCenters(orbitals, delta);
+    resize();
+  }
+
+  /// bytes of the coefficients of the grid and of the spheres
+  size_t getGridBytes() const
+  {
+    size_t bytes = 0;
+    for (int i = 0; i < Grid.nBlocks; i++)
+      bytes += Grid.einsplines[i]->coefs_size * sizeof(T);
+    return bytes;
+  }
+
+  size_t getAtomicBytes() const
+  {
+    size_t bytes = 0;
+    for (const AtomicCenter& center : Centers)
+      bytes += (center.NumGrid + 3) * NumLM * Stride * sizeof(T);
+    return bytes;
+  }
+
+  /// index of the center whose sphere contains r, -1 if none, with the displacement d from it and its length
+  inline int findCenter(const pos_type& r, pos_type& d, T& dist) const
+  {
+    const T cutoff2 = Cutoff * Cutoff;
+    for (int ic = 0; ic < Centers.size(); ic++)
+    {
+      const pos_type di = getDisplacement(r, Centers[ic].Pos);
+      const T d2        = dot(di, di);
+      if (d2 < cutoff2)
+      {
+        d    = di;
+        dist = std::sqrt(d2);
+        return ic;
+      }
+    }
+    return -1;
+  }
+
+  /// minimum image displacement of r from the center c
+  inline pos_type getDisplacement(const pos_type& r, const pos_type& c) const
+  {
+    pos_type u = Grid.Lattice.toUnit(r - c);
+    for (int d = 0; d < 3; d++)
+      u[d] -= std::round(u[d]);
+    return Grid.Lattice.toCart(u);
+  }
+
+  /** weight of the atomic part at the distance dist from a center and its radial derivatives
+   *
+   * A quintic smoothstep going from 1 at InnerCutoff to 0 at Cutoff with vanishing first
+   * and second derivatives at both ends.
+   */
+  inline void getBlendWeight(T dist, T& s, T& ds, T& d2s) const
+  {
+    const T w = Cutoff - InnerCutoff;
+    const T x = (dist - InnerCutoff) / w;
+    s         = T(1) - x * x * x * (T(10) - T(15) * x + T(6) * x * x);
+    ds        = T(-30) * x * x * (T(1) - x) * (T(1) - x) / w;
+    d2s       = T(-60) * x * (T(1) - x) * (T(1) - T(2) * x) / (w * w);
+  }
+
+  /** evaluate psi at r */
+  inline void evaluate_v(const pos_type& r)
+  {
+    ScopedTimer local_timer(timer);
+
+    pos_type d;
+    T dist          = T(0);
+    const int ic    = findCenter(r, d, dist);
+    const int n     = Last - First;
+    T* restrict val = psi.data();
+    if (ic < 0 || dist > InnerCutoff)
+    {
+      Grid.evaluate_v_blocks(Grid.Lattice.toUnit_floor(r));
+      for (int i = 0; i < Grid.nBlocks; ++i)
+      {
+        const int first = (Grid.firstBlock + i) * Grid.nSplinesPerBlock;
+        std::copy_n(Grid.psi[i].data(), std::min(first + Grid.nSplinesPerBlock, Last) - first, val + first - First);
+      }
+    }
+    if (ic < 0)
+      return;
+
+    T* restrict atomic = Work.data();
+    evaluate_center_v(Centers[ic], d, dist, atomic);
+    if (dist <= InnerCutoff)
+    {
+      std::copy_n(atomic, n, val);
+      return;
+    }
+    T s, ds, d2s;
+    getBlendWeight(dist, s, ds, d2s);
+#pragma omp simd
+    for (int j = 0; j < n; j++)
+      val[j] += s * (atomic[j] - val[j]);
+  }
+
+  inline void evaluate_v(const ParticleSet& P, int iat) { evaluate_v(pos_type(P.activeR(iat))); }
+
+  /// values of the radial splines of a center at d times the harmonics
+  inline void evaluate_center_v(const AtomicCenter& center, const pos_type& d, T dist, T* restrict vals)
+  {
+    const int n = Last - First;
+    if (dist > MinRadius)
+      Ylm.evaluate(d[0] / dist, d[1] / dist, d[2] / dist, ylm_v.data());
+    else
+      Ylm.evaluate(T(0), T(0), T(1), ylm_v.data());
+
+    T t, a[4];
+    int ir;
+    spline2::getSplineBound(dist * center.DeltaInv, t, ir, center.NumGrid - 1);
+    MultiBsplineData<T>::compute_prefactors(a, t);
+    const size_t row = NumLM * Stride;
+    std::fill(vals, vals + n, T(0));
+    for (int lm = 0; lm < NumLM; lm++)
+    {
+      const T* restrict p0 = center.Coefs + ir * row + lm * Stride + First;
+      const T* restrict p1 = p0 + row;
+      const T* restrict p2 = p1 + row;
+      const T* restrict p3 = p2 + row;
+      const T y            = ylm_v[lm];
+      const T c0 = y * a[0], c1 = y * a[1], c2 = y * a[2], c3 = y * a[3];
+#pragma omp simd
+      for (int j = 0; j < n; j++)
+        vals[j] += c0 * p0[j] + c1 * p1[j] + c2 * p2[j] + c3 * p3[j];
+    }
+  }
+
+  inline void evaluate(const ParticleSet& P, int iat, ValueVector_t& psi_v)
+  {
+    evaluate_v(P, iat);
+    copy_v(psi_v);
+  }
+
+  /// copy psi of the orbitals owned by this object to the SPO vector
+  inline void copy_v(ValueVector_t& psi_v) { std::copy_n(psi.data(), Last - First, psi_v.data() + First); }
+
+  /** evaluate psi, grad and hess at r */
+  inline void evaluate_vgh(const pos_type& r)
+  {
+    ScopedTimer local_timer(timer);
+
+    pos_type d;
+    T dist       = T(0);
+    const int ic = findCenter(r, d, dist);
+    const int n  = Last - First;
+    if (ic < 0 || dist > InnerCutoff)
+    {
+      auto u = Grid.Lattice.toUnit_floor(r);
+      for (int i = 0; i < Grid.nBlocks; ++i)
+        if (Grid.activateBlock(i, u))
+          Grid.evaluate_vgh_block(i, u[0], u[1], u[2]);
+      copyGridVGH();
+    }
+    if (ic < 0)
+      return;
+
+    const size_t np = getAlignedSize<T>(n);
+    evaluate_center_vgh(Centers[ic], d, dist);
+    const T* restrict av = Work.data();
+    if (dist <= InnerCutoff)
+    {
+      std::copy_n(av, n, psi.data());
+      for (int a = 0; a < 3; a++)
+        std::copy_n(av + (1 + a) * np, n, grad.data(a));
+      for (int h = 0; h < 6; h++)
+        std::copy_n(av + (4 + h) * np, n, hess.data(h));
+      return;
+    }
+
+    T s, ds, d2s;
+    getBlendWeight(dist, s, ds, d2s);
+    const pos_type nd = d / dist;
+    const T ds_r      = ds / dist;
+    T nn[6], proj[6];
+    for (int a = 0, h = 0; a < 3; a++)
+      for (int b = a; b < 3; b++, h++)
+      {
+        nn[h]   = nd[a] * nd[b];
+        proj[h] = d2s * nn[h] + ds_r * ((a == b ? T(1) : T(0)) - nn[h]);
+      }
+    T* restrict val = psi.data();
+    T* restrict g[3];
+    T* restrict hs[6];
+    for (int a = 0; a < 3; a++)
+      g[a] = grad.data(a);
+    for (int h = 0; h < 6; h++)
+      hs[h] = hess.data(h);
+    for (int j = 0; j < n; j++)
+    {
+      const T dv = av[j] - val[j];
+      T dg[3];
+      for (int a = 0; a < 3; a++)
+        dg[a] = av[(1 + a) * np + j] - g[a][j];
+      for (int a = 0, h = 0; a < 3; a++)
+        for (int b = a; b < 3; b++, h++)
+          hs[h][j] += s * (av[(4 + h) * np + j] - hs[h][j]) + ds * (nd[a] * dg[b] + dg[a] * nd[b]) + dv * proj[h];
+      for (int a = 0; a < 3; a++)
+        g[a][j] += s * dg[a] + ds * dv * nd[a];
+      val[j] += s * dv;
+    }
+  }
+
+  inline void evaluate_vgh(const ParticleSet& P, int iat) { evaluate_vgh(pos_type(P.activeR(iat))); }
+
+  /// gather psi, grad and hess of the blocks of Grid, the derivatives transformed to Cartesian coordinates
+  inline void copyGridVGH()
+  {
+    const Tensor<T, 3>& G = Grid.Lattice.G;
+    // d/dr_a = G(a,b) d/du_b, the Hessian is G H G^T
+    T gh[6][6];
+    for (int a = 0, h = 0; a < 3; a++)
+      for (int c = a; c < 3; c++, h++)
+        for (int b = 0, k = 0; b < 3; b++)
+          for (int e = b; e < 3; e++, k++)
+            gh[h][k] = G(a, b) * G(c, e) + (b != e ? G(a, e) * G(c, b) : T(0));
+
+    for (int i = 0; i < Grid.nBlocks; ++i)
+    {
+      const int first = (Grid.firstBlock + i) * Grid.nSplinesPerBlock;
+      const int count = std::min(first + Grid.nSplinesPerBlock, Last) - first;
+      const int out   = first - First;
+      std::copy_n(Grid.psi[i].data(), count, psi.data() + out);
+      const T* restrict gu[3] = {Grid.grad[i].data(0), Grid.grad[i].data(1), Grid.grad[i].data(2)};
+      for (int a = 0; a < 3; a++)
+      {
+        T* restrict g = grad.data(a) + out;
+#pragma omp simd
+        for (int j = 0; j < count; j++)
+          g[j] = G(a, 0) * gu[0][j] + G(a, 1) * gu[1][j] + G(a, 2) * gu[2][j];
+      }
+      for (int h = 0; h < 6; h++)
+      {
+        T* restrict hc = hess.data(h) + out;
+        std::fill(hc, hc + count, T(0));
+        for (int k = 0; k < 6; k++)
+        {
+          const T w              = gh[h][k];
+          const T* restrict hu   = Grid.hess[i].data(k);
+#pragma omp simd
+          for (int j = 0; j < count; j++)
+            hc[j] += w * hu[j];
+        }
+      }
+    }
+  }
+
+  /** values, gradients and Hessians of the radial splines of a center at d times the harmonics
+   *
+   * With f_lm(r) the radial functions and Y_lm(n) the harmonics of the direction n = d/r,
+   * the sums V = f Y, B = f' Y, A = f'' Y, C = f' grad Y, D = f grad Y and E = f hess Y
+   * give the value V, the gradient B n + D and the Hessian
+   * A n n^T + B/r (1 - n n^T) + n C^T + C n^T + E.
+   * The outputs v, g and h are left in the first 10 arrays of Work.
+   */
+  inline void evaluate_center_vgh(const AtomicCenter& center, const pos_type& d, T dist)
+  {
+    const int n       = Last - First;
+    const size_t np   = getAlignedSize<T>(n);
+    const T r         = std::max(dist, MinRadius);
+    const pos_type nd = dist > MinRadius ? d / dist : pos_type(T(0), T(0), T(1));
+    Ylm.evaluateVGH(nd[0], nd[1], nd[2], ylm_v.data(), ylm_g.data(), ylm_h.data());
+
+    T t, a[4], da[4], d2a[4];
+    int ir;
+    spline2::getSplineBound(dist * center.DeltaInv, t, ir, center.NumGrid - 1);
+    MultiBsplineData<T>::compute_prefactors(a, da, d2a, t);
+    for (int k = 0; k < 4; k++)
+    {
+      da[k] *= center.DeltaInv;
+      d2a[k] *= center.DeltaInv * center.DeltaInv;
+    }
+
+    // V, D(3), E(6), B, C(3), A
+    T* restrict acc[15];
+    for (int k = 0; k < 15; k++)
+    {
+      acc[k] = Work.data() + k * np;
+      std::fill(acc[k], acc[k] + n, T(0));
+    }
+    const size_t row = NumLM * Stride;
+    for (int lm = 0; lm < NumLM; lm++)
+    {
+      // derivatives of Y(d/r) = S(n) from those of the solid harmonic S
+      const int l  = Ylm.getL(lm);
+      const T y    = ylm_v[lm];
+      const T gs[3] = {ylm_g[lm], ylm_g[NumLM + lm], ylm_g[2 * NumLM + lm]};
+      T wf[10], wfp[4];
+      wf[0] = y;
+      for (int k = 0; k < 3; k++)
+        wf[1 + k] = (gs[k] - l * y * nd[k]) / r;
+      for (int k = 0, h = 0; k < 3; k++)
+        for (int m = k; m < 3; m++, h++)
+          wf[4 + h] = (ylm_h[h * NumLM + lm] - l * (gs[k] * nd[m] + nd[k] * gs[m]) - (k == m ? l * y : T(0)) +
+                       l * (l + 2) * y * nd[k] * nd[m]) /
+              (r * r);
+      for (int k = 0; k < 4; k++)
+        wfp[k] = wf[k];
+
+      const T* restrict p0 = center.Coefs + ir * row + lm * Stride + First;
+      const T* restrict p1 = p0 + row;
+      const T* restrict p2 = p1 + row;
+      const T* restrict p3 = p2 + row;
+      for (int j = 0; j < n; j++)
+      {
+        const T f   = a[0] * p0[j] + a[1] * p1[j] + a[2] * p2[j] + a[3] * p3[j];
+        const T fp  = da[0] * p0[j] + da[1] * p1[j] + da[2] * p2[j] + da[3] * p3[j];
+        const T fpp = d2a[0] * p0[j] + d2a[1] * p1[j] + d2a[2] * p2[j] + d2a[3] * p3[j];
+        for (int k = 0; k < 10; k++)
+          acc[k][j] += f * wf[k];
+        for (int k = 0; k < 4; k++)
+          acc[10 + k][j] += fp * wfp[k];
+        acc[14][j] += fpp * y;
+      }
+    }
+
+    const T r_inv = T(1) / r;
+    for (int j = 0; j < n; j++)
+    {
+      const T V = acc[0][j], B = acc[10][j], A = acc[14][j];
+      const T D[3] = {acc[1][j], acc[2][j], acc[3][j]};
+      const T C[3] = {acc[11][j], acc[12][j], acc[13][j]};
+      for (int k = 0, h = 0; k < 3; k++)
+        for (int m = k; m < 3; m++, h++)
+        {
+          const T nn = nd[k] * nd[m];
+          acc[4 + h][j] += A * nn + B * r_inv * ((k == m ? T(1) : T(0)) - nn) + nd[k] * C[m] + C[k] * nd[m];
+        }
+      for (int k = 0; k < 3; k++)
+        acc[1 + k][j] = B * nd[k] + D[k];
+      acc[0][j] = V;
+    }
+  }
+
+  inline void evaluate(const ParticleSet& P,
+                       int iat,
+                       ValueVector_t& psi_v,
+                       GradVector_t& dpsi_v,
+                       ValueVector_t& d2psi_v)
+  {
+    evaluate_vgh(P, iat);
+    copy_vgh(psi_v, dpsi_v, d2psi_v);
+  }
+
+  /// copy psi, grad and the trace of hess of the orbitals owned by this object to the SPO vectors
+  inline void copy_vgh(ValueVector_t& psi_v, GradVector_t& dpsi_v, ValueVector_t& d2psi_v)
+  {
+    for (int j = 0; j < Last - First; j++)
+    {
+      psi_v[First + j]   = psi[j];
+      dpsi_v[First + j]  = grad[j];
+      d2psi_v[First + j] = hess.data(0)[j] + hess.data(3)[j] + hess.data(5)[j];
+    }
+  }
+
+  void print(std::ostream& os)
+  {
+    os << "Hybrid SPO lmax=" << Lmax << " cutoff=" << Cutoff << " centers=" << Centers.size() << std::endl;
+    os << "  grid ";
+    Grid.print(os);
+  }
+
+private:
+  /// the harmonics are evaluated along z closer to a center
+  static constexpr T MinRadius = T(1e-8);
+
+  /// interpolate the orbitals on the grid points, without the atomic terms unless atomic is true
+  void interpolateGrid(const SyntheticOrbitals<T>& orbitals, bool atomic)
+  {
+    const TinyVector<int, 3> ng = grid_spo_type::getGridNum(Grid.einsplines[0]);
+    const int norb              = orbitals.size();
+    const size_t plane          = static_cast<size_t>(ng[1]) * ng[2];
+    std::vector<T> values(ng[0] * plane * norb);
+#pragma omp parallel for
+    for (int ix = 0; ix < ng[0]; ix++)
+      for (int iy = 0; iy < ng[1]; iy++)
+        for (int iz = 0; iz < ng[2]; iz++)
+        {
+          const pos_type u(T(ix) / ng[0], T(iy) / ng[1], T(iz) / ng[2]);
+          orbitals.evaluate_v(Grid.Lattice.toCart(u), values.data() + ((ix * ng[1] + iy) * ng[2] + iz) * norb, atomic);
+        }
+
+    Grid.interpolate(values);
+  }
+
+  /// project the orbitals on the harmonics in the spheres and interpolate the radial functions
+  void projectCenters(const SyntheticOrbitals<T>& orbitals, T delta)
+  {
+    const int norb     = orbitals.size();
+    const int num_grid = std::max(4, static_cast<int>(std::ceil(Cutoff / delta)));
+    const T dr         = Cutoff / num_grid;
+    // points beyond the cutoff and mirrored below 0 to start the recursive filters
+    const int pad     = 10;
+    const int num_pts = num_grid + 2 * pad + 1;
+    const size_t row  = NumLM * Stride;
+
+    // the products with the harmonics up to Lmax of the angular content up to 2 Lmax are exact
+    std::vector<pos_type> dirs;
+    std::vector<T> weights;
+    SolidHarmonics<T>::getQuadrature(3 * Lmax, dirs, weights);
+    const int num_dirs = dirs.size();
+    std::vector<T> ylm_dirs(num_dirs * NumLM);
+    for (int q = 0; q < num_dirs; q++)
+      Ylm.evaluate(dirs[q][0], dirs[q][1], dirs[q][2], ylm_dirs.data() + q * NumLM);
+
+    const std::vector<pos_type>& ions = orbitals.getCenters();
+    const int num_centers             = ions.size();
+    Centers.resize(num_centers);
+    CenterCoefs.resize(num_centers);
+#pragma omp parallel
+    {
+      std::vector<T> proj(num_pts * row);
+      std::vector<T> vals(norb);
+#pragma omp for
+      for (int ic = 0; ic < num_centers; ic++)
+      {
+        std::fill(proj.begin(), proj.end(), T(0));
+        for (int k = 0; k <= num_grid + pad; k++)
+        {
+          T* restrict f = proj.data() + (pad + k) * row;
+          for (int q = 0; q < num_dirs; q++)
+          {
+            orbitals.evaluate_v(ions[ic] + (k * dr) * dirs[q], vals.data());
+            for (int lm = 0; lm < NumLM; lm++)
+            {
+              const T w = weights[q] * ylm_dirs[q * NumLM + lm];
+              for (int j = 0; j < norb; j++)
+                f[lm * Stride + j] += w * vals[j];
+            }
+          }
+        }
+        // f_lm(-r) = (-1)^l f_lm(r)
+        for (int k = 1; k <= pad; k++)
+          for (int lm = 0; lm < NumLM; lm++)
+          {
+            const T parity = Ylm.getL(lm) % 2 ? T(-1) : T(1);
+            const T* src   = proj.data() + (pad + k) * row + lm * Stride;
+            T* dst         = proj.data() + (pad - k) * row + lm * Stride;
+            for (int j = 0; j < norb; j++)
+              dst[j] = parity * src[j];
+          }
+        spline2::solveCubicBsplineRows(proj.data(), num_pts, row, row, false);
+
+        CenterCoefs[ic].assign(proj.begin() + (pad - 1) * row, proj.begin() + (pad + num_grid + 2) * row);
+        Centers[ic].Pos      = ions[ic];
+        Centers[ic].NumGrid  = num_grid;
+        Centers[ic].DeltaInv = T(1) / dr;
+        Centers[ic].Coefs    = CenterCoefs[ic].data();
+      }
+    }
+  }
+};
+
+template<typename T>
+constexpr T hybrid_spo<T>::MinRadius;
+
+} // namespace qmcplusplus
+#endif
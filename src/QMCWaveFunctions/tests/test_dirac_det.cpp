@@ -14,6 +14,7 @@
 
 #include <stdio.h>
 #include <string>
+#include <memory>
 #include "QMCWaveFunctions/DiracDeterminant.h"
 
 using std::string;
@@ -514,4 +515,268 @@ TEST_CASE("DiracDeterminant_delayed_update", "[wavefunction][fermion]")
   check_matrix(orig_a, ddc.psiM);
 }
 
+/// FakeSPO with laplacians which leaves them out of the accepted moves
+class LazyFakeSPO : public FakeSPO
+{
+public:
+  /// laplacian of the orbital i at the particle iat
+  static ValueType lap(int iat, int i) { return 0.5 * i + iat; }
+
+  void evaluate(const ParticleSet& P, int iat, ValueVector_t& psi, GradVector_t& dpsi, ValueVector_t& d2psi) override
+  {
+    FakeSPO::evaluate(P, iat, psi, dpsi, d2psi);
+    for (int i = 0; i < OrbitalSetSize; i++)
+      d2psi[i] = lap(iat, i);
+  }
+
+  bool copyLastVG(ValueVector_t& psi_v, GradVector_t& dpsi_v, ValueVector_t& d2psi_v) override
+  {
+    std::copy_n(lastPsi.data(), OrbitalSetSize, psi_v.data());
+    std::copy_n(lastdPsi.data(), OrbitalSetSize, dpsi_v.data());
+    return false;
+  }
+};
+
+TEST_CASE("DiracDeterminant_lazy_laplacian", "[wavefunction][fermion]")
+{
+  LazyFakeSPO* spo = new LazyFakeSPO();
+  const int norb   = 4;
+  spo->setOrbitalSetSize(norb);
+  DetType ddb(spo, 0);
+  ddb.LazyLaplacians = true;
+
+  ParticleSet elec;
+  elec.create(4);
+  ddb.recompute(elec);
+  for (int j = 0; j < norb; j++)
+    ddb.d2psiM(1, j) = -1;
+
+  ParticleSet::GradType grad;
+  ddb.ratioGrad(elec, 1, grad);
+  ddb.acceptMove(elec, 1);
+  ddb.completeUpdates();
+  // the laplacians of the accepted move are pending
+  REQUIRE(ddb.LaplacianPending[1] == 1);
+  REQUIRE(ddb.LaplacianPending[0] == 0);
+  REQUIRE(ddb.d2psiM(1, 0) == ValueApprox(-1));
+
+  ParticleSet::ParticleGradient_t G(4);
+  ParticleSet::ParticleLaplacian_t L(4);
+  ddb.evaluateGL(elec, G, L);
+  REQUIRE(ddb.LaplacianPending[1] == 0);
+  for (int j = 0; j < norb; j++)
+    REQUIRE(ddb.d2psiM(1, j) == ValueApprox(LazyFakeSPO::lap(1, j)));
+
+  // by default the laplacians come with the accepted move
+  LazyFakeSPO* spo_eager = new LazyFakeSPO();
+  spo_eager->setOrbitalSetSize(norb);
+  DetType dde(spo_eager, 0);
+  dde.recompute(elec);
+  for (int j = 0; j < norb; j++)
+    dde.d2psiM(1, j) = -1;
+  dde.ratioGrad(elec, 1, grad);
+  dde.acceptMove(elec, 1);
+  dde.completeUpdates();
+  REQUIRE(dde.LaplacianPending[1] == 0);
+  for (int j = 0; j < norb; j++)
+    REQUIRE(dde.d2psiM(1, j) == ValueApprox(LazyFakeSPO::lap(1, j)));
+}
+
+/// well-conditioned, diagonally dominant orbitals, diag sets the diagonal of the particles evaluated next
+class DominantSPO : public SPOSet
+{
+public:
+  ValueType diag = 4;
+
+  DominantSPO() { className = "DominantSPO"; }
+
+  void setOrbitalSetSize(int norbs) { OrbitalSetSize = norbs; }
+
+  void evaluate(const ParticleSet& P, int iat, ValueVector_t& psi) override
+  {
+    for (int j = 0; j < OrbitalSetSize; j++)
+      psi[j] = j == iat ? diag : ValueType(1) / (2 + iat + j);
+  }
+
+  void evaluate(const ParticleSet& P, int iat, ValueVector_t& psi, GradVector_t& dpsi, ValueVector_t& d2psi) override
+  {
+    evaluate(P, iat, psi);
+    for (int j = 0; j < OrbitalSetSize; j++)
+    {
+      dpsi[j]  = 0;
+      d2psi[j] = 0;
+    }
+  }
+};
+
+TEST_CASE("DiracDeterminant_residual_check", "[wavefunction][fermion]")
+{
+  DominantSPO* spo = new DominantSPO();
+  const int norb   = 4;
+  spo->setOrbitalSetSize(norb);
+  DetType ddb(spo, 0, 2);
+  ddb.setResidualThreshold(1e-4);
+
+  ParticleSet elec;
+  elec.create(4);
+  ddb.recompute(elec);
+
+  // under the threshold, the updated inverse is kept
+  ParticleSet::GradType grad;
+  spo->diag = 5;
+  ddb.ratioGrad(elec, 1, grad);
+  ddb.acceptMove(elec, 1);
+  REQUIRE(ddb.psiM_temp(1, 1) == ValueApprox(5));
+  ddb.completeUpdates();
+  REQUIRE(ddb.NumReinversions == 0);
+  REQUIRE(ddb.LastResidual < ddb.getResidualThreshold());
+
+  // over the threshold, the drifted inverse is recomputed from the orbitals
+  Matrix<ValueType> good_inverse(norb, norb);
+  good_inverse = ddb.psiM;
+  ddb.psiM(2, 1) += 0.5;
+  ddb.completeUpdates();
+  REQUIRE(ddb.NumReinversions == 1);
+  REQUIRE(ddb.LastResidual > ddb.getResidualThreshold());
+  check_matrix(ddb.psiM, good_inverse);
+
+  ddb.completeUpdates();
+  REQUIRE(ddb.NumReinversions == 1);
+
+  // no check and no copy of the accepted orbitals with a zero threshold
+  ddb.setResidualThreshold(0);
+  spo->diag = 6;
+  ddb.ratioGrad(elec, 2, grad);
+  ddb.acceptMove(elec, 2);
+  REQUIRE(ddb.psiM_temp(2, 2) == ValueApprox(4));
+  ddb.psiM(2, 1) += 0.5;
+  ddb.completeUpdates();
+  REQUIRE(ddb.NumReinversions == 1);
+
+  // turned on again, the stale psiM_temp is not checked until the next recompute
+  ddb.setResidualThreshold(1e-4);
+  ddb.completeUpdates();
+  REQUIRE(ddb.NumReinversions == 1);
+  ddb.recompute(elec);
+  good_inverse = ddb.psiM;
+  ddb.psiM(2, 1) += 0.5;
+  ddb.completeUpdates();
+  REQUIRE(ddb.NumReinversions == 2);
+  check_matrix(ddb.psiM, good_inverse);
+}
+
+TEST_CASE("DiracDeterminant_crowd_delayed_update", "[wavefunction][fermion]")
+{
+  const int norb = 4;
+  const int nw   = 3;
+  // the walkers accepting the moves of the electrons 0, 1 and 2
+  const std::vector<std::vector<bool>> accepted{{true, false, true}, {true, true, false}, {false, true, true}};
+
+  ParticleSet elec;
+  elec.create(4);
+  ParticleSet::ParticleGradient_t G(4);
+  ParticleSet::ParticleLaplacian_t L(4);
+
+  // maximum delay 2, the crowd flushes once the first walker reaches it
+  std::vector<std::unique_ptr<DetType>> crowd, ref;
+  std::vector<WaveFunctionComponent*> WFC_list;
+  std::vector<ParticleSet*> P_list(nw, &elec);
+  std::vector<ParticleSet::ParticleGradient_t*> G_list(nw, &G);
+  std::vector<ParticleSet::ParticleLaplacian_t*> L_list(nw, &L);
+  for (int iw = 0; iw < nw; iw++)
+  {
+    FakeSPO* spo = new FakeSPO();
+    spo->setOrbitalSetSize(norb);
+    crowd.emplace_back(new DetType(spo, 0, 2));
+    WFC_list.push_back(crowd.back().get());
+    ref.emplace_back(new DetType(spo, 0, 2));
+    ref.back()->recompute(elec);
+  }
+
+  ParticleSet::ParticleValue_t values(nw);
+  crowd[0]->multi_evaluateLog(WFC_list, P_list, G_list, L_list, values);
+  // the inverse matrices are stored contiguously
+  for (int iw = 1; iw < nw; iw++)
+    REQUIRE(crowd[iw]->psiM.data() - crowd[0]->psiM.data() == iw * (crowd[1]->psiM.data() - crowd[0]->psiM.data()));
+
+  std::vector<QMCTraits::PosType> grad_now(nw), grad_new(nw);
+  std::vector<ValueType> ratios(nw);
+  for (int iel = 0; iel < 3; iel++)
+  {
+    crowd[0]->multi_evalGrad(WFC_list, P_list, iel, grad_now);
+    crowd[0]->multi_ratioGrad(WFC_list, P_list, iel, ratios, grad_new);
+    for (int iw = 0; iw < nw; iw++)
+    {
+      ParticleSet::GradType grad;
+      ref[iw]->evalGrad(elec, iel);
+      REQUIRE(ratios[iw] == ValueApprox(ref[iw]->ratioGrad(elec, iel, grad)));
+      if (accepted[iel][iw])
+        ref[iw]->acceptMove(elec, iel);
+    }
+    crowd[0]->multi_acceptrestoreMove(WFC_list, P_list, accepted[iel], iel);
+    // the first walker has reached its delay after the second electron and flushed all of them
+    if (iel == 1)
+      for (int iw = 0; iw < nw; iw++)
+        REQUIRE(crowd[iw]->updateEng.getDelayCount() == 0);
+  }
+  crowd[0]->multi_completeUpdates(WFC_list);
+
+  for (int iw = 0; iw < nw; iw++)
+  {
+    ref[iw]->completeUpdates();
+    REQUIRE(crowd[iw]->LogValue == Approx(ref[iw]->LogValue));
+    check_matrix(crowd[iw]->psiM, ref[iw]->psiM);
+  }
+}
+
+TEST_CASE("DiracDeterminant_crowd_evaluateLog", "[wavefunction][fermion]")
+{
+  const int nw = 3;
+  for (int norb : {3, 4})
+  {
+    ParticleSet elec;
+    elec.create(norb);
+    std::vector<std::unique_ptr<DetType>> crowd, ref;
+    std::vector<WaveFunctionComponent*> WFC_list;
+    std::vector<ParticleSet*> P_list(nw, &elec);
+    std::vector<ParticleSet::ParticleGradient_t> G(nw, ParticleSet::ParticleGradient_t(norb));
+    std::vector<ParticleSet::ParticleLaplacian_t> L(nw, ParticleSet::ParticleLaplacian_t(norb));
+    std::vector<ParticleSet::ParticleGradient_t*> G_list(nw);
+    std::vector<ParticleSet::ParticleLaplacian_t*> L_list(nw);
+    for (int iw = 0; iw < nw; iw++)
+    {
+      FakeSPO* spo = new FakeSPO();
+      spo->setOrbitalSetSize(norb);
+      crowd.emplace_back(new DetType(spo, 0, 2));
+      WFC_list.push_back(crowd.back().get());
+      ref.emplace_back(new DetType(spo, 0, 2));
+      G[iw]      = 0;
+      L[iw]      = 0;
+      G_list[iw] = &G[iw];
+      L_list[iw] = &L[iw];
+    }
+
+    // the orbitals of the crowd evaluated together and the inverses computed in parallel
+    ParticleSet::ParticleValue_t values(nw);
+    crowd[0]->multi_evaluateLog(WFC_list, P_list, G_list, L_list, values);
+
+    ParticleSet::ParticleGradient_t G_ref(norb);
+    ParticleSet::ParticleLaplacian_t L_ref(norb);
+    for (int iw = 0; iw < nw; iw++)
+    {
+      G_ref = 0;
+      L_ref = 0;
+      REQUIRE(values[iw] == Approx(ref[iw]->evaluateLog(elec, G_ref, L_ref)));
+      REQUIRE(crowd[iw]->LogValue == Approx(ref[iw]->LogValue));
+      REQUIRE(crowd[iw]->PhaseValue == Approx(ref[iw]->PhaseValue));
+      check_matrix(crowd[iw]->psiM, ref[iw]->psiM);
+      for (int iat = 0; iat < norb; iat++)
+      {
+        REQUIRE(G[iw][iat][0] == ValueApprox(G_ref[iat][0]));
+        REQUIRE(L[iw][iat] == ValueApprox(L_ref[iat]));
+      }
+    }
+  }
+}
+
 } // namespace qmcplusplus
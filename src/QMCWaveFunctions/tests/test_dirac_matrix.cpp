@@ -162,4 +162,89 @@ TEST_CASE("DiracMatrix_update_row", "[wavefunction][fermion]")
 }
 
 
+TEST_CASE("DiracMatrix_blocked_inverse", "[wavefunction][fermion]")
+{
+  InverseKernel kernel;
+  REQUIRE(parseInverseKernel("blocked", kernel));
+  REQUIRE(kernel == InverseKernel::BLOCKED);
+  REQUIRE(getInverseKernelName(kernel) == "blocked");
+  REQUIRE_FALSE(parseInverseKernel("getri", kernel));
+
+  DiracMatrix<ValueType> dm;
+  // across the panels and the row blocks of the kernel, with row swaps
+  for (int n : {1, 3, 17, 40})
+  {
+    Matrix<ValueType> a(n, n), a_inv(n, n), a_inv_ref(n, n);
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < n; j++)
+        a(i, j) = i == j ? 0.1 : std::sin(3.0 * i + 7.0 * j + 1.0);
+
+    RealType LogValue, PhaseValue, LogValue_ref, PhaseValue_ref;
+    setInverseKernel(InverseKernel::LAPACK);
+    dm.invert_transpose(a, a_inv_ref, LogValue_ref, PhaseValue_ref);
+    setInverseKernel(InverseKernel::BLOCKED);
+    dm.invert_transpose(a, a_inv, LogValue, PhaseValue);
+    REQUIRE(LogValue == Approx(LogValue_ref));
+    REQUIRE(PhaseValue == Approx(PhaseValue_ref));
+    check_matrix(a_inv, a_inv_ref);
+  }
+  setInverseKernel(InverseKernel::AUTO);
+  InverseKernel tuned = DiracMatrix<ValueType>::getKernel(64);
+  REQUIRE(tuned != InverseKernel::AUTO);
+}
+
+TEST_CASE("DelayRankTuner", "[wavefunction][fermion]")
+{
+  // time per move at the rank r, the least at r = 10 among r = 4, 8, 16 ... 64
+  auto cost = [](int r) { return 1.0 / r + 0.01 * r; };
+  // sweeps over 100 rows accepting one move out of every_nth, flushed at the rank and at the end of a sweep
+  double now = 0;
+  auto run   = [&](DelayRankTuner& tuner, int every_nth, int num_rows) {
+    const int norb = 100;
+    int count      = 0;
+    for (int i = 0; i < num_rows; i++)
+    {
+      // a gap between the sweeps is not timed
+      now += i % norb ? cost(tuner.getRank()) : 1000.0;
+      tuner.countRow(i % norb, now);
+      // a row requested again is not counted
+      tuner.countRow(i % norb, now);
+      if (i % every_nth == 0)
+      {
+        tuner.countAccept();
+        count++;
+      }
+      if (count > 0 && (count == tuner.getRank() || i % norb == norb - 1))
+      {
+        count = 0;
+        tuner.flushed();
+      }
+    }
+  };
+
+  DelayRankTuner tuner;
+  tuner.start(64);
+  REQUIRE(tuner.isTuning());
+  REQUIRE(tuner.getRank() == 4);
+  run(tuner, 2, 8000);
+  REQUIRE(!tuner.isTuning());
+  REQUIRE(tuner.getRank() == 8);
+  REQUIRE(tuner.getTunedAcceptance() == Approx(0.5).epsilon(0.01));
+
+  // a steady acceptance ratio keeps the rank
+  run(tuner, 2, 3 * int(DelayRankTuner::drift_window));
+  REQUIRE(!tuner.isTuning());
+  // the acceptance ratio drifts and the tuner settles on it again
+  run(tuner, 5, 8000);
+  REQUIRE(!tuner.isTuning());
+  REQUIRE(tuner.getTunedAcceptance() == Approx(0.2).epsilon(0.01));
+
+  // an adaptive engine starts with the smallest candidate
+  DelayedUpdate<ValueType, QMCTraits::QTFull::ValueType> updateEng;
+  updateEng.resize(200, 0);
+  REQUIRE(updateEng.getDelayRank() == int(DelayRankTuner::min_rank));
+  updateEng.resize(200, 16);
+  REQUIRE(updateEng.getDelayRank() == 16);
+}
+
 } // namespace qmcplusplus
@@ -14,9 +14,10 @@
  * @brief Defintion of Communicate and CommunicateMPI classes.
  */
 #include <Utilities/Communicate.h>
+#include <algorithm>
 #include <iostream>
 
-Communicate::Communicate(int argc, char** argv)
+Communicate::Communicate(int argc, char** argv) : m_owner(true)
 {
 #ifdef HAVE_MPI
   MPI_Init(&argc, &argv);
@@ -32,7 +33,10 @@ Communicate::Communicate(int argc, char** argv)
 Communicate::~Communicate()
 {
 #ifdef HAVE_MPI
-  MPI_Finalize();
+  if (m_owner)
+    MPI_Finalize();
+  else
+    MPI_Comm_free(&m_world);
 #endif
 }
 
@@ -59,3 +63,81 @@ void Communicate::reduce(double& value)
   MPI_Reduce(&local_value, &value, 1, MPI_DOUBLE, MPI_SUM, 0, m_world);
 #endif
 }
+
+std::unique_ptr<Communicate> Communicate::createNodeComm() const
+{
+  std::unique_ptr<Communicate> node(new Communicate(*this));
+  node->m_owner = false;
+#ifdef HAVE_MPI
+  MPI_Comm_split_type(m_world, MPI_COMM_TYPE_SHARED, m_rank, MPI_INFO_NULL, &node->m_world);
+  MPI_Comm_rank(node->m_world, &node->m_rank);
+  MPI_Comm_size(node->m_world, &node->m_size);
+#endif
+  return node;
+}
+
+void Communicate::allgather(const int* send, int* recv, int count)
+{
+#ifdef HAVE_MPI
+  MPI_Allgather(send, count, MPI_INT, recv, count, MPI_INT, m_world);
+#else
+  std::copy_n(send, count, recv);
+#endif
+}
+
+#ifdef HAVE_MPI
+/// displacements of consecutive blocks of counts values
+static std::vector<int> getDisplacements(const std::vector<int>& counts)
+{
+  std::vector<int> displs(counts.size(), 0);
+  for (int r = 1; r < counts.size(); r++)
+    displs[r] = displs[r - 1] + counts[r - 1];
+  return displs;
+}
+#endif
+
+void Communicate::allgatherv(const float* send, float* recv, const std::vector<int>& counts)
+{
+#ifdef HAVE_MPI
+  const std::vector<int> displs = getDisplacements(counts);
+  MPI_Allgatherv(send, counts[m_rank], MPI_FLOAT, recv, counts.data(), displs.data(), MPI_FLOAT, m_world);
+#else
+  std::copy_n(send, counts[0], recv);
+#endif
+}
+
+void Communicate::allgatherv(const double* send, double* recv, const std::vector<int>& counts)
+{
+#ifdef HAVE_MPI
+  const std::vector<int> displs = getDisplacements(counts);
+  MPI_Allgatherv(send, counts[m_rank], MPI_DOUBLE, recv, counts.data(), displs.data(), MPI_DOUBLE, m_world);
+#else
+  std::copy_n(send, counts[0], recv);
+#endif
+}
+
+void Communicate::alltoallv(const float* send, const std::vector<int>& send_counts, float* recv,
+                            const std::vector<int>& recv_counts)
+{
+#ifdef HAVE_MPI
+  const std::vector<int> send_displs = getDisplacements(send_counts);
+  const std::vector<int> recv_displs = getDisplacements(recv_counts);
+  MPI_Alltoallv(send, send_counts.data(), send_displs.data(), MPI_FLOAT, recv, recv_counts.data(),
+                recv_displs.data(), MPI_FLOAT, m_world);
+#else
+  std::copy_n(send, send_counts[0], recv);
+#endif
+}
+
+void Communicate::alltoallv(const double* send, const std::vector<int>& send_counts, double* recv,
+                            const std::vector<int>& recv_counts)
+{
+#ifdef HAVE_MPI
+  const std::vector<int> send_displs = getDisplacements(send_counts);
+  const std::vector<int> recv_displs = getDisplacements(recv_counts);
+  MPI_Alltoallv(send, send_counts.data(), send_displs.data(), MPI_DOUBLE, recv, recv_counts.data(),
+                recv_displs.data(), MPI_DOUBLE, m_world);
+#else
+  std::copy_n(send, send_counts[0], recv);
+#endif
+}
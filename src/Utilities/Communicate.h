@@ -16,6 +16,8 @@
 #ifndef COMMUNICATE_H
 #define COMMUNICATE_H
 
+#include <memory>
+#include <vector>
 #include <Utilities/Configuration.h>
 
 #ifdef HAVE_MPI
@@ -39,9 +41,28 @@ public:
   void reduce(float& value);
   void reduce(double& value);
 
+  /// communicator of the ranks sharing the node of this rank, to be destroyed before this one
+  std::unique_ptr<Communicate> createNodeComm() const;
+
+  /// gather count values of every rank into recv, in the order of the ranks
+  void allgather(const int* send, int* recv, int count);
+  /// gather counts[r] values of every rank r into recv, in the order of the ranks
+  void allgatherv(const float* send, float* recv, const std::vector<int>& counts);
+  void allgatherv(const double* send, double* recv, const std::vector<int>& counts);
+  /** exchange values with every rank
+   * @param send send_counts[r] values for every rank r, in the order of the ranks
+   * @param recv recv_counts[r] values from every rank r, in the order of the ranks
+   */
+  void alltoallv(const float* send, const std::vector<int>& send_counts, float* recv,
+                 const std::vector<int>& recv_counts);
+  void alltoallv(const double* send, const std::vector<int>& send_counts, double* recv,
+                 const std::vector<int>& recv_counts);
+
 protected:
   int m_rank;
   int m_size;
+  /// if true, MPI is finalized by the destructor, otherwise the communicator is freed
+  bool m_owner;
 #ifdef HAVE_MPI
   MPI_Comm m_world;
 #endif
@@ -0,0 +1,254 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file HugePages.cpp
+ * @brief Implements huge-page backed memory
+ */
+#include "Utilities/HugePages.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace qmcplusplus
+{
+/// a block allocated by mmap
+struct HugePageBlock
+{
+  size_t requested;
+  size_t length;
+  HugePageCategory category;
+  bool hugetlb;
+};
+
+static bool HugePagePolicy[NumHugePageCategories] = {false, false, false};
+static std::mutex HugePageMutex;
+/// mmapped blocks indexed by the address
+static std::map<uintptr_t, HugePageBlock> HugePageBlocks;
+
+std::string getHugePageCategoryName(HugePageCategory category)
+{
+  if (category == HugePageCategory::DETERMINANT)
+    return "det";
+  else if (category == HugePageCategory::DISTANCE_TABLE)
+    return "dist";
+  return "spline";
+}
+
+void setHugePagePolicy(HugePageCategory category, bool enable)
+{
+  HugePagePolicy[static_cast<int>(category)] = enable;
+}
+
+bool getHugePagePolicy(HugePageCategory category) { return HugePagePolicy[static_cast<int>(category)]; }
+
+bool parseHugePagePolicy(const std::string& list)
+{
+  bool enable[NumHugePageCategories] = {false, false, false};
+  std::istringstream sin(list);
+  std::string name;
+  while (std::getline(sin, name, ','))
+  {
+    if (name == "all")
+      std::fill(enable, enable + NumHugePageCategories, true);
+    else if (name == "none")
+      std::fill(enable, enable + NumHugePageCategories, false);
+    else
+    {
+      int i = 0;
+      while (i < NumHugePageCategories && name != getHugePageCategoryName(static_cast<HugePageCategory>(i)))
+        i++;
+      if (i == NumHugePageCategories)
+        return false;
+      enable[i] = true;
+    }
+  }
+  std::copy(enable, enable + NumHugePageCategories, HugePagePolicy);
+  return true;
+}
+
+std::string getHugePagePolicyName()
+{
+  std::string names;
+  for (int i = 0; i < NumHugePageCategories; i++)
+    if (HugePagePolicy[i])
+      names += (names.empty() ? "" : ",") + getHugePageCategoryName(static_cast<HugePageCategory>(i));
+  return names.empty() ? "none" : names;
+}
+
+size_t getHugePageSize()
+{
+  static size_t page_size = 0;
+  if (page_size == 0)
+  {
+    size_t kb = 2048;
+    std::ifstream fin("/proc/meminfo");
+    std::string line;
+    while (std::getline(fin, line))
+      if (std::sscanf(line.c_str(), "Hugepagesize: %zu kB", &kb) == 1)
+        break;
+    page_size = kb * 1024;
+  }
+  return page_size;
+}
+
+#ifdef __linux__
+/** map anonymous memory, aligned to the huge page size
+ * @return nullptr on failure
+ */
+static void* mapHugePages(size_t length, bool& hugetlb)
+{
+  hugetlb = true;
+  void* ptr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (ptr != MAP_FAILED)
+    return ptr;
+
+  // over-allocate by one huge page to align the start and trim both ends
+  hugetlb                = false;
+  const size_t page_size = getHugePageSize();
+  ptr = mmap(nullptr, length + page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED)
+    return nullptr;
+  const uintptr_t raw     = reinterpret_cast<uintptr_t>(ptr);
+  const uintptr_t aligned = (raw + page_size - 1) / page_size * page_size;
+  if (aligned > raw)
+    munmap(ptr, aligned - raw);
+  if (raw + page_size > aligned)
+    munmap(reinterpret_cast<void*>(aligned + length), raw + page_size - aligned);
+  ptr = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+  madvise(ptr, length, MADV_HUGEPAGE);
+#endif
+  return ptr;
+}
+#endif
+
+void* allocateHugePages(size_t bytes, size_t align, HugePageCategory category)
+{
+  const size_t page_size = getHugePageSize();
+#ifdef __linux__
+  if (getHugePagePolicy(category) && bytes >= page_size)
+  {
+    const size_t length = (bytes + page_size - 1) / page_size * page_size;
+    bool hugetlb;
+    void* ptr = mapHugePages(length, hugetlb);
+    if (ptr)
+    {
+      std::lock_guard<std::mutex> lock(HugePageMutex);
+      HugePageBlocks[reinterpret_cast<uintptr_t>(ptr)] = HugePageBlock{bytes, length, category, hugetlb};
+      return ptr;
+    }
+  }
+#endif
+  // aligned_alloc requires the size to be a multiple of the alignment
+  const size_t asize = (bytes + align - 1) / align * align;
+  void* ptr          = aligned_alloc(align, std::max(asize, align));
+  if (ptr == nullptr)
+    throw std::runtime_error("Allocation failed in allocateHugePages, requested size in bytes = " +
+                             std::to_string(bytes));
+  return ptr;
+}
+
+void deallocateHugePages(void* ptr)
+{
+  if (ptr == nullptr)
+    return;
+#ifdef __linux__
+  {
+    std::lock_guard<std::mutex> lock(HugePageMutex);
+    auto it = HugePageBlocks.find(reinterpret_cast<uintptr_t>(ptr));
+    if (it != HugePageBlocks.end())
+    {
+      munmap(ptr, it->second.length);
+      HugePageBlocks.erase(it);
+      return;
+    }
+  }
+#endif
+  free(ptr);
+}
+
+std::vector<HugePageUsage> getHugePageUsage()
+{
+  std::vector<HugePageUsage> usage(NumHugePageCategories, HugePageUsage{0, 0, 0, 0});
+  std::lock_guard<std::mutex> lock(HugePageMutex);
+  for (const auto& block : HugePageBlocks)
+  {
+    HugePageUsage& u = usage[static_cast<int>(block.second.category)];
+    u.requested += block.second.requested;
+    u.mapped += block.second.length;
+    if (block.second.hugetlb)
+      u.hugetlb += block.second.length;
+  }
+
+#ifdef __linux__
+  // AnonHugePages of a mapping is attributed to the blocks in proportion to their overlap
+  std::ifstream fin("/proc/self/smaps");
+  std::string line;
+  uintptr_t vma_start = 0, vma_end = 0;
+  while (std::getline(fin, line))
+  {
+    unsigned long first, last;
+    size_t kb;
+    if (std::sscanf(line.c_str(), "%lx-%lx ", &first, &last) == 2)
+    {
+      vma_start = first;
+      vma_end   = last;
+    }
+    else if (std::sscanf(line.c_str(), "AnonHugePages: %zu kB", &kb) == 1 && kb > 0 && vma_end > vma_start)
+    {
+      // a block may start before the mapping if the kernel split it
+      auto it = HugePageBlocks.upper_bound(vma_start);
+      if (it != HugePageBlocks.begin())
+        --it;
+      for (; it != HugePageBlocks.end() && it->first < vma_end; ++it)
+      {
+        const uintptr_t lo = std::max<uintptr_t>(it->first, vma_start);
+        const uintptr_t hi = std::min<uintptr_t>(it->first + it->second.length, vma_end);
+        if (!it->second.hugetlb && hi > lo)
+          usage[static_cast<int>(it->second.category)].transparent +=
+              static_cast<size_t>(static_cast<double>(kb) * 1024 * (hi - lo) / (vma_end - vma_start));
+      }
+    }
+  }
+#endif
+  return usage;
+}
+
+void printHugePageUsage(std::ostream& os, const std::vector<HugePageUsage>& usage)
+{
+  constexpr double MiB = 1024.0 * 1024.0;
+  os << std::fixed << std::setprecision(1);
+  for (int i = 0; i < NumHugePageCategories; i++)
+  {
+    if (!HugePagePolicy[i])
+      continue;
+    const HugePageUsage& u = usage[i];
+    os << std::left << std::setw(8) << getHugePageCategoryName(static_cast<HugePageCategory>(i)) << std::right
+       << " requested = " << u.requested / MiB << " MiB, mapped = " << u.mapped / MiB
+       << " MiB, hugetlb = " << u.hugetlb / MiB << " MiB, transparent = " << u.transparent / MiB << " MiB"
+       << std::endl;
+  }
+  os.unsetf(std::ios_base::floatfield);
+  os << std::setprecision(6);
+}
+
+} // namespace qmcplusplus
@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file HugePages.h
+ * @brief Huge-page backed memory for the large arrays
+ *
+ * Allocations of at least one huge page are served by mmap, first from the
+ * hugetlb pool (MAP_HUGETLB) and otherwise from anonymous memory advised as
+ * transparent huge pages (MADV_HUGEPAGE). If both fail or huge pages are not
+ * enabled for the category of the allocation, the memory comes from aligned_alloc.
+ * No huge page setup of the system is required to run.
+ */
+#ifndef QMCPLUSPLUS_HUGE_PAGES_H
+#define QMCPLUSPLUS_HUGE_PAGES_H
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace qmcplusplus
+{
+/// containers which can be backed by huge pages
+enum class HugePageCategory
+{
+  SPLINE,        // spline coefficients
+  DETERMINANT,   // matrices of the determinants
+  DISTANCE_TABLE // distance and displacement tables
+};
+
+/// number of HugePageCategory
+constexpr int NumHugePageCategories = 3;
+
+/// name of the category
+std::string getHugePageCategoryName(HugePageCategory category);
+
+/// enable or disable huge pages for the allocations of a category made afterwards
+void setHugePagePolicy(HugePageCategory category, bool enable);
+
+/// true if huge pages are enabled for a category
+bool getHugePagePolicy(HugePageCategory category);
+
+/** parse a comma separated list of categories, spline, det and dist, or all or none
+ * @return false if the list is not recognized, the policy is not changed
+ */
+bool parseHugePagePolicy(const std::string& list);
+
+/// comma separated list of the categories with huge pages enabled, or none
+std::string getHugePagePolicyName();
+
+/// size of a huge page in bytes
+size_t getHugePageSize();
+
+/** allocate memory
+ * @param bytes size in bytes
+ * @param align alignment in bytes, a power of 2
+ * @param category container category
+ *
+ * Throws if the allocation fails.
+ */
+void* allocateHugePages(size_t bytes, size_t align, HugePageCategory category);
+
+/// release memory obtained from allocateHugePages
+void deallocateHugePages(void* ptr);
+
+/// memory of a category currently allocated by allocateHugePages
+struct HugePageUsage
+{
+  /// requested bytes
+  size_t requested;
+  /// bytes of the mappings, 0 when allocated by aligned_alloc
+  size_t mapped;
+  /// bytes of the mappings from the hugetlb pool
+  size_t hugetlb;
+  /// bytes of the mappings backed by transparent huge pages
+  size_t transparent;
+};
+
+/** memory usage of each category, indexed by HugePageCategory
+ *
+ * The transparent huge pages are read from /proc/self/smaps.
+ */
+std::vector<HugePageUsage> getHugePageUsage();
+
+/// print the usage of the categories with huge pages enabled
+void printHugePageUsage(std::ostream& os, const std::vector<HugePageUsage>& usage);
+
+} // namespace qmcplusplus
+#endif
@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+
+#include "Utilities/MemberPool.h"
+#include "config.h"
+#if defined(ENABLE_OPENMP)
+#include <omp.h>
+#endif
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace qmcplusplus
+{
+/// polls of a waiting thread before it sleeps
+constexpr int MemberPoolSpins = 4096;
+
+MemberPool::MemberPool(int num_members)
+    : NumMembers(num_members), Task(nullptr), Invoke(nullptr), Generation(0), Pending(0), Stop(false)
+{
+  for (int m = 1; m < NumMembers; m++)
+    Threads.emplace_back(&MemberPool::loop, this, m);
+  bindMembers();
+}
+
+MemberPool::~MemberPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Stop = true;
+    Generation.fetch_add(1, std::memory_order_release);
+  }
+  Wake.notify_all();
+  for (auto& t : Threads)
+    t.join();
+}
+
+void MemberPool::bindMembers()
+{
+#if defined(ENABLE_OPENMP) && _OPENMP >= 201511 && defined(__linux__)
+  const int num_places = omp_get_partition_num_places();
+  if (num_places < 2)
+    return;
+  std::vector<int> places(num_places);
+  omp_get_partition_place_nums(places.data());
+  int first = 0;
+  while (first < num_places && places[first] != omp_get_place_num())
+    first++;
+  for (int m = 1; m < NumMembers; m++)
+  {
+    const int place = places[(first + m * num_places / NumMembers) % num_places];
+    std::vector<int> procs(omp_get_place_num_procs(place));
+    omp_get_place_proc_ids(place, procs.data());
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    for (int proc : procs)
+      CPU_SET(proc, &mask);
+    pthread_setaffinity_np(Threads[m - 1].native_handle(), sizeof(mask), &mask);
+  }
+#endif
+}
+
+void MemberPool::start(void* task, Invoker invoke)
+{
+  Task   = task;
+  Invoke = invoke;
+  Pending.store(NumMembers - 1, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(Mutex);
+    Generation.fetch_add(1, std::memory_order_release);
+  }
+  Wake.notify_all();
+}
+
+void MemberPool::loop(int member)
+{
+  unsigned seen = 0;
+  while (true)
+  {
+    for (int spin = 0; Generation.load(std::memory_order_acquire) == seen; spin++)
+    {
+      if (spin < MemberPoolSpins)
+        std::this_thread::yield();
+      else
+      {
+        std::unique_lock<std::mutex> lock(Mutex);
+        Wake.wait(lock, [&] { return Generation.load(std::memory_order_acquire) != seen; });
+      }
+    }
+    seen = Generation.load(std::memory_order_acquire);
+    if (Stop)
+      return;
+    Invoke(Task, member);
+    Pending.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+} // namespace qmcplusplus
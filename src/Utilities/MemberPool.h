@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file MemberPool.h
+ * @brief Persistent threads running the members of a team
+ *
+ * The threads are created once with the pool and wait between the tasks, so that a
+ * task issued for every electron move does not open a parallel region. They spin for a
+ * while before they sleep, to pick up the next task of a sweep without a wake up.
+ * The threads are spread over the OpenMP place partition of the thread creating the pool,
+ * member 0 staying on the place of the creator. Without a partition of several places,
+ * they inherit the affinity of the creator.
+ */
+#ifndef QMCPLUSPLUS_MEMBER_POOL_H
+#define QMCPLUSPLUS_MEMBER_POOL_H
+
+#include <atomic>
+#include <type_traits>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qmcplusplus
+{
+class MemberPool
+{
+public:
+  /// start num_members - 1 threads, the caller of run is member 0
+  explicit MemberPool(int num_members);
+  ~MemberPool();
+  MemberPool(const MemberPool&) = delete;
+  MemberPool& operator=(const MemberPool&) = delete;
+
+  /// number of members
+  int size() const { return NumMembers; }
+
+  /** run f(m) for all the members m and return when all have returned
+   *
+   * Not reentrant: only one thread may run tasks on a pool at a time.
+   */
+  template<typename F>
+  void run(F&& f)
+  {
+    using Task = typename std::remove_reference<F>::type;
+    wait();
+    start(const_cast<void*>(static_cast<const void*>(&f)),
+          [](void* task, int member) { (*static_cast<Task*>(task))(member); });
+    f(0);
+    wait();
+  }
+
+  /** start f(m) for the members m > 0 and return without waiting for them
+   *
+   * The caller does the share of member 0 itself if any. The next run or post waits for the task.
+   */
+  template<typename F>
+  void post(F&& f)
+  {
+    wait();
+    Posted = std::forward<F>(f);
+    start(&Posted, [](void* task, int member) { (*static_cast<std::function<void(int)>*>(task))(member); });
+  }
+
+  /// wait for the members running the last task
+  void wait() const
+  {
+    while (Pending.load(std::memory_order_acquire) != 0)
+      std::this_thread::yield();
+  }
+
+private:
+  using Invoker = void (*)(void*, int);
+
+  /// start the task on the members m > 0
+  void start(void* task, Invoker invoke);
+  void loop(int member);
+  /// bind the threads of the members to the places of the partition of the caller
+  void bindMembers();
+
+  int NumMembers;
+  std::vector<std::thread> Threads;
+  /// task of the current generation
+  void* Task;
+  Invoker Invoke;
+  /// copy of the task of post, alive until the members are done with it
+  std::function<void(int)> Posted;
+  /// bumped for every task, the threads wait for a change
+  std::atomic<unsigned> Generation;
+  /// members of the current task still running, member 0 excluded
+  std::atomic<int> Pending;
+  bool Stop;
+  std::mutex Mutex;
+  std::condition_variable Wake;
+};
+
+} // namespace qmcplusplus
+#endif
@@ -0,0 +1,125 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file NumaTools.cpp
+ * @brief Implements NUMA domain query and memory placement
+ */
+#include "Utilities/NumaTools.h"
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+namespace qmcplusplus
+{
+#ifdef __linux__
+// from linux/mempolicy.h
+constexpr int QMC_MPOL_BIND       = 2;
+constexpr int QMC_MPOL_INTERLEAVE = 3;
+constexpr int QMC_MPOL_MF_MOVE    = 1 << 1;
+// maximum number of domains handled by the node masks
+constexpr int MaxNumaDomains = 1024;
+constexpr int BitsPerMask    = 8 * sizeof(unsigned long);
+
+static bool setMemoryPolicy(void* addr, size_t size, int mode, const std::vector<int>& nodes, bool move)
+{
+  const uintptr_t page  = sysconf(_SC_PAGESIZE);
+  const uintptr_t first = (reinterpret_cast<uintptr_t>(addr) + page - 1) / page * page;
+  const uintptr_t last  = (reinterpret_cast<uintptr_t>(addr) + size) / page * page;
+  if (last <= first)
+    return false;
+  unsigned long mask[MaxNumaDomains / BitsPerMask] = {0};
+  for (int node : nodes)
+    if (node >= 0 && node < MaxNumaDomains)
+      mask[node / BitsPerMask] |= 1UL << (node % BitsPerMask);
+  return syscall(SYS_mbind, first, last - first, mode, mask, MaxNumaDomains, move ? QMC_MPOL_MF_MOVE : 0) == 0;
+}
+#endif
+
+std::string getNumaPolicyName(NumaPolicy policy)
+{
+  if (policy == NumaPolicy::INTERLEAVE)
+    return "interleave";
+  else if (policy == NumaPolicy::REPLICATE)
+    return "replicate";
+  return "none";
+}
+
+bool parseNumaPolicy(const std::string& name, NumaPolicy& policy)
+{
+  if (name == "none")
+    policy = NumaPolicy::NONE;
+  else if (name == "interleave")
+    policy = NumaPolicy::INTERLEAVE;
+  else if (name == "replicate")
+    policy = NumaPolicy::REPLICATE;
+  else
+    return false;
+  return true;
+}
+
+std::vector<int> getNumaDomains()
+{
+  std::vector<int> nodes;
+#ifdef __linux__
+  // a list of ranges, e.g. 0-1,4
+  std::ifstream fin("/sys/devices/system/node/online");
+  std::string range;
+  while (std::getline(fin, range, ','))
+  {
+    int first = 0, last = -1;
+    char dash;
+    std::istringstream sin(range);
+    if (!(sin >> first))
+      continue;
+    if (!(sin >> dash >> last))
+      last = first;
+    for (int node = first; node <= last; node++)
+      nodes.push_back(node);
+  }
+#endif
+  if (nodes.empty())
+    nodes.push_back(0);
+  return nodes;
+}
+
+int getCurrentNumaDomain()
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned cpu = 0, node = 0;
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+    return node;
+#endif
+  return 0;
+}
+
+bool bindMemoryToNumaDomain(void* addr, size_t size, int node, bool move)
+{
+#ifdef __linux__
+  return setMemoryPolicy(addr, size, QMC_MPOL_BIND, std::vector<int>(1, node), move);
+#else
+  return false;
+#endif
+}
+
+bool interleaveMemory(void* addr, size_t size, bool move)
+{
+#ifdef __linux__
+  return setMemoryPolicy(addr, size, QMC_MPOL_INTERLEAVE, getNumaDomains(), move);
+#else
+  return false;
+#endif
+}
+
+} // namespace qmcplusplus
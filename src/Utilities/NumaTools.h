@@ -0,0 +1,65 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+
+/** @file NumaTools.h
+ * @brief NUMA domain query and memory placement
+ *
+ * Thin wrappers of the Linux getcpu and mbind system calls, no dependency on libnuma.
+ * On other systems, a single domain is reported and placement requests are ignored.
+ */
+#ifndef QMCPLUSPLUS_NUMA_TOOLS_H
+#define QMCPLUSPLUS_NUMA_TOOLS_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace qmcplusplus
+{
+/// placement of the data shared by all the threads
+enum class NumaPolicy
+{
+  NONE,       // first touch
+  INTERLEAVE, // pages interleaved over all the domains
+  REPLICATE   // one copy per domain
+};
+
+/// name of the policy
+std::string getNumaPolicyName(NumaPolicy policy);
+
+/** parse the name of the policy
+ * @return false if the name is not recognized
+ */
+bool parseNumaPolicy(const std::string& name, NumaPolicy& policy);
+
+/// ids of the online NUMA domains
+std::vector<int> getNumaDomains();
+
+/// NUMA domain of the CPU running the calling thread
+int getCurrentNumaDomain();
+
+/** bind the pages of [addr, addr+size) to a NUMA domain
+ * @param node domain id
+ * @param move if true, migrate the pages already touched
+ * @return true if the kernel accepted the policy
+ *
+ * Only the pages fully contained in the range are affected.
+ */
+bool bindMemoryToNumaDomain(void* addr, size_t size, int node, bool move = false);
+
+/** interleave the pages of [addr, addr+size) over all the online NUMA domains
+ * @param move if true, migrate the pages already touched
+ * @return true if the kernel accepted the policy
+ */
+bool interleaveMemory(void* addr, size_t size, bool move = false);
+
+} // namespace qmcplusplus
+#endif
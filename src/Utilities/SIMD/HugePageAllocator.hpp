@@ -0,0 +1,63 @@
+//////////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source License.
+// See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+//////////////////////////////////////////////////////////////////////////////////////
+// -*- C++ -*-
+/** @file HugePageAllocator.hpp
+ */
+#ifndef QMCPLUSPLUS_HUGE_PAGE_ALLOCATOR_H
+#define QMCPLUSPLUS_HUGE_PAGE_ALLOCATOR_H
+
+#include <cstdlib>
+#include "Utilities/HugePages.h"
+
+namespace qmcplusplus
+{
+/** aligned allocator backed by huge pages when enabled for CAT
+ *
+ * Behaves as Mallocator<T, ALIGN> when huge pages are disabled for CAT
+ * or the allocation is smaller than a huge page.
+ */
+template<typename T, size_t ALIGN, HugePageCategory CAT>
+struct HugePageAllocator
+{
+  typedef T value_type;
+  typedef size_t size_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+
+  HugePageAllocator() = default;
+  template<class U>
+  HugePageAllocator(const HugePageAllocator<U, ALIGN, CAT>&)
+  {}
+
+  template<class U>
+  struct rebind
+  {
+    typedef HugePageAllocator<U, ALIGN, CAT> other;
+  };
+
+  T* allocate(std::size_t n) { return static_cast<T*>(allocateHugePages(n * sizeof(T), ALIGN, CAT)); }
+
+  void deallocate(T* p, std::size_t) { deallocateHugePages(p); }
+};
+
+template<class T1, size_t ALIGN1, HugePageCategory CAT1, class T2, size_t ALIGN2, HugePageCategory CAT2>
+bool operator==(const HugePageAllocator<T1, ALIGN1, CAT1>&, const HugePageAllocator<T2, ALIGN2, CAT2>&)
+{
+  return ALIGN1 == ALIGN2 && CAT1 == CAT2;
+}
+template<class T1, size_t ALIGN1, HugePageCategory CAT1, class T2, size_t ALIGN2, HugePageCategory CAT2>
+bool operator!=(const HugePageAllocator<T1, ALIGN1, CAT1>&, const HugePageAllocator<T2, ALIGN2, CAT2>&)
+{
+  return !(ALIGN1 == ALIGN2 && CAT1 == CAT2);
+}
+} // namespace qmcplusplus
+
+#endif
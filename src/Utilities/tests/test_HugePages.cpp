@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+
+#include "catch.hpp"
+#include <cstdint>
+#include <vector>
+#include "Utilities/HugePages.h"
+#include "Utilities/SIMD/HugePageAllocator.hpp"
+
+namespace qmcplusplus
+{
+TEST_CASE("HugePages policy", "[Utilities]")
+{
+  REQUIRE(parseHugePagePolicy("spline,dist"));
+  REQUIRE(getHugePagePolicy(HugePageCategory::SPLINE));
+  REQUIRE(!getHugePagePolicy(HugePageCategory::DETERMINANT));
+  REQUIRE(getHugePagePolicy(HugePageCategory::DISTANCE_TABLE));
+  REQUIRE(getHugePagePolicyName() == "spline,dist");
+
+  // an invalid list leaves the policy unchanged
+  REQUIRE(!parseHugePagePolicy("spline,foo"));
+  REQUIRE(getHugePagePolicyName() == "spline,dist");
+
+  REQUIRE(parseHugePagePolicy("all"));
+  REQUIRE(getHugePagePolicyName() == "spline,det,dist");
+  REQUIRE(parseHugePagePolicy("none"));
+  REQUIRE(getHugePagePolicyName() == "none");
+}
+
+TEST_CASE("HugePageAllocator", "[Utilities]")
+{
+  using Alloc            = HugePageAllocator<double, 64, HugePageCategory::DETERMINANT>;
+  const size_t page_size = getHugePageSize();
+  const size_t n         = 2 * page_size / sizeof(double) + 1;
+
+  // disabled, same as aligned_alloc
+  REQUIRE(parseHugePagePolicy("none"));
+  {
+    std::vector<double, Alloc> v(n, 1.0);
+    REQUIRE(reinterpret_cast<uintptr_t>(v.data()) % 64 == 0);
+    REQUIRE(getHugePageUsage()[static_cast<int>(HugePageCategory::DETERMINANT)].requested == 0);
+  }
+
+  // enabled, mapped and aligned to the huge page size regardless of the system setup
+  REQUIRE(parseHugePagePolicy("det"));
+  {
+    std::vector<double, Alloc> v(n, 1.0);
+    REQUIRE(reinterpret_cast<uintptr_t>(v.data()) % page_size == 0);
+    REQUIRE(v[n - 1] == 1.0);
+    const HugePageUsage usage = getHugePageUsage()[static_cast<int>(HugePageCategory::DETERMINANT)];
+    REQUIRE(usage.requested == n * sizeof(double));
+    REQUIRE(usage.mapped == 3 * page_size);
+    REQUIRE(usage.hugetlb + usage.transparent <= usage.mapped);
+
+    // smaller than a huge page
+    std::vector<double, Alloc> w(8, 2.0);
+    REQUIRE(getHugePageUsage()[static_cast<int>(HugePageCategory::DETERMINANT)].requested == n * sizeof(double));
+  }
+  REQUIRE(getHugePageUsage()[static_cast<int>(HugePageCategory::DETERMINANT)].mapped == 0);
+  REQUIRE(parseHugePagePolicy("none"));
+}
+
+} // namespace qmcplusplus
@@ -0,0 +1,59 @@
+////////////////////////////////////////////////////////////////////////////////
+// This file is distributed under the University of Illinois/NCSA Open Source
+// License.  See LICENSE file in top directory for details.
+//
+// Copyright (c) 2019 QMCPACK developers.
+//
+// File developed by:
+//
+// File created by:
+////////////////////////////////////////////////////////////////////////////////
+
+#include "catch.hpp"
+#include <thread>
+#include <vector>
+#include "Utilities/MemberPool.h"
+
+namespace qmcplusplus
+{
+TEST_CASE("MemberPool", "[Utilities]")
+{
+  const int num_members = 4;
+  MemberPool pool(num_members);
+  REQUIRE(pool.size() == num_members);
+
+  // every member runs once per task, member 0 on the calling thread
+  std::vector<int> counts(num_members, 0);
+  std::thread::id caller;
+  for (int task = 0; task < 100; task++)
+    pool.run([&](int m) {
+      counts[m]++;
+      if (m == 0)
+        caller = std::this_thread::get_id();
+    });
+  for (int m = 0; m < num_members; m++)
+    REQUIRE(counts[m] == 100);
+  REQUIRE(caller == std::this_thread::get_id());
+
+  // a posted task runs on the members m > 0 only, the next task waits for it
+  std::vector<int> posted(num_members, 0);
+  for (int task = 0; task < 100; task++)
+  {
+    pool.post([&](int m) { posted[m]++; });
+    pool.run([&](int m) { counts[m]++; });
+  }
+  pool.wait();
+  REQUIRE(posted[0] == 0);
+  for (int m = 1; m < num_members; m++)
+    REQUIRE(posted[m] == 100);
+  for (int m = 0; m < num_members; m++)
+    REQUIRE(counts[m] == 200);
+
+  // a single member runs on the calling thread only
+  MemberPool single(1);
+  int sum = 0;
+  single.run([&](int m) { sum += m + 1; });
+  REQUIRE(sum == 1);
+}
+
+} // namespace qmcplusplus